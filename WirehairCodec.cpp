@@ -29,6 +29,13 @@
 
 #include "WirehairCodec.h"
 
+#include <atomic>
+#include <chrono> // SolveStep() time budget
+#include <memory>
+#include <new>
+#include <algorithm> // std::sort
+#include <functional> // std::greater
+#include <utility> // std::swap
 
 //------------------------------------------------------------------------------
 // Precompiler-conditional console output
@@ -63,23 +70,215 @@ using namespace std;
 namespace wirehair {
 
 
+//------------------------------------------------------------------------------
+// Segmented Messages
+
+/// What WalkSegmentBlocks() does with blocks that straddle segments
+enum class SegmentWalk
+{
+    GatherIn,  ///< Copy the pieces of the block into its gather slot
+    MapOnly,   ///< Only point the row at its gather slot
+    ScatterOut ///< Copy the gather slot out to the pieces of the block
+};
+
+/**
+    CountStraddlingBlocks()
+
+    Returns the number of blocks of block_bytes with a segment boundary
+    inside them.  Returns -1 if a segment has no data pointer, or if the
+    segments do not add up to message_bytes.
+*/
+template<class SegmentT>
+static int CountStraddlingBlocks(
+    const SegmentT * segments,
+    unsigned segment_count,
+    unsigned block_bytes,
+    uint64_t message_bytes)
+{
+    if (!segments || segment_count < 1) {
+        return -1;
+    }
+
+    int count = 0;
+    uint64_t position = 0;
+    uint64_t last_block = ~static_cast<uint64_t>(0);
+
+    for (unsigned i = 0; i < segment_count; ++i)
+    {
+        if (!segments[i].Data && segments[i].Bytes > 0) {
+            return -1;
+        }
+
+        // If the previous segment ended inside a block:
+        const uint64_t block_i = position / block_bytes;
+        if (position > 0 && position < message_bytes &&
+            position % block_bytes != 0 && block_i != last_block)
+        {
+            ++count;
+            last_block = block_i;
+        }
+
+        position += segments[i].Bytes;
+    }
+
+    return (position == message_bytes) ? count : -1;
+}
+
+/**
+    GetSegmentGatherOffset()
+
+    A segment workspace holds a table of block_count row pointers and then
+    the gather slots.  The table goes first so that it is aligned for
+    pointers.  The slots start on the next kBlockAlignBytes boundary,
+    since the pitch of short blocks is not a multiple of the alignment.
+*/
+static uint64_t GetSegmentGatherOffset(unsigned block_count)
+{
+    const uint64_t tableBytes = sizeof(uint8_t *) * static_cast<uint64_t>(block_count);
+    return (tableBytes + kBlockAlignBytes - 1) & ~static_cast<uint64_t>(kBlockAlignBytes - 1);
+}
+
+/**
+    WalkSegmentBlocks()
+
+    Points rows[i] at block i where it lies inside one segment, and at the
+    next gather_pitch slot of gather where it straddles segments.
+
+    Precondition: CountStraddlingBlocks() accepted the segments
+*/
+template<class SegmentT>
+static void WalkSegmentBlocks(
+    const SegmentT * segments,
+    unsigned block_count,
+    unsigned block_bytes,
+    unsigned final_bytes,
+    uint8_t ** rows,
+    uint8_t * gather,
+    unsigned gather_pitch,
+    SegmentWalk walk)
+{
+    unsigned segment_i = 0;
+    uint64_t segment_start = 0;
+
+    for (unsigned block_i = 0; block_i < block_count; ++block_i)
+    {
+        const uint64_t block_start = static_cast<uint64_t>(block_i) * block_bytes;
+        const unsigned bytes = (block_i == block_count - 1) ? final_bytes : block_bytes;
+
+        // Skip segments that end before this block
+        while (segment_start + segments[segment_i].Bytes <= block_start)
+        {
+            segment_start += segments[segment_i].Bytes;
+            ++segment_i;
+        }
+
+        uint8_t * data = const_cast<uint8_t *>(reinterpret_cast<const uint8_t *>(segments[segment_i].Data));
+
+        // If the block lies inside this segment:
+        if (block_start + bytes <= segment_start + segments[segment_i].Bytes)
+        {
+            rows[block_i] = data + (block_start - segment_start);
+            continue;
+        }
+
+        uint8_t * slot = gather;
+        gather += gather_pitch;
+        rows[block_i] = slot;
+
+        if (walk == SegmentWalk::MapOnly) {
+            continue;
+        }
+
+        // Copy each piece of the block between the slot and its segment
+        unsigned copied = 0;
+        unsigned piece_i = segment_i;
+        uint64_t piece_start = segment_start;
+        while (copied < bytes)
+        {
+            const uint64_t offset = block_start + copied - piece_start;
+            const uint64_t available = segments[piece_i].Bytes - offset;
+            const unsigned piece = (available < bytes - copied) ? (unsigned)available : bytes - copied;
+
+            if (piece > 0)
+            {
+                uint8_t * piece_data = const_cast<uint8_t *>(reinterpret_cast<const uint8_t *>(segments[piece_i].Data)) + offset;
+                if (walk == SegmentWalk::GatherIn) {
+                    memcpy(slot + copied, piece_data, piece);
+                }
+                else {
+                    memcpy(piece_data, slot + copied, piece);
+                }
+                copied += piece;
+            }
+
+            piece_start += segments[piece_i].Bytes;
+            ++piece_i;
+        }
+    }
+}
+
+
 //------------------------------------------------------------------------------
 // Stage (1) Peeling:
 
 bool Codec::OpportunisticPeeling(
     const uint16_t row_i, ///< Row index
-    const uint32_t row_seed ///< Row PRNG seed
+    const uint32_t row_seed, ///< Row PRNG seed
+    const PeelRowParameters* params ///< Precomputed parameters or null
 )
 {
     PeelRow *row = &_peel_rows[row_i];
 
     row->RecoveryId = row_seed;
 
-    row->Params.Initialize(row_seed, _p_seed, _block_count, _mix_count);
+#if defined(CAT_SMALL_N_MDS)
+    // The Cauchy code only needs the row ids
+    if (_mds) {
+        return true;
+    }
+#endif // CAT_SMALL_N_MDS
+
+    if (params) {
+        row->Params = *params;
+    }
+    else {
+        row->Params.Initialize(row_seed, _p_seed, _block_count, _mix_count);
+    }
 
     CAT_IF_DUMP(cout << "Row " << row_seed << " in slot " << row_i << " of weight "
         << row->Params.PeelCount << " [a=" << row->Params.PeelAdd << "] : ";)
 
+    // Store the row columns for the later stages if there is room
+    uint16_t * GF256_RESTRICT cached = nullptr;
+    if (_column_cache_capacity > 0 && row_i < _block_count)
+    {
+        // Rows arrive in slot order, and a slot that failed to peel is
+        // refilled by the next row, so it is always the last one stored
+        uint32_t offset = _column_cache_offsets[row_i];
+        if (offset == kUncachedRow) {
+            offset = _column_cache_used;
+        }
+
+        const uint32_t entries = RowMixIterator::kColumnCount + row->Params.PeelCount;
+
+        if (offset + entries <= _column_cache_capacity)
+        {
+            cached = _column_cache + offset;
+            _column_cache_offsets[row_i] = offset;
+            _column_cache_used = offset + entries;
+
+            const RowMixIterator mix(row->Params, _mix_count, _mix_next_prime);
+            for (unsigned i = 0; i < RowMixIterator::kColumnCount; ++i) {
+                *cached++ = mix.Columns[i];
+            }
+        }
+        else
+        {
+            _column_cache_offsets[row_i] = kUncachedRow;
+            _column_cache_used = offset;
+        }
+    }
+
     PeelRowIterator iter(row->Params, _block_count, _block_next_prime);
 
     uint16_t unmarked_count = 0;
@@ -92,6 +291,10 @@ bool Codec::OpportunisticPeeling(
 
         CAT_IF_DUMP(cout << column_i << " ";)
 
+        if (cached) {
+            *cached++ = column_i;
+        }
+
         PeelRefs *refs = &_peel_col_refs[column_i];
 
         // If there was not enough room in the reference list:
@@ -233,7 +436,7 @@ void Codec::PeelAvalancheOnSolve(
         else if (unmarked_count == 2)
         {
             // Regenerate the row columns to discover which are unmarked
-            PeelRowIterator ref_iter(ref_row->Params, _block_count, _block_next_prime);
+            CachedPeelRowIterator ref_iter(GetCachedRow(ref_row_i), ref_row->Params, _block_count, _block_next_prime);
 
             uint16_t store_count = 0;
 
@@ -321,54 +524,283 @@ void Codec::SolveWithPeel(
     column->PeelRow = row_i;
 }
 
-void Codec::GreedyPeeling()
+uint16_t Codec::PickDeferWeight2() const
 {
-    CAT_IF_DUMP(cout << endl << "---- GreedyPeeling ----" << endl << endl;)
+    const unsigned block_count = _block_count;
 
-    // Initialize list
-    _defer_head_columns = LIST_TERM;
-    _defer_count = 0;
+    uint16_t best_column_i = LIST_TERM;
+    unsigned best_w2_refs = 0;
+    unsigned best_row_count = 0;
 
-    const unsigned block_count = _block_count;
+    const PeelColumn *column = _peel_cols;
 
-    // Until all columns are marked:
-    for (;;)
+    // For each peel column:
+    for (uint16_t column_i = 0; column_i < block_count; ++column_i, ++column)
     {
-        uint16_t best_column_i = LIST_TERM;
-        unsigned best_w2_refs = 0;
-        unsigned best_row_count = 0;
+        // If column is not marked yet:
+        if (column->Mark == MARK_TODO)
+        {
+            const unsigned w2_refs = column->Weight2Refs;
+
+            // If it may have the most weight-2 references:
+            if (w2_refs >= best_w2_refs)
+            {
+                const unsigned row_count = _peel_col_refs[column_i].RowCount;
+
+                // If it has the largest row references overall:
+                if (w2_refs > best_w2_refs || row_count >= best_row_count)
+                {
+                    // Use that one
+                    best_column_i = column_i;
+                    best_w2_refs = w2_refs;
+                    best_row_count = row_count;
+                }
+            }
+        }
+    }
 
-        const PeelColumn *column = _peel_cols;
+    return best_column_i;
+}
+
+uint16_t Codec::PickDeferInactivation(DeferWorkspace& ws)
+{
+    // Use up columns picked earlier from the largest components
+    while (ws.NextCandidate < ws.Candidates.size())
+    {
+        const uint16_t column_i = ws.Candidates[ws.NextCandidate++];
+
+        if (_peel_cols[column_i].Mark == MARK_TODO) {
+            return column_i;
+        }
+    }
 
-        // For each peel column:
-        for (uint16_t column_i = 0; column_i < block_count; ++column_i, ++column)
+    // Drop rows that were solved or deferred since the last pass, and find
+    // the fewest unmarked columns among the rest
+    unsigned min_count = kMaxPeelCount + 1;
+    uint16_t min_row_i = LIST_TERM;
+    size_t pending_count = 0;
+
+    for (size_t i = 0, count = ws.Pending.size(); i < count; ++i)
+    {
+        const uint16_t row_i = ws.Pending[i];
+        const unsigned unmarked_count = _peel_rows[row_i].UnmarkedCount;
+
+        // Deferred rows can be counted down past zero and wrap around
+        if (unmarked_count >= 2 && unmarked_count <= kMaxPeelCount)
         {
-            // If column is not marked yet:
-            if (column->Mark == MARK_TODO)
+            ws.Pending[pending_count++] = row_i;
+
+            if (unmarked_count < min_count)
             {
-                const unsigned w2_refs = column->Weight2Refs;
+                min_count = unmarked_count;
+                min_row_i = row_i;
+            }
+        }
+    }
 
-                // If it may have the most weight-2 references:
-                if (w2_refs >= best_w2_refs)
-                {
-                    const unsigned row_count = _peel_col_refs[column_i].RowCount;
+    ws.Pending.resize(pending_count);
 
-                    // If it has the largest row references overall:
-                    if (w2_refs > best_w2_refs || row_count >= best_row_count)
-                    {
-                        // Use that one
-                        best_column_i = column_i;
-                        best_w2_refs = w2_refs;
-                        best_row_count = row_count;
-                    }
-                }
+    if (min_row_i == LIST_TERM) {
+        return LIST_TERM;
+    }
+
+    // If no row is down to two columns:
+    if (min_count > 2)
+    {
+        const PeelRow * GF256_RESTRICT row = &_peel_rows[min_row_i];
+        CachedPeelRowIterator iter(GetCachedRow(min_row_i), row->Params, _block_count, _block_next_prime);
+
+        uint16_t best_column_i = LIST_TERM;
+        unsigned best_refs = 0;
+
+        // Defer the unmarked column that touches the most rows
+        do
+        {
+            const uint16_t column_i = iter.GetColumn();
+
+            if (_peel_cols[column_i].Mark == MARK_TODO &&
+                (best_column_i == LIST_TERM || _peel_col_refs[column_i].RowCount > best_refs))
+            {
+                best_column_i = column_i;
+                best_refs = _peel_col_refs[column_i].RowCount;
+            }
+        } while (iter.Iterate());
+
+        return best_column_i;
+    }
+
+    // Union-find over the weight-2 graph, touching only its columns
+    uint16_t * GF256_RESTRICT parent = ws.Parent.data();
+    uint16_t * GF256_RESTRICT size = ws.Size.data();
+    uint16_t * GF256_RESTRICT degree = ws.Degree.data();
+    uint16_t * GF256_RESTRICT best = ws.Best.data();
+
+    // Collect the edges so the passes below read them in order
+    std::vector<uint32_t>& edges = ws.Edges;
+    edges.clear();
+
+    for (uint16_t row_i : ws.Pending)
+    {
+        const PeelRow * GF256_RESTRICT row = &_peel_rows[row_i];
+
+        if (row->UnmarkedCount == 2)
+        {
+            const uint16_t a = row->Marks.Unmarked[0];
+            const uint16_t b = row->Marks.Unmarked[1];
+
+            edges.push_back(((uint32_t)a << 16) | b);
+
+            parent[a] = a;
+            size[a] = 1;
+            degree[a] = 0;
+            best[a] = LIST_TERM;
+            parent[b] = b;
+            size[b] = 1;
+            degree[b] = 0;
+            best[b] = LIST_TERM;
+        }
+    }
+
+    // Find the root of a column, halving the path on the way
+    auto find = [parent](uint16_t x) -> uint16_t {
+        while (parent[x] != x) {
+            x = parent[x] = parent[parent[x]];
+        }
+        return x;
+    };
+
+    unsigned largest = 1;
+
+    for (uint32_t edge : edges)
+    {
+        const uint16_t a = (uint16_t)(edge >> 16);
+        const uint16_t b = (uint16_t)edge;
+
+        ++degree[a];
+        ++degree[b];
+
+        uint16_t root_a = find(a), root_b = find(b);
+
+        if (root_a != root_b)
+        {
+            // Attach the smaller tree under the larger one
+            if (size[root_a] < size[root_b]) {
+                std::swap(root_a, root_b);
+            }
+            parent[root_b] = root_a;
+            size[root_a] += size[root_b];
+
+            if (size[root_a] > largest) {
+                largest = size[root_a];
+            }
+        }
+    }
+
+    // Pick the column with the most edges in each component that is close
+    // in size to the largest one.  Deferring several at once saves passes,
+    // and costs few extra columns while the components are similar in size
+    const unsigned threshold = (largest + kDeferBatchDivisor - 1) / kDeferBatchDivisor;
+
+    for (uint32_t edge : edges)
+    {
+        const uint16_t a = (uint16_t)(edge >> 16);
+        const uint16_t root = find(a);
+
+        if (size[root] >= threshold)
+        {
+            const uint16_t b = (uint16_t)edge;
+
+            if (best[root] == LIST_TERM || degree[a] > degree[best[root]]) {
+                best[root] = a;
+            }
+            if (degree[b] > degree[best[root]]) {
+                best[root] = b;
+            }
+        }
+    }
+
+    // Queue them from the largest component down
+    std::vector<uint32_t>& order = ws.Order;
+    order.clear();
+
+    for (uint32_t edge : edges)
+    {
+        const uint16_t root = find((uint16_t)(edge >> 16));
+
+        if (best[root] != LIST_TERM)
+        {
+            order.push_back(((uint32_t)size[root] << 16) | best[root]);
+            best[root] = LIST_TERM;
+        }
+    }
+
+    std::sort(order.begin(), order.end(), std::greater<uint32_t>());
+
+    ws.Candidates.clear();
+    for (uint32_t entry : order) {
+        ws.Candidates.push_back((uint16_t)entry);
+    }
+
+    ws.NextCandidate = 1;
+    return ws.Candidates[0];
+}
+
+bool Codec::GreedyPeeling(unsigned defer_limit)
+{
+    CAT_IF_DUMP(cout << endl << "---- GreedyPeeling ----" << endl << endl;)
+
+    std::unique_ptr<DeferWorkspace> workspace;
+
+    if (_defer_strategy == Wirehair_Defer_Inactivation)
+    {
+        // Fall back to the weight-2 heuristic if this cannot be allocated
+        try
+        {
+            workspace.reset(new DeferWorkspace);
+            workspace->Parent.resize(_block_count);
+            workspace->Size.resize(_block_count);
+            workspace->Degree.resize(_block_count);
+            workspace->Best.resize(_block_count);
+            workspace->Pending.reserve(_row_count);
+
+            // Reserve the most PickDeferInactivation() can use, so that
+            // it never allocates once peeling is under way
+            workspace->Edges.reserve(_row_count);
+            workspace->Order.reserve(_row_count);
+            workspace->Candidates.reserve(_block_count);
+
+            for (unsigned row_i = 0; row_i < _row_count; ++row_i) {
+                workspace->Pending.push_back((uint16_t)row_i);
             }
         }
+        catch (...) {
+            workspace.reset();
+        }
+    }
+
+    // Until all columns are marked:
+    for (unsigned deferred = 0;; ++deferred)
+    {
+        // If the caller wants to resume later:
+        if (defer_limit != 0 && deferred >= defer_limit) {
+            return false;
+        }
+
+        uint16_t best_column_i = LIST_TERM;
+
+        if (workspace) {
+            best_column_i = PickDeferInactivation(*workspace);
+        }
+
+        // Columns that no unsolved row references are picked up here too
+        if (best_column_i == LIST_TERM) {
+            best_column_i = PickDeferWeight2();
+        }
 
         // If no column was found:
         if (best_column_i == LIST_TERM) {
             // Peeling is complete
-            break;
+            return true;
         }
 
         // Mark column as deferred
@@ -409,10 +841,8 @@ void Codec::SetDeferredColumns()
         CAT_IF_DUMP(cout << "GE column " << ge_column_i <<
             " mapped to matrix column " << defer_i << " :";)
 
-        // Get pointer to this matrix row
-        uint64_t *matrix_row_offset = _compress_matrix + (ge_column_i >> 6);
-
-        // Get word mask for this column bit
+        // Get word offset and mask for this column bit
+        const unsigned ge_word = ge_column_i >> 6;
         const uint64_t ge_mask = (uint64_t)1 << (ge_column_i & 63);
 
         // Get references for this deferred index
@@ -425,7 +855,7 @@ void Codec::SetDeferredColumns()
 
             CAT_IF_DUMP(cout << " " << row_i;)
 
-            matrix_row_offset[_ge_pitch * row_i] |= ge_mask;
+            GetCompressRow(row_i)[ge_word] |= ge_mask;
         }
 
         CAT_IF_DUMP(cout << endl;)
@@ -471,10 +901,10 @@ void Codec::SetMixingColumnsForDeferredRows()
         row->Marks.Result.PeelColumn = LIST_TERM;
 
         // Set up mixing column generator
-        uint64_t *ge_row = _compress_matrix + _ge_pitch * defer_row_i;
+        uint64_t *ge_row = GetCompressRow(defer_row_i);
 
         const unsigned defer_count = _defer_count;
-        const RowMixIterator mix(row->Params, _mix_count, _mix_next_prime);
+        const RowMixIterator mix(GetCachedRow(defer_row_i), row->Params, _mix_count, _mix_next_prime);
 
         // Generate mixing column 1
         const unsigned ge_column_i = defer_count + mix.Columns[0];
@@ -495,35 +925,36 @@ void Codec::SetMixingColumnsForDeferredRows()
     }
 }
 
-void Codec::PeelDiagonal()
+uint16_t Codec::PeelDiagonal(
+    uint16_t peel_row_i, ///< First peeled row to process
+    unsigned row_limit ///< Maximum rows to process, or 0 for all
+)
 {
     CAT_IF_DUMP(cout << endl << "---- PeelDiagonal ----" << endl << endl;)
 
     /*
-        This function optimizes the block value generation by combining the first
-        memcpy and memxor operations together into a three-way memxor if possible,
-        using the is_copied row member.
+        Only the matrix is diagonalized here.  The matching row values are
+        generated later by PeelDiagonalValues() so that the value pass can be
+        repeated on its own once the matrix has been solved.
     */
 
-    CAT_IF_ROWOP(unsigned rowops = 0;)
-
     PeelRow * GF256_RESTRICT row;
 
     // For each peeled row in forward solution order:
-    for (uint16_t peel_row_i = _peel_head_rows;
-        peel_row_i != LIST_TERM;
-        peel_row_i = row->NextRow)
+    for (unsigned rows = 0;
+        peel_row_i != LIST_TERM && (row_limit == 0 || rows < row_limit);
+        peel_row_i = row->NextRow, ++rows)
     {
         row = &_peel_rows[peel_row_i];
 
         // Lookup peeling results
         const uint16_t peel_column_i = row->Marks.Result.PeelColumn;
-        uint64_t *ge_row = _compress_matrix + _ge_pitch * peel_row_i;
+        uint64_t *ge_row = GetCompressRow(peel_row_i);
 
         CAT_IF_DUMP(cout << "Peeled row " << peel_row_i << " for peeled column " << peel_column_i << " :";)
 
         const unsigned defer_count = _defer_count;
-        const RowMixIterator mix(row->Params, _mix_count, _mix_next_prime);
+        const RowMixIterator mix(GetCachedRow(peel_row_i), row->Params, _mix_count, _mix_next_prime);
 
         // Generate mixing column 1
         const unsigned ge_column_i = defer_count + mix.Columns[0];
@@ -540,40 +971,9 @@ void Codec::PeelDiagonal()
         ge_row[ge_column_k >> 6] ^= (uint64_t)1 << (ge_column_k & 63);
         CAT_IF_DUMP(cout << " " << ge_column_k << endl;)
 
-        // Get pointer to output block
-        CAT_DEBUG_ASSERT(peel_column_i < _recovery_rows);
-        uint8_t * GF256_RESTRICT temp_block_src = _recovery_blocks + _block_bytes * peel_column_i;
-
-        // If row has not been copied yet:
-        if (!row->Marks.Result.IsCopied)
-        {
-            const uint8_t * GF256_RESTRICT block_src = _input_blocks + _block_bytes * peel_row_i;
-
-            // If this is not the last block:
-            if (peel_row_i != _block_count - 1) {
-                // Copy it directly to the output block
-                memcpy(temp_block_src, block_src, _block_bytes);
-            }
-            else
-            {
-                // Copy with zero padding
-                memcpy(temp_block_src, block_src, _input_final_bytes);
-                CAT_DEBUG_ASSERT(_block_bytes >= _input_final_bytes);
-                memset(temp_block_src + _input_final_bytes, 0, _block_bytes - _input_final_bytes);
-            }
-            CAT_IF_ROWOP(++rowops;)
-
-            CAT_IF_DUMP(cout << "-- Copied from " << peel_row_i <<
-                " because has not been copied yet.  Output block = " <<
-                (unsigned)temp_block_src[0] << endl;)
-
-            // Note that we do not need to set is_copied here because no
-            // further rows reference this one
-        }
-
         CAT_IF_DUMP(cout << "++ Adding to referencing rows:";)
 
-        PeelRefs * GF256_RESTRICT refs = &_peel_col_refs[peel_column_i];
+        const PeelRefs * GF256_RESTRICT refs = &_peel_col_refs[peel_column_i];
         const uint16_t * GF256_RESTRICT referencingRows = refs->Rows;
 
         // For each row that references this one:
@@ -591,64 +991,166 @@ void Codec::PeelDiagonal()
 
             uint64_t * GF256_RESTRICT ge_ref_row = _compress_matrix + _ge_pitch * ref_row_i;
 
+            // If the referencing row is still clear, copy rather than add
+            if (!_compress_dirty[ref_row_i])
+            {
+                memcpy(ge_ref_row, ge_row, _ge_pitch * sizeof(uint64_t));
+                _compress_dirty[ref_row_i] = 1;
+                continue;
+            }
+
             // Add GE row to referencing GE row
             for (unsigned j = 0; j < _ge_pitch; ++j) {
                 ge_ref_row[j] ^= ge_row[j];
             }
-
-            PeelRow * GF256_RESTRICT ref_row = &_peel_rows[ref_row_i];
-            const uint16_t ref_column_i = ref_row->Marks.Result.PeelColumn;
-
-            // If row is peeled:
-            if (ref_column_i != LIST_TERM)
-            {
-                // Generate temporary row block value:
-                CAT_DEBUG_ASSERT(ref_column_i < _recovery_rows);
-                uint8_t * GF256_RESTRICT temp_block_dest = _recovery_blocks + _block_bytes * ref_column_i;
-
-                // If referencing row is already copied to the recovery blocks:
-                if (ref_row->Marks.Result.IsCopied) {
-                    // Add this row block value to it
-                    gf256_add_mem(temp_block_dest, temp_block_src, _block_bytes);
-                }
-                else
-                {
-                    const uint8_t * GF256_RESTRICT block_src = _input_blocks + _block_bytes * ref_row_i;
-
-                    // If this is not the last block:
-                    if (ref_row_i != _block_count - 1) {
-                        // Add this row block value with message block to it (optimization)
-                        gf256_addset_mem(temp_block_dest, temp_block_src, block_src, _block_bytes);
-                    }
-                    else
-                    {
-                        // Add with zero padding
-                        gf256_addset_mem(temp_block_dest, temp_block_src, block_src, _input_final_bytes);
-
-                        CAT_DEBUG_ASSERT(_block_bytes >= _input_final_bytes);
-                        memcpy(
-                            temp_block_dest + _input_final_bytes,
-                            temp_block_src + _input_final_bytes,
-                            _block_bytes - _input_final_bytes);
-                    }
-
-                    ref_row->Marks.Result.IsCopied = 1;
-                }
-
-                CAT_IF_ROWOP(++rowops;)
-            } // end if referencing row is peeled
-
         } // next referencing row
 
         CAT_IF_DUMP(cout << endl;)
 
     } // next peeled row
 
-    CAT_IF_ROWOP(cout << "PeelDiagonal used " << rowops << " row ops = "
-        << rowops / (double)_block_count << "*N" << endl;)
+    return peel_row_i;
 }
 
-void Codec::CopyDeferredRows()
+uint16_t Codec::PeelDiagonalValues(
+    uint16_t peel_row_i, ///< First peeled row to process
+    unsigned row_limit ///< Maximum rows to process, or 0 for all
+)
+{
+    CAT_IF_DUMP(cout << endl << "---- PeelDiagonalValues ----" << endl << endl;)
+
+    /*
+        This function optimizes the block value generation by combining the first
+        memcpy and memxor operations together into a three-way memxor if possible,
+        using the is_copied row member.
+    */
+
+    CAT_IF_ROWOP(unsigned rowops = 0;)
+
+    PeelRow * GF256_RESTRICT row;
+
+    // If starting a new pass:
+    if (peel_row_i == _peel_head_rows)
+    {
+        // Reset the copied flags so that this pass can be repeated
+        for (uint16_t reset_row_i = _peel_head_rows;
+            reset_row_i != LIST_TERM;
+            reset_row_i = row->NextRow)
+        {
+            row = &_peel_rows[reset_row_i];
+            row->Marks.Result.IsCopied = 0;
+        }
+    }
+
+    // For each peeled row in forward solution order:
+    for (unsigned rows = 0;
+        peel_row_i != LIST_TERM && (row_limit == 0 || rows < row_limit);
+        peel_row_i = row->NextRow, ++rows)
+    {
+        row = &_peel_rows[peel_row_i];
+
+        // Lookup peeling results
+        const uint16_t peel_column_i = row->Marks.Result.PeelColumn;
+
+        // Get pointer to output block
+        CAT_DEBUG_ASSERT(peel_column_i < _recovery_rows);
+        uint8_t * GF256_RESTRICT temp_block_src = _recovery_blocks + _block_pitch * peel_column_i;
+
+        // If row has not been copied yet:
+        if (!row->Marks.Result.IsCopied)
+        {
+            const uint8_t * GF256_RESTRICT block_src = GetInputBlock(peel_row_i);
+
+            // If this is not the last block:
+            if (peel_row_i != _block_count - 1) {
+                // Copy it directly to the output block
+                memcpy(temp_block_src, block_src, _block_bytes);
+            }
+            else
+            {
+                // Copy with zero padding
+                memcpy(temp_block_src, block_src, _input_final_bytes);
+                CAT_DEBUG_ASSERT(_block_bytes >= _input_final_bytes);
+                memset(temp_block_src + _input_final_bytes, 0, _block_bytes - _input_final_bytes);
+            }
+            CAT_IF_ROWOP(++rowops;)
+
+            CAT_IF_DUMP(cout << "-- Copied from " << peel_row_i <<
+                " because has not been copied yet.  Output block = " <<
+                (unsigned)temp_block_src[0] << endl;)
+
+            // Note that we do not need to set is_copied here because no
+            // further rows reference this one
+        }
+
+        const PeelRefs * GF256_RESTRICT refs = &_peel_col_refs[peel_column_i];
+        const uint16_t * GF256_RESTRICT referencingRows = refs->Rows;
+
+        // For each row that references this one:
+        for (unsigned i = 0, count = refs->RowCount; i < count; ++i)
+        {
+            const uint16_t ref_row_i = referencingRows[i];
+
+            // If it references the current row:
+            if (ref_row_i == peel_row_i) {
+                // Skip this row
+                continue;
+            }
+
+            PeelRow * GF256_RESTRICT ref_row = &_peel_rows[ref_row_i];
+            const uint16_t ref_column_i = ref_row->Marks.Result.PeelColumn;
+
+            // If row is deferred:
+            if (ref_column_i == LIST_TERM) {
+                // Its value is generated by InitializeColumnValues()
+                continue;
+            }
+
+            // Generate temporary row block value:
+            CAT_DEBUG_ASSERT(ref_column_i < _recovery_rows);
+            uint8_t * GF256_RESTRICT temp_block_dest = _recovery_blocks + _block_pitch * ref_column_i;
+
+            // If referencing row is already copied to the recovery blocks:
+            if (ref_row->Marks.Result.IsCopied) {
+                // Add this row block value to it
+                gf256_add_mem(temp_block_dest, temp_block_src, _block_bytes);
+            }
+            else
+            {
+                const uint8_t * GF256_RESTRICT block_src = GetInputBlock(ref_row_i);
+
+                // If this is not the last block:
+                if (ref_row_i != _block_count - 1) {
+                    // Add this row block value with message block to it (optimization)
+                    gf256_addset_mem(temp_block_dest, temp_block_src, block_src, _block_bytes);
+                }
+                else
+                {
+                    // Add with zero padding
+                    gf256_addset_mem(temp_block_dest, temp_block_src, block_src, _input_final_bytes);
+
+                    CAT_DEBUG_ASSERT(_block_bytes >= _input_final_bytes);
+                    memcpy(
+                        temp_block_dest + _input_final_bytes,
+                        temp_block_src + _input_final_bytes,
+                        _block_bytes - _input_final_bytes);
+                }
+
+                ref_row->Marks.Result.IsCopied = 1;
+            }
+
+            CAT_IF_ROWOP(++rowops;)
+        } // next referencing row
+
+    } // next peeled row
+
+    CAT_IF_ROWOP(cout << "PeelDiagonalValues used " << rowops << " row ops = "
+        << rowops / (double)_block_count << "*N" << endl;)
+
+    return peel_row_i;
+}
+
+void Codec::CopyDeferredRows()
 {
     CAT_IF_DUMP(cout << endl << "---- CopyDeferredRows ----" << endl << endl;)
 
@@ -662,7 +1164,8 @@ void Codec::CopyDeferredRows()
     {
         CAT_IF_DUMP(cout << "Peeled row " << defer_row_i << " for GE row " << ge_row_i << endl;)
 
-        // Get Compress matrix row
+        // Get Compress matrix row, which has its mixing columns set
+        CAT_DEBUG_ASSERT(_compress_dirty[defer_row_i]);
         uint64_t * GF256_RESTRICT compress_row = _compress_matrix + _ge_pitch * defer_row_i;
 
         // Copy Compress row to GE row
@@ -1471,7 +1974,7 @@ void Codec::InitializeColumnValues()
         const uint16_t dest_column_i = _ge_col_map[pivot_i];
         const uint16_t ge_row_i = _pivots[pivot_i];
         CAT_DEBUG_ASSERT(dest_column_i < _recovery_rows);
-        uint8_t * GF256_RESTRICT buffer_dest = _recovery_blocks + _block_bytes * dest_column_i;
+        uint8_t * GF256_RESTRICT buffer_dest = _recovery_blocks + _block_pitch * dest_column_i;
 
         CAT_IF_DUMP(cout << "Pivot " << pivot_i << " solving column " << dest_column_i << " with GE row " << ge_row_i << " : ";)
 
@@ -1493,7 +1996,7 @@ void Codec::InitializeColumnValues()
 
         // Look up row and input value for GE row
         const uint16_t row_i = _ge_row_map[ge_row_i];
-        const uint8_t * GF256_RESTRICT combo = _input_blocks + _block_bytes * row_i;
+        const uint8_t * GF256_RESTRICT combo = GetInputBlock(row_i);
         PeelRow * GF256_RESTRICT row = &_peel_rows[row_i];
 
         CAT_IF_DUMP(cout << "[" << (unsigned)combo[0] << "]";)
@@ -1509,7 +2012,7 @@ void Codec::InitializeColumnValues()
             combo = 0;
         }
 
-        PeelRowIterator iter(row->Params, _block_count, _block_next_prime);
+        CachedPeelRowIterator iter(GetCachedRow(row_i), row->Params, _block_count, _block_next_prime);
 
         // Eliminate peeled columns:
         do
@@ -1522,7 +2025,7 @@ void Codec::InitializeColumnValues()
             if (column->Mark == MARK_PEEL)
             {
                 CAT_DEBUG_ASSERT(column_i < _recovery_rows);
-                const uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_bytes * column_i;
+                const uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_pitch * column_i;
 
                 // If combo unused:
                 if (!combo) {
@@ -1581,7 +2084,7 @@ void Codec::MultiplyDenseValues()
 
     const uint16_t dense_count = _dense_count;
     CAT_DEBUG_ASSERT((unsigned)(_block_count + _mix_count) < _recovery_rows);
-    uint8_t * GF256_RESTRICT temp_block = _recovery_blocks + _block_bytes * (_block_count + _mix_count);
+    uint8_t * GF256_RESTRICT temp_block = _recovery_blocks + _block_pitch * (_block_count + _mix_count);
     const uint8_t * GF256_RESTRICT source_block = _recovery_blocks;
     const PeelColumn * GF256_RESTRICT column = _peel_cols;
     uint16_t rows[CAT_MAX_DENSE_ROWS];
@@ -1590,7 +2093,7 @@ void Codec::MultiplyDenseValues()
 
     // For each block of columns:
     for (uint16_t column_i = 0; column_i < block_count; column_i += dense_count,
-        column += dense_count, source_block += _block_bytes * dense_count)
+        column += dense_count, source_block += _block_pitch * dense_count)
     {
         unsigned max_x = dense_count;
 
@@ -1627,7 +2130,7 @@ void Codec::MultiplyDenseValues()
             {
                 CAT_IF_DUMP(cout << " " << column_i + bit_i;)
 
-                const uint8_t * GF256_RESTRICT src = source_block + _block_bytes * bit_i;
+                const uint8_t * GF256_RESTRICT src = source_block + _block_pitch * bit_i;
 
                 // If no combo used yet:
                 if (!combo) {
@@ -1673,7 +2176,7 @@ void Codec::MultiplyDenseValues()
             if (dest_column_i != LIST_TERM)
             {
                 CAT_DEBUG_ASSERT(dest_column_i < _recovery_rows);
-                gf256_add_mem(_recovery_blocks + _block_bytes * dest_column_i, temp_block, _block_bytes);
+                gf256_add_mem(_recovery_blocks + _block_pitch * dest_column_i, temp_block, _block_bytes);
                 CAT_IF_ROWOP(++rowops;)
             }
         }
@@ -1704,8 +2207,8 @@ void Codec::MultiplyDenseValues()
 
                     gf256_add2_mem(
                         temp_block,
-                        source_block + _block_bytes * bit0,
-                        source_block + _block_bytes * bit1,
+                        source_block + _block_pitch * bit0,
+                        source_block + _block_pitch * bit1,
                         _block_bytes);
                 }
                 else
@@ -1714,7 +2217,7 @@ void Codec::MultiplyDenseValues()
 
                     gf256_add_mem(
                         temp_block,
-                        source_block + _block_bytes * bit0,
+                        source_block + _block_pitch * bit0,
                         _block_bytes);
                 }
                 CAT_IF_ROWOP(++rowops;)
@@ -1725,7 +2228,7 @@ void Codec::MultiplyDenseValues()
 
                 gf256_add_mem(
                     temp_block,
-                    source_block + _block_bytes * bit1,
+                    source_block + _block_pitch * bit1,
                     _block_bytes);
 
                 CAT_IF_ROWOP(++rowops;)
@@ -1741,7 +2244,7 @@ void Codec::MultiplyDenseValues()
                 CAT_DEBUG_ASSERT(dest_column_i < _recovery_rows);
 
                 gf256_add_mem(
-                    _recovery_blocks + _block_bytes * dest_column_i,
+                    _recovery_blocks + _block_pitch * dest_column_i,
                     temp_block,
                     _block_bytes);
 
@@ -1776,8 +2279,8 @@ void Codec::MultiplyDenseValues()
 
                     gf256_add2_mem(
                         temp_block,
-                        source_block + _block_bytes * bit0,
-                        source_block + _block_bytes * bit1,
+                        source_block + _block_pitch * bit0,
+                        source_block + _block_pitch * bit1,
                         _block_bytes);
                 }
                 else
@@ -1788,7 +2291,7 @@ void Codec::MultiplyDenseValues()
 
                     gf256_add_mem(
                         temp_block,
-                        source_block + _block_bytes * bit0,
+                        source_block + _block_pitch * bit0,
                         _block_bytes);
                 }
 
@@ -1802,7 +2305,7 @@ void Codec::MultiplyDenseValues()
 
                 gf256_add_mem(
                     temp_block,
-                    source_block + _block_bytes * bit1,
+                    source_block + _block_pitch * bit1,
                     _block_bytes);
 
                 CAT_IF_ROWOP(++rowops;)
@@ -1818,7 +2321,7 @@ void Codec::MultiplyDenseValues()
                 CAT_DEBUG_ASSERT(dest_column_i < _recovery_rows);
 
                 gf256_add_mem(
-                    _recovery_blocks + _block_bytes * dest_column_i,
+                    _recovery_blocks + _block_pitch * dest_column_i,
                     temp_block,
                     _block_bytes);
 
@@ -1887,7 +2390,7 @@ void Codec::AddSubdiagonalValues()
         uint8_t * GF256_RESTRICT column_src = _recovery_blocks;
         uint32_t jj = 1;
 
-        for (uint32_t count = _block_count; count > 0; --count, ++column, column_src += _block_bytes)
+        for (uint32_t count = _block_count; count > 0; --count, ++column, column_src += _block_pitch)
         {
             // If column is peeled:
             if (column->Mark == MARK_PEEL)
@@ -1925,7 +2428,7 @@ void Codec::AddSubdiagonalValues()
             for (unsigned src_pivot_i = pivot_i; src_pivot_i < final_i; ++src_pivot_i)
             {
                 CAT_DEBUG_ASSERT(_ge_col_map[src_pivot_i] < _recovery_rows);
-                uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_bytes * _ge_col_map[src_pivot_i];
+                uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_pitch * _ge_col_map[src_pivot_i];
 
                 CAT_IF_DUMP(cout << "Back-substituting small triangle from pivot " << src_pivot_i << "[" << (unsigned)src[0] << "] :";)
 
@@ -1944,7 +2447,7 @@ void Codec::AddSubdiagonalValues()
                         CAT_DEBUG_ASSERT(dest_col_i < _block_count + _mix_count);
 
                         CAT_DEBUG_ASSERT(dest_col_i < _recovery_rows);
-                        uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_bytes * dest_col_i;
+                        uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_pitch * dest_col_i;
 
                         // Back-substitute
                         gf256_add_mem(dest, src, _block_bytes);
@@ -1964,15 +2467,15 @@ void Codec::AddSubdiagonalValues()
 
             // Generate window table: 2 bits
             CAT_DEBUG_ASSERT(_ge_col_map[pivot_i] < _recovery_rows);
-            win_table[1] = _recovery_blocks + _block_bytes * _ge_col_map[pivot_i];
+            win_table[1] = _recovery_blocks + _block_pitch * _ge_col_map[pivot_i];
             CAT_DEBUG_ASSERT(_ge_col_map[pivot_i + 1] < _recovery_rows);
-            win_table[2] = _recovery_blocks + _block_bytes * _ge_col_map[pivot_i + 1];
+            win_table[2] = _recovery_blocks + _block_pitch * _ge_col_map[pivot_i + 1];
             gf256_addset_mem(win_table[3], win_table[1], win_table[2], _block_bytes);
             CAT_IF_ROWOP(++rowops;)
 
             // Generate window table: 3 bits
             CAT_DEBUG_ASSERT(_ge_col_map[pivot_i + 2] < _recovery_rows);
-            win_table[4] = _recovery_blocks + _block_bytes * _ge_col_map[pivot_i + 2];
+            win_table[4] = _recovery_blocks + _block_pitch * _ge_col_map[pivot_i + 2];
             gf256_addset_mem(win_table[5], win_table[1], win_table[4], _block_bytes);
             gf256_addset_mem(win_table[6], win_table[2], win_table[4], _block_bytes);
             gf256_addset_mem(win_table[7], win_table[1], win_table[6], _block_bytes);
@@ -1980,7 +2483,7 @@ void Codec::AddSubdiagonalValues()
 
             // Generate window table: 4 bits
             CAT_DEBUG_ASSERT(_ge_col_map[pivot_i + 3] < _recovery_rows);
-            win_table[8] = _recovery_blocks + _block_bytes * _ge_col_map[pivot_i + 3];
+            win_table[8] = _recovery_blocks + _block_pitch * _ge_col_map[pivot_i + 3];
             for (unsigned ii = 1; ii < 8; ++ii) {
                 gf256_addset_mem(win_table[8 + ii], win_table[ii], win_table[8], _block_bytes);
             }
@@ -1990,7 +2493,7 @@ void Codec::AddSubdiagonalValues()
             if (w >= 5)
             {
                 CAT_DEBUG_ASSERT(_ge_col_map[pivot_i + 4] < _recovery_rows);
-                win_table[16] = _recovery_blocks + _block_bytes * _ge_col_map[pivot_i + 4];
+                win_table[16] = _recovery_blocks + _block_pitch * _ge_col_map[pivot_i + 4];
                 for (unsigned ii = 1; ii < 16; ++ii) {
                     gf256_addset_mem(win_table[16 + ii], win_table[ii], win_table[16], _block_bytes);
                 }
@@ -1999,7 +2502,7 @@ void Codec::AddSubdiagonalValues()
                 if (w >= 6)
                 {
                     CAT_DEBUG_ASSERT(_ge_col_map[pivot_i + 5] < _recovery_rows);
-                    win_table[32] = _recovery_blocks + _block_bytes * _ge_col_map[pivot_i + 5];
+                    win_table[32] = _recovery_blocks + _block_pitch * _ge_col_map[pivot_i + 5];
                     for (unsigned ii = 1; ii < 32; ++ii) {
                         gf256_addset_mem(win_table[32 + ii], win_table[ii], win_table[32], _block_bytes);
                     }
@@ -2008,7 +2511,7 @@ void Codec::AddSubdiagonalValues()
                     if (w >= 7)
                     {
                         CAT_DEBUG_ASSERT(_ge_col_map[pivot_i + 6] < _recovery_rows);
-                        win_table[64] = _recovery_blocks + _block_bytes * _ge_col_map[pivot_i + 6];
+                        win_table[64] = _recovery_blocks + _block_pitch * _ge_col_map[pivot_i + 6];
                         for (unsigned ii = 1; ii < 64; ++ii) {
                             gf256_addset_mem(win_table[64 + ii], win_table[ii], win_table[64], _block_bytes);
                         }
@@ -2045,7 +2548,7 @@ void Codec::AddSubdiagonalValues()
                         CAT_IF_DUMP(cout << "Adding window table " << win_bits << " to pivot " << ge_below_i << endl;)
 
                         // Back-substitute
-                        uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[ge_below_i];
+                        uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_pitch * _ge_col_map[ge_below_i];
                         gf256_add_mem(dest, win_table[win_bits], _block_bytes);
                         CAT_IF_ROWOP(++rowops;)
                     }
@@ -2074,7 +2577,7 @@ void Codec::AddSubdiagonalValues()
                         CAT_IF_DUMP(cout << "Adding window table " << win_bits << " to pivot " << ge_below_i << endl;)
 
                         // Back-substitute
-                        uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[ge_below_i];
+                        uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_pitch * _ge_col_map[ge_below_i];
                         gf256_add_mem(dest, win_table[win_bits], _block_bytes);
                         CAT_IF_ROWOP(++rowops;)
                     }
@@ -2118,7 +2621,7 @@ void Codec::AddSubdiagonalValues()
         const unsigned column_i = _ge_col_map[ge_column_i];
         const uint16_t ge_row_i = _pivots[ge_column_i];
         CAT_DEBUG_ASSERT(column_i < _recovery_rows);
-        uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_bytes * column_i;
+        uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_pitch * column_i;
 
         CAT_IF_DUMP(cout << "Pivot " << ge_column_i << " solving column " << column_i << "[" << (unsigned)dest[0] << "] with GE row " << ge_row_i << " :";)
 
@@ -2141,7 +2644,7 @@ void Codec::AddSubdiagonalValues()
 
                 // Look up data source
                 CAT_DEBUG_ASSERT(_ge_col_map[sub_i] < _recovery_rows);
-                const uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_bytes * _ge_col_map[sub_i];
+                const uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_pitch * _ge_col_map[sub_i];
 
                 gf256_muladd_mem(dest, code_value, src, _block_bytes);
 
@@ -2174,7 +2677,7 @@ void Codec::AddSubdiagonalValues()
             {
                 const unsigned column_j = _ge_col_map[bit_j];
                 CAT_DEBUG_ASSERT(column_j < _recovery_rows);
-                const uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_bytes * column_j;
+                const uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_pitch * column_j;
 
                 // Add pivot for non-zero bit to destination row value
                 gf256_add_mem(dest, src, _block_bytes);
@@ -2202,7 +2705,7 @@ void Codec::BackSubstituteAboveDiagonal()
 {
     CAT_IF_DUMP(cout << endl << "---- BackSubstituteAboveDiagonal ----" << endl << endl;)
 
-    CAT_IF_ROWOP(unsigned rowops = 0; unsigned heavyops = 0;)
+    CAT_IF_ROWOP(unsigned rowops = 0; unsigned heavyops = 0; unsigned prefetched = 0;)
 
     const unsigned pivot_count = _defer_count + _mix_count;
     unsigned pivot_i = pivot_count - 1;
@@ -2235,6 +2738,9 @@ void Codec::BackSubstituteAboveDiagonal()
 
         CAT_IF_DUMP(cout << "Activating windowed back-substitution with initial window " << w << endl;)
 
+        // Pivots to look ahead when prefetching window table destinations
+        static const unsigned kPrefetchPivots = 4;
+
         // Use the first few peel column values as window table space
         // NOTE: The peeled column values were previously used up until this point,
         // but now they are unused, and so they can be reused for temporary space.
@@ -2244,7 +2750,7 @@ void Codec::BackSubstituteAboveDiagonal()
         uint32_t jj = 1;
 
         // For each original data column:
-        for (unsigned count = _block_count; count > 0; --count, ++column, column_src += _block_bytes)
+        for (unsigned count = _block_count; count > 0; --count, ++column, column_src += _block_pitch)
         {
             // If column is peeled:
             if (column->Mark == MARK_PEEL)
@@ -2281,7 +2787,7 @@ void Codec::BackSubstituteAboveDiagonal()
             for (unsigned src_pivot_i = pivot_i; src_pivot_i > backsub_i; --src_pivot_i)
             {
                 CAT_DEBUG_ASSERT(_ge_col_map[src_pivot_i] < _recovery_rows);
-                uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_bytes * _ge_col_map[src_pivot_i];
+                uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_pitch * _ge_col_map[src_pivot_i];
 
                 const uint16_t ge_row_i = _pivots[src_pivot_i];
 
@@ -2331,7 +2837,7 @@ void Codec::BackSubstituteAboveDiagonal()
                         }
 
                         CAT_DEBUG_ASSERT(_ge_col_map[dest_pivot_i] < _recovery_rows);
-                        uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[dest_pivot_i];
+                        uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_pitch * _ge_col_map[dest_pivot_i];
 
                         // Back-substitute
                         gf256_muladd_mem(dest, code_value, src, _block_bytes);
@@ -2345,7 +2851,7 @@ void Codec::BackSubstituteAboveDiagonal()
                         if (ge_row[_ge_pitch * dest_row_i] & ge_mask)
                         {
                             CAT_DEBUG_ASSERT(_ge_col_map[dest_pivot_i] < _recovery_rows);
-                            uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[dest_pivot_i];
+                            uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_pitch * _ge_col_map[dest_pivot_i];
 
                             // Back-substitute
                             gf256_add_mem(dest, src, _block_bytes);
@@ -2382,7 +2888,7 @@ void Codec::BackSubstituteAboveDiagonal()
                 if (code_value != 1)
                 {
                     CAT_DEBUG_ASSERT(_ge_col_map[backsub_i] < _recovery_rows);
-                    uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_bytes * _ge_col_map[backsub_i];
+                    uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_pitch * _ge_col_map[backsub_i];
 
                     gf256_div_mem(src, src, code_value, _block_bytes);
                     CAT_IF_ROWOP(++heavyops;)
@@ -2393,15 +2899,15 @@ void Codec::BackSubstituteAboveDiagonal()
 
             // Generate window table: 2 bits
             CAT_DEBUG_ASSERT(_ge_col_map[backsub_i] < _recovery_rows);
-            win_table[1] = _recovery_blocks + _block_bytes * _ge_col_map[backsub_i];
+            win_table[1] = _recovery_blocks + _block_pitch * _ge_col_map[backsub_i];
             CAT_DEBUG_ASSERT(_ge_col_map[backsub_i + 1] < _recovery_rows);
-            win_table[2] = _recovery_blocks + _block_bytes * _ge_col_map[backsub_i + 1];
+            win_table[2] = _recovery_blocks + _block_pitch * _ge_col_map[backsub_i + 1];
             gf256_addset_mem(win_table[3], win_table[1], win_table[2], _block_bytes);
             CAT_IF_ROWOP(++rowops;)
 
             // Generate window table: 3 bits
             CAT_DEBUG_ASSERT(_ge_col_map[backsub_i + 2] < _recovery_rows);
-            win_table[4] = _recovery_blocks + _block_bytes * _ge_col_map[backsub_i + 2];
+            win_table[4] = _recovery_blocks + _block_pitch * _ge_col_map[backsub_i + 2];
             gf256_addset_mem(win_table[5], win_table[1], win_table[4], _block_bytes);
             gf256_addset_mem(win_table[6], win_table[2], win_table[4], _block_bytes);
             gf256_addset_mem(win_table[7], win_table[1], win_table[6], _block_bytes);
@@ -2409,7 +2915,7 @@ void Codec::BackSubstituteAboveDiagonal()
 
             // Generate window table: 4 bits
             CAT_DEBUG_ASSERT(_ge_col_map[backsub_i + 3] < _recovery_rows);
-            win_table[8] = _recovery_blocks + _block_bytes * _ge_col_map[backsub_i + 3];
+            win_table[8] = _recovery_blocks + _block_pitch * _ge_col_map[backsub_i + 3];
             for (unsigned ii = 1; ii < 8; ++ii) {
                 gf256_addset_mem(win_table[8 + ii], win_table[ii], win_table[8], _block_bytes);
             }
@@ -2419,7 +2925,7 @@ void Codec::BackSubstituteAboveDiagonal()
             if (w >= 5)
             {
                 CAT_DEBUG_ASSERT(_ge_col_map[backsub_i + 4] < _recovery_rows);
-                win_table[16] = _recovery_blocks + _block_bytes * _ge_col_map[backsub_i + 4];
+                win_table[16] = _recovery_blocks + _block_pitch * _ge_col_map[backsub_i + 4];
                 for (unsigned ii = 1; ii < 16; ++ii) {
                     gf256_addset_mem(win_table[16 + ii], win_table[ii], win_table[16], _block_bytes);
                 }
@@ -2428,7 +2934,7 @@ void Codec::BackSubstituteAboveDiagonal()
                 if (w >= 6)
                 {
                     CAT_DEBUG_ASSERT(_ge_col_map[backsub_i + 5] < _recovery_rows);
-                    win_table[32] = _recovery_blocks + _block_bytes * _ge_col_map[backsub_i + 5];
+                    win_table[32] = _recovery_blocks + _block_pitch * _ge_col_map[backsub_i + 5];
                     for (unsigned ii = 1; ii < 32; ++ii) {
                         gf256_addset_mem(win_table[32 + ii], win_table[ii], win_table[32], _block_bytes);
                     }
@@ -2437,7 +2943,7 @@ void Codec::BackSubstituteAboveDiagonal()
                     if (w >= 7)
                     {
                         CAT_DEBUG_ASSERT(_ge_col_map[backsub_i + 6] < _recovery_rows);
-                        win_table[64] = _recovery_blocks + _block_bytes * _ge_col_map[backsub_i + 6];
+                        win_table[64] = _recovery_blocks + _block_pitch * _ge_col_map[backsub_i + 6];
                         for (unsigned ii = 1; ii < 64; ++ii) {
                             gf256_addset_mem(win_table[64 + ii], win_table[ii], win_table[64], _block_bytes);
                         }
@@ -2462,7 +2968,7 @@ void Codec::BackSubstituteAboveDiagonal()
                     }
 
                     CAT_DEBUG_ASSERT(_ge_col_map[ge_above_i] < _recovery_rows);
-                    uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[ge_above_i];
+                    uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_pitch * _ge_col_map[ge_above_i];
                     unsigned ge_column_j = backsub_i;
 
                     // If the first column of window is not heavy:
@@ -2481,7 +2987,7 @@ void Codec::BackSubstituteAboveDiagonal()
                             if (nonzero)
                             {
                                 CAT_DEBUG_ASSERT(_ge_col_map[ge_column_j] < _recovery_rows);
-                                const uint8_t *src = _recovery_blocks + _block_bytes * _ge_col_map[ge_column_j];
+                                const uint8_t *src = _recovery_blocks + _block_pitch * _ge_col_map[ge_column_j];
 
                                 gf256_add_mem(dest, src, _block_bytes);
 
@@ -2512,7 +3018,7 @@ void Codec::BackSubstituteAboveDiagonal()
                         }
 
                         CAT_DEBUG_ASSERT(_ge_col_map[ge_column_j] < _recovery_rows);
-                        const uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_bytes * _ge_col_map[ge_column_j];
+                        const uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_pitch * _ge_col_map[ge_column_j];
 
                         // Back-substitute
                         gf256_muladd_mem(dest, code_value, src, _block_bytes);
@@ -2538,6 +3044,15 @@ void Codec::BackSubstituteAboveDiagonal()
                 {
                     const unsigned ge_row_k = *pivot_row++;
 
+#if defined(CAT_PREFETCH_BLOCKS)
+                    // Most rows take an XOR, so fetch a destination ahead
+                    if (above_pivot_i + kPrefetchPivots < backsub_i)
+                    {
+                        PrefetchBlock(_recovery_blocks + _block_pitch * _ge_col_map[above_pivot_i + kPrefetchPivots], _block_bytes);
+                        CAT_IF_ROWOP(++prefetched;)
+                    }
+#endif // CAT_PREFETCH_BLOCKS
+
                     // If pivot row is heavy:
                     if (ge_row_k >= window_row_limit) {
                         continue; // Skip it
@@ -2553,7 +3068,7 @@ void Codec::BackSubstituteAboveDiagonal()
                         CAT_IF_DUMP(cout << "Adding window table " << win_bits << " to pivot " << above_pivot_i << endl;)
 
                         CAT_DEBUG_ASSERT(_ge_col_map[above_pivot_i] < _recovery_rows);
-                        uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[above_pivot_i];
+                        uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_pitch * _ge_col_map[above_pivot_i];
 
                         // Back-substitute
                         gf256_add_mem(dest, win_table[win_bits], _block_bytes);
@@ -2571,6 +3086,15 @@ void Codec::BackSubstituteAboveDiagonal()
                 {
                     const unsigned ge_row_k = *pivot_row++;
 
+#if defined(CAT_PREFETCH_BLOCKS)
+                    // Most rows take an XOR, so fetch a destination ahead
+                    if (above_pivot_i + kPrefetchPivots < backsub_i)
+                    {
+                        PrefetchBlock(_recovery_blocks + _block_pitch * _ge_col_map[above_pivot_i + kPrefetchPivots], _block_bytes);
+                        CAT_IF_ROWOP(++prefetched;)
+                    }
+#endif // CAT_PREFETCH_BLOCKS
+
                     // If pivot row is heavy:
                     if (ge_row_k >= window_row_limit) {
                         continue; // Skip it
@@ -2586,7 +3110,7 @@ void Codec::BackSubstituteAboveDiagonal()
                         CAT_IF_DUMP(cout << "Adding window table " << win_bits << " to pivot " << above_pivot_i << endl;)
 
                         CAT_DEBUG_ASSERT(_ge_col_map[above_pivot_i] < _recovery_rows);
-                        uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[above_pivot_i];
+                        uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_pitch * _ge_col_map[above_pivot_i];
 
                         // Back-substitute
                         gf256_add_mem(dest, win_table[win_bits], _block_bytes);
@@ -2630,7 +3154,7 @@ void Codec::BackSubstituteAboveDiagonal()
     {
         // Calculate source
         CAT_DEBUG_ASSERT(_ge_col_map[pivot_i] < _recovery_rows);
-        uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_bytes * _ge_col_map[pivot_i];
+        uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_pitch * _ge_col_map[pivot_i];
 
         const uint16_t ge_row_i = _pivots[pivot_i];
 
@@ -2679,7 +3203,7 @@ void Codec::BackSubstituteAboveDiagonal()
                 }
 
                 CAT_DEBUG_ASSERT(_ge_col_map[ge_up_i] < _recovery_rows);
-                uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[ge_up_i];
+                uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_pitch * _ge_col_map[ge_up_i];
 
                 // Back-substitute
                 gf256_muladd_mem(dest, code_value, src, _block_bytes);
@@ -2698,7 +3222,7 @@ void Codec::BackSubstituteAboveDiagonal()
                 if (ge_row[_ge_pitch * up_row_i] & ge_mask)
                 {
                     CAT_DEBUG_ASSERT(_ge_col_map[ge_up_i] < _recovery_rows);
-                    uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_bytes * _ge_col_map[ge_up_i];
+                    uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_pitch * _ge_col_map[ge_up_i];
 
                     // Back-substitute
                     gf256_add_mem(dest, src, _block_bytes);
@@ -2719,123 +3243,203 @@ void Codec::BackSubstituteAboveDiagonal()
         CAT_IF_DUMP(cout << endl;)
     }
 
-    CAT_IF_ROWOP(cout << "BackSubstituteAboveDiagonal used " << rowops << " row ops = " << rowops / (double)_block_count << "*N and " << heavyops << " heavy ops" << endl;)
+    CAT_IF_ROWOP(cout << "BackSubstituteAboveDiagonal used " << rowops << " row ops = " << rowops / (double)_block_count << "*N and " << heavyops << " heavy ops, and prefetched " << prefetched << " blocks" << endl;)
 }
 
-void Codec::Substitute()
+unsigned Codec::SubstituteRow(
+    uint16_t row_i ///< Peeled row to regenerate
+)
 {
-    CAT_IF_DUMP(cout << endl << "---- Substitute ----" << endl << endl;)
+    const PeelRow * GF256_RESTRICT row = &_peel_rows[row_i];
+    unsigned rowops = 0;
 
-    CAT_IF_ROWOP(uint32_t rowops = 0;)
+    const uint16_t dest_column_i = row->Marks.Result.PeelColumn;
+    CAT_DEBUG_ASSERT(dest_column_i < _recovery_rows);
+    uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_pitch * dest_column_i;
 
-    PeelRow * GF256_RESTRICT row;
+    CAT_IF_DUMP(cout << "Generating column " << dest_column_i << ":";)
 
-    // For each column that has been peeled:
-    for (uint16_t row_i = _peel_head_rows; row_i != LIST_TERM; row_i = row->NextRow)
-    {
-        row = &_peel_rows[row_i];
+    const uint8_t * GF256_RESTRICT input_src = GetInputBlock(row_i);
+    CAT_IF_DUMP(cout << " " << row_i << ":[" << (unsigned)input_src[0] << "]";)
 
-        const uint16_t dest_column_i = row->Marks.Result.PeelColumn;
-        CAT_DEBUG_ASSERT(dest_column_i < _recovery_rows);
-        uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_bytes * dest_column_i;
+    const uint16_t * GF256_RESTRICT cached = GetCachedRow(row_i);
+    const RowMixIterator mix(cached, row->Params, _mix_count, _mix_next_prime);
+
+    // Set up mixing column generator
+    CAT_DEBUG_ASSERT((unsigned)(_block_count + mix.Columns[0]) < _recovery_rows);
+    const uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_pitch * (_block_count + mix.Columns[0]);
 
-        CAT_IF_DUMP(cout << "Generating column " << dest_column_i << ":";)
+    // If copying from final block:
+    if (row_i != _block_count - 1) {
+        gf256_addset_mem(dest, src, input_src, _block_bytes);
+    }
+    else
+    {
+        gf256_addset_mem(dest, src, input_src, _input_final_bytes);
+        memcpy(
+            dest + _input_final_bytes,
+            src + _input_final_bytes,
+            _block_bytes - _input_final_bytes);
+    }
+    ++rowops;
 
-        const uint8_t * GF256_RESTRICT input_src = _input_blocks + _block_bytes * row_i;
-        CAT_IF_DUMP(cout << " " << row_i << ":[" << (unsigned)input_src[0] << "]";)
+    CAT_DEBUG_ASSERT((unsigned)(_block_count + mix.Columns[1]) < _recovery_rows);
+    const uint8_t * GF256_RESTRICT src0 = _recovery_blocks + _block_pitch * (_block_count + mix.Columns[1]);
+    CAT_DEBUG_ASSERT((unsigned)(_block_count + mix.Columns[2]) < _recovery_rows);
+    const uint8_t * GF256_RESTRICT src1 = _recovery_blocks + _block_pitch * (_block_count + mix.Columns[2]);
 
-        const RowMixIterator mix(row->Params, _mix_count, _mix_next_prime);
+    // Add next two mixing columns in
+    gf256_add2_mem(dest, src0, src1, _block_bytes);
 
-        // Set up mixing column generator
-        CAT_DEBUG_ASSERT((unsigned)(_block_count + mix.Columns[0]) < _recovery_rows);
-        const uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_bytes * (_block_count + mix.Columns[0]);
+    ++rowops;
 
-        // If copying from final block:
-        if (row_i != _block_count - 1) {
-            gf256_addset_mem(dest, src, input_src, _block_bytes);
-        }
-        else
-        {
-            gf256_addset_mem(dest, src, input_src, _input_final_bytes);
-            memcpy(
-                dest + _input_final_bytes,
-                src + _input_final_bytes,
-                _block_bytes - _input_final_bytes);
-        }
-        CAT_IF_ROWOP(++rowops;)
+    // If at least two peeling columns are set:
+    if (row->Params.PeelCount >= 2) // common case:
+    {
+        CachedPeelRowIterator iter(cached, row->Params, _block_count, _block_next_prime);
 
-        CAT_DEBUG_ASSERT((unsigned)(_block_count + mix.Columns[1]) < _recovery_rows);
-        const uint8_t * GF256_RESTRICT src0 = _recovery_blocks + _block_bytes * (_block_count + mix.Columns[1]);
-        CAT_DEBUG_ASSERT((unsigned)(_block_count + mix.Columns[2]) < _recovery_rows);
-        const uint8_t * GF256_RESTRICT src1 = _recovery_blocks + _block_bytes * (_block_count + mix.Columns[2]);
+        const uint16_t column_0 = iter.GetColumn();
+        iter.Iterate();
+        const uint16_t column_1 = iter.GetColumn();
 
-        // Add next two mixing columns in
-        gf256_add2_mem(dest, src0, src1, _block_bytes);
+        // Common case:
+        if (column_0 != dest_column_i)
+        {
+            CAT_DEBUG_ASSERT(column_0 < _recovery_rows);
+            const uint8_t * GF256_RESTRICT peel0 = _recovery_blocks + _block_pitch * column_0;
 
-        CAT_IF_ROWOP(++rowops;)
+            // Common case:
+            if (column_1 != dest_column_i) {
+                CAT_DEBUG_ASSERT(column_1 < _recovery_rows);
+                gf256_add2_mem(dest, peel0, _recovery_blocks + _block_pitch * column_1, _block_bytes);
+            }
+            else {
+                gf256_add_mem(dest, peel0, _block_bytes);
+            }
+        }
+        else {
+            CAT_DEBUG_ASSERT(column_1 < _recovery_rows);
+            gf256_add_mem(dest, _recovery_blocks + _block_pitch * column_1, _block_bytes);
+        }
+        ++rowops;
 
-        // If at least two peeling columns are set:
-        if (row->Params.PeelCount >= 2) // common case:
+        // For each remaining column:
+        while (iter.Iterate())
         {
-            PeelRowIterator iter(row->Params, _block_count, _block_next_prime);
+            const uint16_t column_i = iter.GetColumn();
+            CAT_DEBUG_ASSERT(column_i < _recovery_rows);
+            const uint8_t * GF256_RESTRICT peel_src = _recovery_blocks + _block_pitch * column_i;
 
-            const uint16_t column_0 = iter.GetColumn();
-            iter.Iterate();
-            const uint16_t column_1 = iter.GetColumn();
+            CAT_IF_DUMP(cout << " " << column_i;)
 
-            // Common case:
-            if (column_0 != dest_column_i)
+            // If column is not the solved one:
+            if (column_i != dest_column_i)
             {
-                CAT_DEBUG_ASSERT(column_0 < _recovery_rows);
-                const uint8_t * GF256_RESTRICT peel0 = _recovery_blocks + _block_bytes * column_0;
-
-                // Common case:
-                if (column_1 != dest_column_i) {
-                    CAT_DEBUG_ASSERT(column_1 < _recovery_rows);
-                    gf256_add2_mem(dest, peel0, _recovery_blocks + _block_bytes * column_1, _block_bytes);
-                }
-                else {
-                    gf256_add_mem(dest, peel0, _block_bytes);
-                }
+                gf256_add_mem(dest, peel_src, _block_bytes);
+                ++rowops;
+                CAT_IF_DUMP(cout << "[" << (unsigned)peel_src[0] << "]";)
             }
             else {
-                CAT_DEBUG_ASSERT(column_1 < _recovery_rows);
-                gf256_add_mem(dest, _recovery_blocks + _block_bytes * column_1, _block_bytes);
+                CAT_IF_DUMP(cout << "*";)
             }
-            CAT_IF_ROWOP(++rowops;)
+        }
+    } // end if weight 2
 
-            // For each remaining column:
-            while (iter.Iterate())
-            {
-                const uint16_t column_i = iter.GetColumn();
-                CAT_DEBUG_ASSERT(column_i < _recovery_rows);
-                const uint8_t * GF256_RESTRICT peel_src = _recovery_blocks + _block_bytes * column_i;
+    CAT_IF_DUMP(cout << endl;)
 
-                CAT_IF_DUMP(cout << " " << column_i;)
+    return rowops;
+}
 
-                // If column is not the solved one:
-                if (column_i != dest_column_i)
-                {
-                    gf256_add_mem(dest, peel_src, _block_bytes);
-                    CAT_IF_ROWOP(++rowops;)
-                    CAT_IF_DUMP(cout << "[" << (unsigned)peel_src[0] << "]";)
-                }
-                else {
-                    CAT_IF_DUMP(cout << "*";)
-                }
-            }
-        } // end if weight 2
+unsigned Codec::PrefetchSubstituteRow(
+    uint16_t row_i ///< Peeled row to be regenerated soon
+) const
+{
+    const PeelRow * GF256_RESTRICT row = &_peel_rows[row_i];
 
-        CAT_IF_DUMP(cout << endl;)
+    PrefetchBlock(GetInputBlock(row_i), _block_bytes);
+
+    const uint16_t * GF256_RESTRICT cached = GetCachedRow(row_i);
+    const RowMixIterator mix(cached, row->Params, _mix_count, _mix_next_prime);
+    for (unsigned i = 0; i < RowMixIterator::kColumnCount; ++i) {
+        PrefetchBlock(_recovery_blocks + _block_pitch * (_block_count + mix.Columns[i]), _block_bytes);
     }
 
-    CAT_IF_ROWOP(cout << "Substitute used " << rowops << " row ops = " << rowops / (double)_block_count << "*N" << endl;)
+    // This includes the destination column, which is about to be written
+    CachedPeelRowIterator iter(cached, row->Params, _block_count, _block_next_prime);
+    do {
+        PrefetchBlock(_recovery_blocks + _block_pitch * iter.GetColumn(), _block_bytes);
+    } while (iter.Iterate());
+
+    return 1 + RowMixIterator::kColumnCount + row->Params.PeelCount;
 }
 
+uint16_t Codec::Substitute(
+    uint16_t row_i, ///< First peeled row to process
+    unsigned row_limit ///< Maximum rows to process, or 0 for all
+)
+{
+    CAT_IF_DUMP(cout << endl << "---- Substitute ----" << endl << endl;)
+
+    CAT_IF_ROWOP(uint32_t rowops = 0; uint32_t prefetched = 0;)
+
+#if defined(CAT_PREFETCH_BLOCKS)
+    const bool prefetch = _block_bytes >= kMinPrefetchRowBytes;
+#endif // CAT_PREFETCH_BLOCKS
+
+    // For each column that has been peeled:
+    for (unsigned rows = 0;
+        row_i != LIST_TERM && (row_limit == 0 || rows < row_limit);
+        row_i = _peel_rows[row_i].NextRow, ++rows)
+    {
+#if defined(CAT_PREFETCH_BLOCKS)
+        // Fetch the next row's blocks while this row is being summed
+        const uint16_t next_row_i = _peel_rows[row_i].NextRow;
+        if (prefetch && next_row_i != LIST_TERM)
+        {
+#if defined(CAT_DUMP_ROWOP_COUNTERS)
+            prefetched += PrefetchSubstituteRow(next_row_i);
+#else
+            PrefetchSubstituteRow(next_row_i);
+#endif
+        }
+#endif // CAT_PREFETCH_BLOCKS
+
+#if defined(CAT_DUMP_ROWOP_COUNTERS)
+        rowops += SubstituteRow(row_i);
+#else
+        SubstituteRow(row_i);
+#endif
+    }
+
+    CAT_IF_ROWOP(cout << "Substitute used " << rowops << " row ops = " << rowops / (double)_block_count << "*N and prefetched " << prefetched << " blocks one row ahead" << endl;)
+
+    return row_i;
+}
 
 //------------------------------------------------------------------------------
 // Setup
 
+#if defined(CAT_SMALL_N_MDS)
+
+/// Largest N to use the Cauchy code for, from ConfigureSmallN()
+static std::atomic<unsigned> m_SmallNMax(0);
+
+#endif // CAT_SMALL_N_MDS
+
+WirehairResult Codec::ConfigureSmallN(unsigned max_n)
+{
+#if defined(CAT_SMALL_N_MDS)
+    if (max_n > CAT_MDS_MAX_N) {
+        return Wirehair_InvalidInput;
+    }
+
+    m_SmallNMax = max_n;
+    return Wirehair_Success;
+#else
+    return (max_n == 0) ? Wirehair_Success : Wirehair_UnsupportedPlatform;
+#endif
+}
+
 void Codec::OverrideSeeds(
     uint16_t dense_count,
     uint16_t p_seed,
@@ -2860,6 +3464,7 @@ WirehairResult Codec::ChooseMatrix(
 
     // Calculate message block count
     _block_bytes = block_bytes;
+    _block_pitch = GetBlockPitch(block_bytes);
     _block_count = static_cast<uint16_t>((message_bytes + _block_bytes - 1) / _block_bytes);
     _block_next_prime = NextPrime16(_block_count);
 
@@ -2887,12 +3492,34 @@ WirehairResult Codec::ChooseMatrix(
     _mix_count = _dense_count + kHeavyRows;
     _mix_next_prime = NextPrime16(_mix_count);
 
+#if defined(CAT_SMALL_N_MDS)
+    // Small messages may use the Cauchy code, which has no mix columns.
+    // Overridden seeds are only used to study the Wirehair code
+    if (_small_n_choice == SmallNChoice::Configured) {
+        _mds = !_seed_override && _block_count <= m_SmallNMax.load();
+    }
+    else {
+        _mds = (_small_n_choice == SmallNChoice::Cauchy);
+        if (_mds && _block_count > CAT_MDS_MAX_N) {
+            return Wirehair_InvalidInput;
+        }
+    }
+    if (_mds)
+    {
+        _dense_count = 0;
+        _mix_count = 0;
+    }
+#endif // CAT_SMALL_N_MDS
+
     CAT_IF_DUMP(cout << "Mix count = " << _mix_count << " +Prime=" << _mix_next_prime << endl;)
 
     // Initialize lists
     _peel_head_rows = LIST_TERM;
     _peel_tail_rows = 0;
     _defer_head_rows = LIST_TERM;
+    _defer_head_columns = LIST_TERM;
+    _defer_count = 0;
+    _solve_stage = SolveStage_Idle;
 
     return Wirehair_Success;
 }
@@ -2901,21 +3528,43 @@ WirehairResult Codec::SolveMatrix()
 {
     // (1) Peeling
 
-    GreedyPeeling();
+    GreedyPeeling(0);
+
+    // (2) Compression
+
+    if (!SetupCompression()) {
+        return Wirehair_OOM;
+    }
+
+    PeelDiagonal(_peel_head_rows, 0);
+
+    // (3) Gaussian Elimination
+
+    if (!CompressAndTriangle()) {
+        return Wirehair_NeedMore;
+    }
+
+    return Wirehair_Success;
+}
 
+bool Codec::SetupCompression()
+{
     CAT_IF_DUMP( PrintPeeled(); )
     CAT_IF_DUMP( PrintDeferredRows(); )
     CAT_IF_DUMP( PrintDeferredColumns(); )
 
-    // (2) Compression
-
     if (!AllocateMatrix()) {
-        return Wirehair_OOM;
+        return false;
     }
 
     SetDeferredColumns();
     SetMixingColumnsForDeferredRows();
-    PeelDiagonal();
+
+    return true;
+}
+
+bool Codec::CompressAndTriangle()
+{
     CopyDeferredRows();
     MultiplyDenseRows();
     SetHeavyRows();
@@ -2939,7 +3588,7 @@ WirehairResult Codec::SolveMatrix()
         CAT_IF_DUMP( PrintGEMatrix(); )
         CAT_IF_DUMP( PrintExtraMatrix(); )
 
-        return Wirehair_NeedMore;
+        return false;
     }
 
 #if defined(CAT_DUMP_CODEC_DEBUG) || defined(CAT_DUMP_GE_MATRIX)
@@ -2948,36 +3597,200 @@ WirehairResult Codec::SolveMatrix()
     PrintExtraMatrix();
 #endif
 
-    return Wirehair_Success;
-}
-
-void Codec::GenerateRecoveryBlocks()
-{
-    InitializeColumnValues();
-    MultiplyDenseValues();
-    AddSubdiagonalValues();
-    BackSubstituteAboveDiagonal();
-    Substitute();
+    return true;
 }
 
-WirehairResult Codec::ResumeSolveMatrix(
-    const unsigned id, ///< Block ID
-    const void * GF256_RESTRICT data ///< Block data
-)
+WirehairResult Codec::SolveStep(unsigned budget_usec)
 {
-    CAT_IF_DUMP(cout << endl << "---- ResumeSolveMatrix ----" << endl << endl;)
+    /*
+        Each pass through the loop below does a bounded amount of work and
+        then checks the clock, so the budget may be overrun by roughly one
+        slice.  Triangle() and the GE value stages cannot be split up, so
+        each of those runs as a single slice.
+    */
 
-    if (!data) {
-        return Wirehair_InvalidInput;
-    }
+    static const unsigned kStepColumns = 4;
+    static const unsigned kStepRows = 64;
 
-    unsigned row_i, ge_row_i, new_pivot_i;
+    const std::chrono::steady_clock::time_point deadline =
+        std::chrono::steady_clock::now() + std::chrono::microseconds(budget_usec);
 
-    // If there is no room for it:
-    if (_row_count >= _block_count + _extra_count)
+    for (;;)
     {
-        const uint16_t first_heavy_row = _defer_count + _dense_count;
-
+        switch (_solve_stage)
+        {
+        case SolveStage_Peeling:
+            // If peeling is complete:
+            if (GreedyPeeling(kStepColumns))
+            {
+                if (!SetupCompression()) {
+                    _solve_stage = SolveStage_Idle;
+                    return Wirehair_OOM;
+                }
+                _solve_cursor = _peel_head_rows;
+                _solve_stage = SolveStage_Compress;
+            }
+            break;
+
+        case SolveStage_Compress:
+            _solve_cursor = PeelDiagonal(_solve_cursor, kStepRows);
+            if (_solve_cursor == LIST_TERM) {
+                _solve_stage = SolveStage_Triangle;
+            }
+            break;
+
+        case SolveStage_Triangle:
+            // If more rows are needed:
+            if (!CompressAndTriangle())
+            {
+                // Further rows are handled by ResumeSolveMatrix()
+                _solve_stage = SolveStage_Idle;
+
+                // Blocks that arrived during the solve may be enough
+                const WirehairResult result = ResumePendingBlocks();
+                if (result != Wirehair_Success) {
+                    return result;
+                }
+            }
+            _solve_cursor = _peel_head_rows;
+            _solve_stage = SolveStage_PeelValues;
+            break;
+
+        case SolveStage_PeelValues:
+            _solve_cursor = PeelDiagonalValues(_solve_cursor, kStepRows);
+            if (_solve_cursor == LIST_TERM) {
+                _solve_stage = SolveStage_GEValues;
+            }
+            break;
+
+        case SolveStage_GEValues:
+            InitializeColumnValues();
+            MultiplyDenseValues();
+            AddSubdiagonalValues();
+            BackSubstituteAboveDiagonal();
+            _solve_cursor = _peel_head_rows;
+            _solve_stage = SolveStage_Substitute;
+            break;
+
+        case SolveStage_Substitute:
+            _solve_cursor = Substitute(_solve_cursor, kStepRows);
+            if (_solve_cursor == LIST_TERM) {
+                _solve_stage = SolveStage_Idle;
+                _decode_complete = true;
+                return Wirehair_Success;
+            }
+            break;
+
+        default:
+            // No solve is pending
+            return Wirehair_InvalidInput;
+        }
+
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return Wirehair_InProgress;
+        }
+    }
+}
+
+void Codec::GenerateRecoveryBlocks()
+{
+#if defined(CAT_TILED_SOLVE)
+    const unsigned tile_bytes = GetSolveTileBytes();
+
+    // If blocks are too large to stay in cache between row ops:
+    if (_block_bytes > tile_bytes)
+    {
+        GenerateRecoveryTiles(tile_bytes);
+        return;
+    }
+#endif // CAT_TILED_SOLVE
+
+    GenerateRecoveryValues();
+}
+
+void Codec::GenerateRecoveryValues()
+{
+    PeelDiagonalValues(_peel_head_rows, 0);
+    InitializeColumnValues();
+    MultiplyDenseValues();
+    AddSubdiagonalValues();
+    BackSubstituteAboveDiagonal();
+    Substitute(_peel_head_rows, 0);
+}
+
+#if defined(CAT_TILED_SOLVE)
+
+unsigned Codec::GetSolveTileBytes() const
+{
+    // Recovery rows plus the input rows read by the peeled rows
+    const unsigned rows = _recovery_rows + _block_count;
+
+    unsigned tile_bytes = kSolveTileCacheBytes / rows;
+    tile_bytes -= tile_bytes % kBlockAlignBytes;
+
+    if (tile_bytes < kMinSolveTileBytes) {
+        tile_bytes = kMinSolveTileBytes;
+    }
+
+    return tile_bytes;
+}
+
+void Codec::GenerateRecoveryTiles(unsigned tile_bytes)
+{
+    CAT_IF_DUMP(cout << endl << "---- GenerateRecoveryTiles ----" << endl << endl;)
+
+    uint8_t * GF256_RESTRICT saved_recovery_blocks = _recovery_blocks;
+    const unsigned saved_block_bytes = _block_bytes;
+    const unsigned saved_input_final_bytes = _input_final_bytes;
+
+    // For each tile of the blocks:
+    for (unsigned offset = 0; offset < saved_block_bytes; offset += tile_bytes)
+    {
+        const unsigned remaining = saved_block_bytes - offset;
+        _block_bytes = (remaining < tile_bytes) ? remaining : tile_bytes;
+
+        // Bytes of the final input block that lie within this tile
+        if (saved_input_final_bytes <= offset) {
+            _input_final_bytes = 0;
+        }
+        else
+        {
+            const unsigned final_remaining = saved_input_final_bytes - offset;
+            _input_final_bytes = (final_remaining < _block_bytes) ? final_remaining : _block_bytes;
+        }
+
+        _recovery_blocks = saved_recovery_blocks + offset;
+        _input_offset = offset;
+
+        GenerateRecoveryValues();
+    }
+
+    _recovery_blocks = saved_recovery_blocks;
+    _input_offset = 0;
+    _block_bytes = saved_block_bytes;
+    _input_final_bytes = saved_input_final_bytes;
+}
+
+#endif // CAT_TILED_SOLVE
+
+WirehairResult Codec::ResumeSolveMatrix(
+    const unsigned id, ///< Block ID
+    const void * GF256_RESTRICT data ///< Block data
+)
+{
+    CAT_IF_DUMP(cout << endl << "---- ResumeSolveMatrix ----" << endl << endl;)
+
+    if (!data) {
+        return Wirehair_InvalidInput;
+    }
+
+    unsigned row_i, ge_row_i, new_pivot_i;
+
+    // If there is no room for it:
+    if (_row_count >= _block_count + _extra_count)
+    {
+        const uint16_t first_heavy_row = _defer_count + _dense_count;
+
         new_pivot_i = 0;
 
         // For each pivot in the list:
@@ -3030,7 +3843,7 @@ WirehairResult Codec::ResumeSolveMatrix(
     PeelRow * GF256_RESTRICT row = &_peel_rows[row_i];
     row->RecoveryId = id;
 
-    uint8_t * GF256_RESTRICT block_store_dest = _input_blocks + _block_bytes * row_i;
+    uint8_t * GF256_RESTRICT block_store_dest = GetInputBlock(row_i);
 
     // Copy new block to input blocks
     if (id != (unsigned)_block_count - 1) {
@@ -3307,155 +4120,532 @@ bool Codec::IsAllOriginalData()
 
 #endif // CAT_ALL_ORIGINAL
 
-WirehairResult Codec::ReconstructBlock(
-    const uint16_t block_id, ///< Block identifier
-    void * GF256_RESTRICT block_out, ///< Output block memory
-    uint32_t* bytes_out ///< Bytes written to output
-)
+#if defined(CAT_SMALL_N_MDS)
+
+/// Coefficient of message block y in Cauchy row x
+static uint8_t GetMdsCoefficient(uint8_t x, uint8_t y)
 {
-    CAT_IF_DUMP(cout << endl << "---- ReconstructBlock ----" << endl << endl;)
+    // Repair rows are at or above N and message blocks are below it, so
+    // x + y is never zero
+    return gf256_inv(x ^ y);
+}
 
-    // Validate input
-    if (!block_out || block_id >= _block_count)
+bool Codec::GetMdsCoefficients(
+    const uint32_t block_id,
+    uint8_t * coeffs_out
+) const
+{
+    const unsigned block_count = _block_count;
+
+    // Message blocks
+    if (block_id < block_count)
     {
-        *bytes_out = 0;
-        return Wirehair_InvalidInput;
+        memset(coeffs_out, 0, block_count);
+        coeffs_out[block_id] = 1;
+        return true;
     }
 
-#if defined(CAT_ALL_ORIGINAL)
-    // If decoder received only original data out of order:
-    if (_all_original)
+    // Cauchy rows
+    if (block_id < kMdsSparseFirstId)
     {
-        PeelRow * GF256_RESTRICT row = _peel_rows;
-        const uint8_t * GF256_RESTRICT src = _input_blocks;
-
-        // For each row that was received:
-        for (uint16_t row_i = 0, count = _row_count; row_i < count; ++row_i)
-        {
-            const uint32_t id = row[row_i].RecoveryId;
-
-            // If this is the id we seek:
-            if (id == block_id)
-            {
-                CAT_IF_DUMP(cout << "Copying received row " << id << endl;)
+        for (unsigned column_i = 0; column_i < block_count; ++column_i) {
+            coeffs_out[column_i] = GetMdsCoefficient(static_cast<uint8_t>(block_id), static_cast<uint8_t>(column_i));
+        }
+        return true;
+    }
 
-                const unsigned bytes = (id != (unsigned)_block_count - 1) ? _block_bytes : _output_final_bytes;
+    std::lock_guard<std::mutex> locker(_sparse_rows_lock);
 
-                memcpy(block_out, src + row_i * _block_bytes, bytes);
+    // If the Wirehair rows are not set up for this N yet:
+    if (!_sparse_rows || _sparse_rows->_block_count != block_count)
+    {
+        /*
+            The Wirehair code is linear in each byte of the blocks, so
+            encoding the identity matrix with N-byte blocks produces the
+            coefficients of each row in place of its data.
+        */
+        std::unique_ptr<Codec> sparse(new (std::nothrow) Codec);
+        if (!sparse) {
+            return false;
+        }
 
-                *bytes_out = (uint32_t)bytes;
+        uint8_t identity[CAT_MDS_MAX_N * CAT_MDS_MAX_N];
+        memset(identity, 0, block_count * block_count);
+        for (unsigned column_i = 0; column_i < block_count; ++column_i) {
+            identity[column_i * block_count + column_i] = 1;
+        }
 
-                return Wirehair_Success;
-            }
+        sparse->_small_n_choice = SmallNChoice::Wirehair;
+        if (sparse->InitializeEncoder(block_count * block_count, block_count) != Wirehair_Success ||
+            sparse->EncodeFeed(identity) != Wirehair_Success)
+        {
+            return false;
         }
 
-        return Wirehair_Error;
+        // Only repair rows are read from it, which do not need the input
+        sparse->SetInput(nullptr);
+        sparse->_original_out_of_order = true;
+
+        _sparse_rows = std::move(sparse);
     }
-#endif
 
-    // Regenerate any single row that got lost:
+    return _sparse_rows->Encode(block_id, coeffs_out, block_count) == block_count;
+}
 
-    uint32_t block_bytes = _block_bytes;
+WirehairResult Codec::SolveMds()
+{
+    CAT_DEBUG_ASSERT(_row_count == _block_count);
 
-    // For last row, use final byte count
-    if (block_id == _block_count - 1) {
-        block_bytes = _output_final_bytes;
+    // If a Wirehair row was received, the rows may be dependent
+    for (uint16_t row_i = 0; row_i < _row_count; ++row_i) {
+        if (_peel_rows[row_i].RecoveryId >= kMdsSparseFirstId) {
+            return SolveMdsGeneral();
+        }
     }
 
-    CAT_IF_DUMP(cout << "Regenerating row " << block_id << ":";)
+    SolveMdsCauchy();
+    return Wirehair_Success;
+}
 
-    PeelRowParameters params;
-    params.Initialize(block_id, _p_seed, _block_count, _mix_count);
+void Codec::SolveMdsCauchy()
+{
+    uint8_t * GF256_RESTRICT received = _copied_original;
+    memset(received, 0, _block_count);
 
-    PeelRowIterator iter(params, _block_count, _block_next_prime);
-    const RowMixIterator mix(params, _mix_count, _mix_next_prime);
+    uint16_t repair_rows[CAT_MDS_MAX_N];
+    uint8_t xs[CAT_MDS_MAX_N];
+    unsigned repair_count = 0;
 
-    const uint16_t peel_0 = iter.GetColumn();
+    // Copy the received message blocks into the recovery set
+    for (uint16_t row_i = 0; row_i < _row_count; ++row_i)
+    {
+        const uint32_t id = _peel_rows[row_i].RecoveryId;
 
-    // Remember first column (there is always at least one)
-    CAT_DEBUG_ASSERT(peel_0 < _recovery_rows);
-    uint8_t * GF256_RESTRICT first = _recovery_blocks + _block_bytes * peel_0;
+        if (id < _block_count)
+        {
+            memcpy(_recovery_blocks + _block_pitch * id, GetInputBlock(row_i), _block_bytes);
+            received[id] = 1;
+        }
+        else
+        {
+            repair_rows[repair_count] = row_i;
+            xs[repair_count] = static_cast<uint8_t>(id);
+            ++repair_count;
+        }
+    }
 
-    CAT_IF_DUMP(cout << " " << peel_0;)
+    // If all of the message blocks were received:
+    if (repair_count == 0) {
+        return;
+    }
 
-    // If this row references multiple columns:
-    if (iter.Iterate())
+    uint8_t ys[CAT_MDS_MAX_N];
+    unsigned erased_count = 0;
+    for (unsigned column_i = 0; column_i < _block_count; ++column_i) {
+        if (!received[column_i]) {
+            ys[erased_count++] = static_cast<uint8_t>(column_i);
+        }
+    }
+    CAT_DEBUG_ASSERT(erased_count == repair_count);
+
+    // Remove the received message blocks from each repair row, which
+    // leaves a square Cauchy system in the erased blocks
+    for (unsigned k = 0; k < repair_count; ++k)
     {
-        const uint16_t peel_1 = iter.GetColumn();
+        uint8_t * GF256_RESTRICT repair = GetInputBlock(repair_rows[k]);
 
-        CAT_IF_DUMP(cout << " " << peel_1;)
+        for (unsigned column_i = 0; column_i < _block_count; ++column_i)
+        {
+            if (received[column_i])
+            {
+                gf256_muladd_mem(
+                    repair,
+                    GetMdsCoefficient(xs[k], static_cast<uint8_t>(column_i)),
+                    _recovery_blocks + _block_pitch * column_i,
+                    _block_bytes);
+            }
+        }
+    }
 
-        CAT_DEBUG_ASSERT(peel_1 < _recovery_rows);
+    /*
+        A Cauchy matrix 1/(x[k] + y[a]) has a closed-form inverse, so it
+        needs no elimination or pivoting:
 
-        // Combine first two columns into output buffer (faster than memcpy + memxor)
-        gf256_addset_mem(
-            block_out,
-            first,
-            _recovery_blocks + _block_bytes * peel_1,
-            block_bytes);
+            inverse[a][k] = u[a] * v[k] / (x[k] + y[a])
 
-        // For each remaining peeler column:
-        while (iter.Iterate())
+            u[a] = prod(y[a] + x[i]) / prod(y[a] + y[i], i != a)
+            v[k] = prod(x[k] + y[i]) / prod(x[k] + x[i], i != k)
+    */
+    uint8_t u[CAT_MDS_MAX_N], v[CAT_MDS_MAX_N];
+    for (unsigned a = 0; a < erased_count; ++a)
+    {
+        uint8_t num = 1, den = 1;
+        for (unsigned i = 0; i < erased_count; ++i)
         {
-            const uint16_t peel_x = iter.GetColumn();
+            num = gf256_mul(num, ys[a] ^ xs[i]);
+            if (i != a) {
+                den = gf256_mul(den, ys[a] ^ ys[i]);
+            }
+        }
+        u[a] = gf256_div(num, den);
+    }
+    for (unsigned k = 0; k < repair_count; ++k)
+    {
+        uint8_t num = 1, den = 1;
+        for (unsigned i = 0; i < repair_count; ++i)
+        {
+            num = gf256_mul(num, xs[k] ^ ys[i]);
+            if (i != k) {
+                den = gf256_mul(den, xs[k] ^ xs[i]);
+            }
+        }
+        v[k] = gf256_div(num, den);
+    }
 
-            CAT_IF_DUMP(cout << " " << peel_x;)
+    // Multiply the repair rows by the inverse into the erased blocks
+    for (unsigned a = 0; a < erased_count; ++a)
+    {
+        uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_pitch * ys[a];
 
-            CAT_DEBUG_ASSERT(peel_x < _recovery_rows);
+        for (unsigned k = 0; k < repair_count; ++k)
+        {
+            const uint8_t coeff = gf256_mul(
+                gf256_mul(u[a], v[k]),
+                GetMdsCoefficient(xs[k], ys[a]));
 
-            // Mix in each column
-            gf256_add_mem(
-                block_out,
-                _recovery_blocks + _block_bytes * peel_x,
-                block_bytes);
+            if (k == 0) {
+                gf256_mul_mem(dest, GetInputBlock(repair_rows[k]), coeff, _block_bytes);
+            }
+            else {
+                gf256_muladd_mem(dest, coeff, GetInputBlock(repair_rows[k]), _block_bytes);
+            }
         }
+    }
+}
 
-        CAT_DEBUG_ASSERT((unsigned)(_block_count + mix.Columns[0]) < _recovery_rows);
+WirehairResult Codec::SolveMdsGeneral()
+{
+    const unsigned n = _block_count;
+    const unsigned pitch = n * 2;
 
-        // Mix first mixer block in directly
-        gf256_add_mem(
-            block_out,
-            _recovery_blocks + _block_bytes * (_block_count + mix.Columns[0]),
-            block_bytes);
-    }
-    else
+    /*
+        Each row of the matrix is the coefficients of a received row,
+        followed by a unit vector for that row.  After Gauss-Jordan
+        elimination the left half is the identity, and the right half is
+        the inverse, in terms of the received rows in their slots.
+    */
+    uint8_t matrix[CAT_MDS_MAX_N * CAT_MDS_MAX_N * 2];
+    uint16_t slots[CAT_MDS_MAX_N];
+
+    for (unsigned row_i = 0; row_i < n; ++row_i)
     {
-        CAT_DEBUG_ASSERT((unsigned)(_block_count + mix.Columns[0]) < _recovery_rows);
+        uint8_t * row = matrix + pitch * row_i;
 
-        // Mix first with first mixer block (faster than memcpy + memxor)
-        gf256_addset_mem(
-            block_out,
-            first,
-            _recovery_blocks + _block_bytes * (_block_count + mix.Columns[0]),
-            block_bytes);
+        if (!GetMdsCoefficients(_peel_rows[row_i].RecoveryId, row)) {
+            return Wirehair_OOM;
+        }
+        memset(row + n, 0, n);
+        row[n + row_i] = 1;
+        slots[row_i] = static_cast<uint16_t>(row_i);
     }
 
-    CAT_IF_DUMP(cout << " " << (_block_count + mix.Columns[0]);)
+    unsigned rank = 0;
 
-    // Combine remaining two mixer columns together:
-    CAT_DEBUG_ASSERT((unsigned)(_block_count + mix.Columns[1]) < _recovery_rows);
-    const uint8_t * mix0_src = _recovery_blocks + _block_bytes * (_block_count + mix.Columns[1]);
-    CAT_IF_DUMP(cout << " " << (_block_count + mix.Columns[1]);)
+    // For each column:
+    for (unsigned column_i = 0; column_i < n; ++column_i)
+    {
+        // Find a pivot in the rows that have not been used yet
+        unsigned pivot_i = rank;
+        while (pivot_i < n && matrix[pitch * pivot_i + column_i] == 0) {
+            ++pivot_i;
+        }
 
-    CAT_DEBUG_ASSERT((unsigned)(_block_count + mix.Columns[2]) < _recovery_rows);
-    const uint8_t * mix1_src = _recovery_blocks + _block_bytes * (_block_count + mix.Columns[2]);
-    CAT_IF_DUMP(cout << " " << (_block_count + mix.Columns[2]);)
+        // If no row covers this column, keep going to find every
+        // dependent row
+        if (pivot_i >= n) {
+            continue;
+        }
 
-    gf256_add2_mem(block_out, mix0_src, mix1_src, block_bytes);
+        uint8_t * pivot = matrix + pitch * rank;
+        if (pivot_i != rank)
+        {
+            gf256_memswap(pivot, matrix + pitch * pivot_i, pitch);
+            std::swap(slots[rank], slots[pivot_i]);
+        }
 
-    CAT_IF_DUMP(cout << endl;)
+        // Scale the pivot to 1
+        const uint8_t scale = gf256_inv(pivot[column_i]);
+        for (unsigned i = 0; i < pitch; ++i) {
+            pivot[i] = gf256_mul(pivot[i], scale);
+        }
 
-    *bytes_out = static_cast<uint32_t>(block_bytes);
-    return Wirehair_Success;
-}
+        // Eliminate the column from every other row
+        for (unsigned row_i = 0; row_i < n; ++row_i)
+        {
+            uint8_t * row = matrix + pitch * row_i;
+            if (row_i != rank && row[column_i] != 0) {
+                gf256_muladd_mem(row, row[column_i], pivot, pitch);
+            }
+        }
 
-WirehairResult Codec::ReconstructOutput(
-    void * GF256_RESTRICT message_out,
-    uint64_t message_bytes)
-{
-    CAT_IF_DUMP(cout << endl << "---- ReconstructOutput ----" << endl << endl;)
+        ++rank;
+    }
 
-    // Validate input
+    // If the rows are dependent:
+    if (rank < n)
+    {
+        // The rows past the rank add nothing, so free up their slots.
+        // Drop the highest slots first so that moving the last row down
+        // does not move a row that is about to be dropped
+        uint16_t dropped[CAT_MDS_MAX_N];
+        const unsigned drop_count = n - rank;
+        memcpy(dropped, slots + rank, sizeof(uint16_t) * drop_count);
+        std::sort(dropped, dropped + drop_count, std::greater<uint16_t>());
+
+        for (unsigned i = 0; i < drop_count; ++i)
+        {
+            const uint16_t last = --_row_count;
+
+            if (dropped[i] != last)
+            {
+                _peel_rows[dropped[i]].RecoveryId = _peel_rows[last].RecoveryId;
+                memcpy(GetInputBlock(dropped[i]), GetInputBlock(last), _block_bytes);
+            }
+        }
+
+        return Wirehair_NeedMore;
+    }
+
+    // Row i of the inverse produces message block i
+    for (unsigned row_i = 0; row_i < n; ++row_i)
+    {
+        const uint8_t * inverse = matrix + pitch * row_i + n;
+        uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_pitch * row_i;
+        bool first = true;
+
+        for (unsigned slot_i = 0; slot_i < n; ++slot_i)
+        {
+            const uint8_t coeff = inverse[slot_i];
+            if (coeff == 0) {
+                continue;
+            }
+
+            if (first) {
+                gf256_mul_mem(dest, GetInputBlock(slot_i), coeff, _block_bytes);
+                first = false;
+            }
+            else {
+                gf256_muladd_mem(dest, coeff, GetInputBlock(slot_i), _block_bytes);
+            }
+        }
+    }
+
+    return Wirehair_Success;
+}
+
+void Codec::SumMdsRow(
+    const uint8_t * coeffs,
+    uint8_t * GF256_RESTRICT data_out,
+    unsigned offset,
+    unsigned bytes
+) const
+{
+    bool first = true;
+
+    for (unsigned column_i = 0; column_i < _block_count; ++column_i)
+    {
+        const uint8_t coeff = coeffs[column_i];
+        if (coeff == 0) {
+            continue;
+        }
+
+        const uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_pitch * column_i + offset;
+
+        if (!first) {
+            gf256_muladd_mem(data_out, coeff, src, bytes);
+        }
+        else if (coeff == 1) {
+            // Message blocks are stored as-is
+            memcpy(data_out, src, bytes);
+            first = false;
+        }
+        else {
+            gf256_mul_mem(data_out, src, coeff, bytes);
+            first = false;
+        }
+    }
+
+    if (first) {
+        memset(data_out, 0, bytes);
+    }
+}
+
+#endif // CAT_SMALL_N_MDS
+
+WirehairResult Codec::ReconstructBlock(
+    const uint16_t block_id, ///< Block identifier
+    void * GF256_RESTRICT block_out, ///< Output block memory
+    uint32_t* bytes_out ///< Bytes written to output
+)
+{
+    CAT_IF_DUMP(cout << endl << "---- ReconstructBlock ----" << endl << endl;)
+
+    // Validate input
+    if (!block_out || block_id >= _block_count)
+    {
+        *bytes_out = 0;
+        return Wirehair_InvalidInput;
+    }
+
+#if defined(CAT_ALL_ORIGINAL)
+    // If decoder received only original data out of order:
+    if (_all_original)
+    {
+        PeelRow * GF256_RESTRICT row = _peel_rows;
+        const uint8_t * GF256_RESTRICT src = _input_blocks;
+
+        // For each row that was received:
+        for (uint16_t row_i = 0, count = _row_count; row_i < count; ++row_i)
+        {
+            const uint32_t id = row[row_i].RecoveryId;
+
+            // If this is the id we seek:
+            if (id == block_id)
+            {
+                CAT_IF_DUMP(cout << "Copying received row " << id << endl;)
+
+                const unsigned bytes = (id != (unsigned)_block_count - 1) ? _block_bytes : _output_final_bytes;
+
+                memcpy(block_out, src + row_i * _input_pitch, bytes);
+
+                *bytes_out = (uint32_t)bytes;
+
+                return Wirehair_Success;
+            }
+        }
+
+        return Wirehair_Error;
+    }
+#endif
+
+#if defined(CAT_SMALL_N_MDS)
+    // The recovery set of the Cauchy code is the message itself
+    if (_mds)
+    {
+        const unsigned bytes = (block_id != (unsigned)_block_count - 1) ? _block_bytes : _output_final_bytes;
+
+        memcpy(block_out, _recovery_blocks + _block_pitch * block_id, bytes);
+
+        *bytes_out = (uint32_t)bytes;
+
+        return Wirehair_Success;
+    }
+#endif // CAT_SMALL_N_MDS
+
+    // Regenerate any single row that got lost:
+
+    uint32_t block_bytes = _block_bytes;
+
+    // For last row, use final byte count
+    if (block_id == _block_count - 1) {
+        block_bytes = _output_final_bytes;
+    }
+
+    CAT_IF_DUMP(cout << "Regenerating row " << block_id << ":";)
+
+    PeelRowParameters params;
+    params.Initialize(block_id, _p_seed, _block_count, _mix_count);
+
+    PeelRowIterator iter(params, _block_count, _block_next_prime);
+    const RowMixIterator mix(params, _mix_count, _mix_next_prime);
+
+    const uint16_t peel_0 = iter.GetColumn();
+
+    // Remember first column (there is always at least one)
+    CAT_DEBUG_ASSERT(peel_0 < _recovery_rows);
+    uint8_t * GF256_RESTRICT first = _recovery_blocks + _block_pitch * peel_0;
+
+    CAT_IF_DUMP(cout << " " << peel_0;)
+
+    // If this row references multiple columns:
+    if (iter.Iterate())
+    {
+        const uint16_t peel_1 = iter.GetColumn();
+
+        CAT_IF_DUMP(cout << " " << peel_1;)
+
+        CAT_DEBUG_ASSERT(peel_1 < _recovery_rows);
+
+        // Combine first two columns into output buffer (faster than memcpy + memxor)
+        gf256_addset_mem(
+            block_out,
+            first,
+            _recovery_blocks + _block_pitch * peel_1,
+            block_bytes);
+
+        // For each remaining peeler column:
+        while (iter.Iterate())
+        {
+            const uint16_t peel_x = iter.GetColumn();
+
+            CAT_IF_DUMP(cout << " " << peel_x;)
+
+            CAT_DEBUG_ASSERT(peel_x < _recovery_rows);
+
+            // Mix in each column
+            gf256_add_mem(
+                block_out,
+                _recovery_blocks + _block_pitch * peel_x,
+                block_bytes);
+        }
+
+        CAT_DEBUG_ASSERT((unsigned)(_block_count + mix.Columns[0]) < _recovery_rows);
+
+        // Mix first mixer block in directly
+        gf256_add_mem(
+            block_out,
+            _recovery_blocks + _block_pitch * (_block_count + mix.Columns[0]),
+            block_bytes);
+    }
+    else
+    {
+        CAT_DEBUG_ASSERT((unsigned)(_block_count + mix.Columns[0]) < _recovery_rows);
+
+        // Mix first with first mixer block (faster than memcpy + memxor)
+        gf256_addset_mem(
+            block_out,
+            first,
+            _recovery_blocks + _block_pitch * (_block_count + mix.Columns[0]),
+            block_bytes);
+    }
+
+    CAT_IF_DUMP(cout << " " << (_block_count + mix.Columns[0]);)
+
+    // Combine remaining two mixer columns together:
+    CAT_DEBUG_ASSERT((unsigned)(_block_count + mix.Columns[1]) < _recovery_rows);
+    const uint8_t * mix0_src = _recovery_blocks + _block_pitch * (_block_count + mix.Columns[1]);
+    CAT_IF_DUMP(cout << " " << (_block_count + mix.Columns[1]);)
+
+    CAT_DEBUG_ASSERT((unsigned)(_block_count + mix.Columns[2]) < _recovery_rows);
+    const uint8_t * mix1_src = _recovery_blocks + _block_pitch * (_block_count + mix.Columns[2]);
+    CAT_IF_DUMP(cout << " " << (_block_count + mix.Columns[2]);)
+
+    gf256_add2_mem(block_out, mix0_src, mix1_src, block_bytes);
+
+    CAT_IF_DUMP(cout << endl;)
+
+    *bytes_out = static_cast<uint32_t>(block_bytes);
+    return Wirehair_Success;
+}
+
+WirehairResult Codec::ReconstructOutput(
+    void * GF256_RESTRICT message_out,
+    uint64_t message_bytes,
+    uint32_t * block_crcs)
+{
+    CAT_IF_DUMP(cout << endl << "---- ReconstructOutput ----" << endl << endl;)
+
+    // Validate input
     if (!message_out) {
         return Wirehair_InvalidInput;
     }
@@ -3463,8 +4653,55 @@ WirehairResult Codec::ReconstructOutput(
         CAT_DEBUG_BREAK();
         return Wirehair_InvalidInput;
     }
-    uint8_t * GF256_RESTRICT output_blocks = reinterpret_cast<uint8_t *>( message_out );
 
+    ReconstructOutputRows(reinterpret_cast<uint8_t *>( message_out ), nullptr, block_crcs);
+
+    return Wirehair_Success;
+}
+
+WirehairResult Codec::ReconstructOutputSegments(
+    const WirehairOutputSegment * segments,
+    unsigned segment_count)
+{
+    CAT_IF_DUMP(cout << endl << "---- ReconstructOutputSegments ----" << endl << endl;)
+
+    const uint64_t message_bytes = static_cast<uint64_t>(_block_count - 1) * _block_bytes + _output_final_bytes;
+
+    // Validate input
+    const int gather_count = CountStraddlingBlocks(segments, segment_count, _block_bytes, message_bytes);
+    if (gather_count < 0) {
+        return Wirehair_InvalidInput;
+    }
+
+    // Blocks that straddle segments are regenerated into a slot and then
+    // scattered, and the rest are written straight into their segment
+    const uint64_t gatherOffset = GetSegmentGatherOffset(_block_count);
+    const uint64_t sizeBytes = gatherOffset + static_cast<uint64_t>(gather_count) * _block_pitch;
+    uint8_t * GF256_RESTRICT workspace = SIMDSafeAllocate((size_t)sizeBytes);
+    if (!workspace) {
+        return Wirehair_OOM;
+    }
+    uint8_t ** output_rows = reinterpret_cast<uint8_t **>(workspace);
+    uint8_t * gather = workspace + gatherOffset;
+
+    WalkSegmentBlocks(segments, _block_count, _block_bytes, _output_final_bytes,
+        output_rows, gather, _block_pitch, SegmentWalk::MapOnly);
+
+    ReconstructOutputRows(nullptr, output_rows);
+
+    WalkSegmentBlocks(segments, _block_count, _block_bytes, _output_final_bytes,
+        output_rows, gather, _block_pitch, SegmentWalk::ScatterOut);
+
+    SIMDSafeFree(workspace);
+
+    return Wirehair_Success;
+}
+
+void Codec::ReconstructOutputRows(
+    uint8_t * GF256_RESTRICT output_blocks,
+    uint8_t * const * output_rows,
+    uint32_t * block_crcs)
+{
 #if defined(CAT_COPY_FIRST_N)
     // Re-purpose and initialize an array to store whether or not each row id needs to be regenerated
     uint8_t * GF256_RESTRICT copied_original = _copied_original;
@@ -3475,7 +4712,7 @@ WirehairResult Codec::ReconstructOutput(
     PeelRow * GF256_RESTRICT row = _peel_rows;
 
     // For each row:
-    for (uint16_t row_i = 0; row_i < _row_count; ++row_i, ++row, src += _block_bytes)
+    for (uint16_t row_i = 0; row_i < _row_count; ++row_i, ++row, src += _input_pitch)
     {
         const uint32_t block_id = row->RecoveryId;
 
@@ -3484,10 +4721,15 @@ WirehairResult Codec::ReconstructOutput(
         {
             CAT_IF_DUMP(cout << "Copying received row " << id << endl;)
 
-            uint8_t * GF256_RESTRICT dest = output_blocks + _block_bytes * block_id;
+            uint8_t * GF256_RESTRICT dest = output_rows ? output_rows[block_id] : output_blocks + _block_bytes * block_id;
             const unsigned bytes = (block_id != (unsigned)_block_count - 1) ? _block_bytes : _output_final_bytes;
 
-            memcpy(dest, src, bytes);
+            if (block_crcs) {
+                block_crcs[block_id] = Crc32cCopy(0, dest, src, bytes);
+            }
+            else {
+                memcpy(dest, src, bytes);
+            }
 
             copied_original[block_id] = 1;
         }
@@ -3496,12 +4738,11 @@ WirehairResult Codec::ReconstructOutput(
 
     // Regenerate any rows that got lost:
 
-    uint8_t * GF256_RESTRICT dest = output_blocks;
     unsigned block_bytes = _block_bytes;
 
     // For each block to generate:
     const uint16_t block_count = _block_count;
-    for (uint32_t block_id = 0; block_id < block_count; ++block_id, dest += _block_bytes)
+    for (uint32_t block_id = 0; block_id < block_count; ++block_id)
     {
 #if defined(CAT_COPY_FIRST_N)
         // If already copied, skip it
@@ -3514,6 +4755,24 @@ WirehairResult Codec::ReconstructOutput(
             block_bytes = _output_final_bytes;
         }
 
+        uint8_t * GF256_RESTRICT dest = output_rows ? output_rows[block_id] : output_blocks + _block_bytes * block_id;
+
+#if defined(CAT_SMALL_N_MDS)
+        // The recovery set of the Cauchy code is the message itself
+        if (_mds)
+        {
+            const uint8_t * GF256_RESTRICT src = _recovery_blocks + _block_pitch * block_id;
+
+            if (block_crcs) {
+                block_crcs[block_id] = Crc32cCopy(0, dest, src, block_bytes);
+            }
+            else {
+                memcpy(dest, src, block_bytes);
+            }
+            continue;
+        }
+#endif // CAT_SMALL_N_MDS
+
         CAT_IF_DUMP(cout << "Regenerating row " << row_i << ":";)
 
         PeelRowParameters params;
@@ -3526,7 +4785,7 @@ WirehairResult Codec::ReconstructOutput(
 
         // Remember first column (there is always at least one)
         CAT_DEBUG_ASSERT(peel_0 < _recovery_rows);
-        const uint8_t * GF256_RESTRICT first = _recovery_blocks + _block_bytes * peel_0;
+        const uint8_t * GF256_RESTRICT first = _recovery_blocks + _block_pitch * peel_0;
 
         CAT_IF_DUMP(cout << " " << peel_0;)
 
@@ -3539,7 +4798,7 @@ WirehairResult Codec::ReconstructOutput(
 
             // Combine first two columns into output buffer (faster than memcpy + memxor)
             CAT_DEBUG_ASSERT(peel_1 < _recovery_rows);
-            gf256_addset_mem(dest, first, _recovery_blocks + _block_bytes * peel_1, block_bytes);
+            gf256_addset_mem(dest, first, _recovery_blocks + _block_pitch * peel_1, block_bytes);
 
             // For each remaining peeler column:
             while (iter.Iterate())
@@ -3550,37 +4809,40 @@ WirehairResult Codec::ReconstructOutput(
 
                 // Mix in each column
                 CAT_DEBUG_ASSERT(peel_x < _recovery_rows);
-                gf256_add_mem(dest, _recovery_blocks + _block_bytes * peel_x, block_bytes);
+                gf256_add_mem(dest, _recovery_blocks + _block_pitch * peel_x, block_bytes);
             }
 
             // Mix first mixer block in directly
             CAT_DEBUG_ASSERT((unsigned)(block_count + mix.Columns[0]) < _recovery_rows);
-            gf256_add_mem(dest, _recovery_blocks + _block_bytes * (block_count + mix.Columns[0]), block_bytes);
+            gf256_add_mem(dest, _recovery_blocks + _block_pitch * (block_count + mix.Columns[0]), block_bytes);
         }
         else
         {
             // Mix first with first mixer block (faster than memcpy + memxor)
             CAT_DEBUG_ASSERT((unsigned)(block_count + mix.Columns[0]) < _recovery_rows);
-            gf256_addset_mem(dest, first, _recovery_blocks + _block_bytes * (block_count + mix.Columns[0]), block_bytes);
+            gf256_addset_mem(dest, first, _recovery_blocks + _block_pitch * (block_count + mix.Columns[0]), block_bytes);
         }
 
         CAT_IF_DUMP(cout << " " << (block_count + mix.Columns[0]);)
 
         // Combine remaining two mixer columns together:
         CAT_DEBUG_ASSERT((unsigned)(block_count + mix.Columns[1]) < _recovery_rows);
-        const uint8_t *mix0_src = _recovery_blocks + _block_bytes * (block_count + mix.Columns[1]);
+        const uint8_t *mix0_src = _recovery_blocks + _block_pitch * (block_count + mix.Columns[1]);
         CAT_IF_DUMP(cout << " " << (block_count + mix.Columns[1]);)
 
         CAT_DEBUG_ASSERT((unsigned)(block_count + mix.Columns[2]) < _recovery_rows);
-        const uint8_t *mix1_src = _recovery_blocks + _block_bytes * (block_count + mix.Columns[2]);
+        const uint8_t *mix1_src = _recovery_blocks + _block_pitch * (block_count + mix.Columns[2]);
         CAT_IF_DUMP(cout << " " << (block_count + mix.Columns[2]);)
 
         gf256_add2_mem(dest, mix0_src, mix1_src, block_bytes);
 
+        // Checksum the block while it is still in cache
+        if (block_crcs) {
+            block_crcs[block_id] = Crc32c(0, dest, block_bytes);
+        }
+
         CAT_IF_DUMP(cout << endl;)
     } // next row
-
-    return Wirehair_Success;
 }
 
 
@@ -3592,9 +4854,12 @@ Codec::Codec()
 
 Codec::~Codec()
 {
+    FreeColumnCache();
+    FreePendingBlocks();
     FreeWorkspace();
     FreeMatrix();
     FreeInput();
+    FreeInputSegments();
 }
 
 void Codec::SetInput(const void * GF256_RESTRICT message_in)
@@ -3603,14 +4868,73 @@ void Codec::SetInput(const void * GF256_RESTRICT message_in)
 
     // Set input blocks to the input message
     _input_blocks = (uint8_t*)message_in;
+    _input_pitch = _block_bytes;
     _input_allocated = 0;
+    _input_rows = nullptr;
+}
+
+WirehairResult Codec::SetInputSegments(
+    const WirehairSegment * segments,
+    unsigned segment_count)
+{
+    const uint64_t message_bytes = static_cast<uint64_t>(_block_count - 1) * _block_bytes + _input_final_bytes;
+
+    const int gather_count = CountStraddlingBlocks(segments, segment_count, _block_bytes, message_bytes);
+    if (gather_count < 0) {
+        return Wirehair_InvalidInput;
+    }
+
+    FreeInput();
+    _input_blocks = nullptr;
+
+    const uint64_t gatherOffset = GetSegmentGatherOffset(_block_count);
+    const uint64_t sizeBytes = gatherOffset + static_cast<uint64_t>(gather_count) * _block_pitch;
+
+    // If need to allocate more:
+    if (_input_segment_allocated < sizeBytes)
+    {
+        FreeInputSegments();
+
+        _input_segment_workspace = SIMDSafeAllocate((size_t)sizeBytes);
+        if (!_input_segment_workspace) {
+            return Wirehair_OOM;
+        }
+
+        _input_segment_allocated = sizeBytes;
+    }
+
+    _input_rows = reinterpret_cast<uint8_t **>(_input_segment_workspace);
+
+    WalkSegmentBlocks(
+        segments,
+        _block_count,
+        _block_bytes,
+        _input_final_bytes,
+        _input_rows,
+        _input_segment_workspace + gatherOffset,
+        _block_pitch,
+        SegmentWalk::GatherIn);
+
+    return Wirehair_Success;
+}
+
+void Codec::FreeInputSegments()
+{
+    if (_input_segment_workspace != nullptr)
+    {
+        SIMDSafeFree(_input_segment_workspace);
+        _input_segment_workspace = nullptr;
+    }
+
+    _input_segment_allocated = 0;
+    _input_rows = nullptr;
 }
 
 bool Codec::AllocateInput()
 {
     CAT_IF_DUMP(cout << endl << "---- AllocateInput ----" << endl << endl;)
 
-    const uint64_t sizeBytes = static_cast<uint64_t>(_block_count + _extra_count) * _block_bytes;
+    const uint64_t sizeBytes = static_cast<uint64_t>(_block_count + _extra_count) * _block_pitch;
 
     // If need to allocate more:
     if (_input_allocated < sizeBytes)
@@ -3626,6 +4950,8 @@ bool Codec::AllocateInput()
         _input_allocated = sizeBytes;
     }
 
+    _input_pitch = _block_pitch;
+    _input_rows = nullptr;
     return true;
 }
 
@@ -3670,10 +4996,19 @@ bool Codec::AllocateMatrix()
         compress_matrix_words * sizeof(uint64_t)
         + ge_matrix_words * sizeof(uint64_t)
         + heavy_bytes
-        + pivot_words * sizeof(uint16_t);
+        + pivot_words * sizeof(uint16_t)
+        + compress_rows;
 
-    // If need to allocate more:
-    if (_ge_allocated < sizeBytes)
+    // If it fits after the workspace:
+    if (sizeBytes <= _workspace_tail_bytes)
+    {
+        FreeMatrix();
+
+        _ge_in_workspace = true;
+        _compress_matrix = reinterpret_cast<uint64_t *>( _workspace_tail );
+    }
+    // If need to allocate more:
+    else if (_ge_allocated < sizeBytes)
     {
         FreeMatrix();
 
@@ -3686,6 +5021,8 @@ bool Codec::AllocateMatrix()
         _compress_matrix = reinterpret_cast<uint64_t *>( matrix );
     }
 
+    _ge_bytes = sizeBytes;
+
     // Store pointers
     _ge_pitch = ge_pitch;
     _ge_rows = ge_rows;
@@ -3699,6 +5036,7 @@ bool Codec::AllocateMatrix()
     _pivots = reinterpret_cast<uint16_t *>( _heavy_matrix + heavy_bytes );
     _ge_row_map = _pivots + pivot_count;
     _ge_col_map = _ge_row_map + pivot_count;
+    _compress_dirty = reinterpret_cast<uint8_t *>( _ge_col_map + ge_cols );
 
     CAT_IF_DUMP(cout << "GE matrix is " << ge_rows << " x " << ge_cols
         << " with pitch " << ge_pitch << " consuming "
@@ -3712,8 +5050,10 @@ bool Codec::AllocateMatrix()
     CAT_IF_DUMP(cout << "Allocated " << kHeavyRows
         << " heavy rows, consuming " << heavy_bytes << " bytes" << endl;)
 
-    // Clear entire Compression matrix
-    memset(_compress_matrix, 0, compress_matrix_words * sizeof(uint64_t));
+    // Rows of the Compression matrix are cleared when first written, instead
+    // of in one pass over the whole matrix here.  The first update to a row
+    // from PeelDiagonal() is then a copy rather than an add
+    memset(_compress_dirty, 0, compress_rows);
 
     // Clear entire GE matrix.
     // This clears ge_cols not ge_rows because we just need to clear the upper
@@ -3728,8 +5068,14 @@ bool Codec::AllocateMatrix()
 
 void Codec::FreeMatrix()
 {
+    // If the matrix is part of the workspace, just let go of it
+    if (_ge_in_workspace)
+    {
+        _compress_matrix = nullptr;
+        _ge_in_workspace = false;
+    }
     // If memory was allocated:
-    if (_compress_matrix != nullptr)
+    else if (_compress_matrix != nullptr)
     {
         // Free it now
         SIMDSafeFree(_compress_matrix);
@@ -3745,19 +5091,24 @@ bool Codec::AllocateWorkspace()
 
     // +1 for temporary space for MultiplyDenseValues()
     const unsigned recovery_rows = _block_count + _mix_count + 1;
-    const uint64_t recoverySizeBytes = static_cast<uint64_t>(recovery_rows) * _block_bytes;
+    const uint64_t recoverySizeBytes = static_cast<uint64_t>(recovery_rows) * _block_pitch;
 
     // Count needed rows and columns
     const uint32_t row_count = _block_count + _extra_count;
     const uint32_t column_count = _block_count;
 
     // Calculate size
-    const uint64_t sizeBytes = recoverySizeBytes
+    const uint64_t usedBytes = recoverySizeBytes
         + sizeof(PeelRow) * row_count
         + sizeof(PeelColumn) * column_count
         + sizeof(PeelRefs) * column_count
         + row_count;
 
+    // Leave room for AllocateMatrix() if asked to
+    const uint64_t tailOffset = (usedBytes + kBlockAlignBytes - 1) & ~(uint64_t)(kBlockAlignBytes - 1);
+    const uint64_t sizeBytes = _matrix_reserve > 0 ? tailOffset + _matrix_reserve : usedBytes;
+    _matrix_reserve = 0;
+
     if (_workspace_allocated < sizeBytes)
     {
         FreeWorkspace();
@@ -3770,6 +5121,23 @@ bool Codec::AllocateWorkspace()
         _workspace_allocated = sizeBytes;
     }
 
+    // The matrix of the last solve may be in the tail, and is rebuilt anyway
+    if (_ge_in_workspace) {
+        FreeMatrix();
+    }
+
+    // Any space left over can hold the matrix
+    if (_workspace_allocated > tailOffset)
+    {
+        _workspace_tail = _recovery_blocks + tailOffset;
+        _workspace_tail_bytes = _workspace_allocated - tailOffset;
+    }
+    else
+    {
+        _workspace_tail = nullptr;
+        _workspace_tail_bytes = 0;
+    }
+
     // Set pointers
     _peel_rows = reinterpret_cast<PeelRow *>( _recovery_blocks + recoverySizeBytes );
     _peel_cols = reinterpret_cast<PeelColumn *>( _peel_rows + row_count );
@@ -3788,12 +5156,28 @@ bool Codec::AllocateWorkspace()
         _peel_cols[ii].Mark = MARK_TODO;
     }
 
+    // The column cache is optional, so a failure here is not an error
+    AllocateColumnCache();
+
     return true;
 }
 
 void Codec::FreeWorkspace()
 {
-    if (_recovery_blocks != nullptr)
+    // The matrix goes with the workspace if it lives there
+    if (_ge_in_workspace) {
+        FreeMatrix();
+    }
+    _workspace_tail = nullptr;
+    _workspace_tail_bytes = 0;
+
+    // If the recovery set belongs to the application, just let go of it
+    if (_recovery_view)
+    {
+        _recovery_blocks = nullptr;
+        _recovery_view = false;
+    }
+    else if (_recovery_blocks != nullptr)
     {
         SIMDSafeFree(_recovery_blocks);
         _recovery_blocks = nullptr;
@@ -3802,6 +5186,139 @@ void Codec::FreeWorkspace()
     _workspace_allocated = 0;
 }
 
+bool Codec::AllocateColumnCache()
+{
+    _column_cache_capacity = 0;
+    _column_cache_used = 0;
+
+    const uint32_t offsetsBytes = sizeof(uint32_t) * _block_count;
+
+    // If disabled, or too small to hold any rows:
+    if (_column_cache_limit <= offsetsBytes + sizeof(uint16_t) * (RowMixIterator::kColumnCount + 1))
+    {
+        if (_column_cache_limit == 0) {
+            FreeColumnCache();
+        }
+        return false;
+    }
+
+    const uint32_t sizeBytes = _column_cache_limit;
+
+    if (_column_cache_allocated < sizeBytes)
+    {
+        FreeColumnCache();
+
+        uint8_t * memory = SIMDSafeAllocate(sizeBytes);
+        if (!memory) {
+            return false;
+        }
+        _column_cache_offsets = reinterpret_cast<uint32_t *>( memory );
+        _column_cache_allocated = sizeBytes;
+    }
+
+    _column_cache = reinterpret_cast<uint16_t *>( _column_cache_offsets + _block_count );
+    _column_cache_capacity = (sizeBytes - offsetsBytes) / sizeof(uint16_t);
+
+    // No rows are cached yet
+    memset(_column_cache_offsets, 0xff, offsetsBytes);
+
+    CAT_IF_DUMP(cout << "Column cache holds " << _column_cache_capacity << " columns" << endl;)
+
+    return true;
+}
+
+void Codec::FreeColumnCache()
+{
+    if (_column_cache_offsets != nullptr)
+    {
+        SIMDSafeFree(_column_cache_offsets);
+        _column_cache_offsets = nullptr;
+        _column_cache = nullptr;
+    }
+
+    _column_cache_allocated = 0;
+    _column_cache_capacity = 0;
+}
+
+WirehairResult Codec::QueuePendingBlock(
+    uint32_t block_id,
+    const void * GF256_RESTRICT block_in,
+    unsigned data_bytes)
+{
+    // If the queue is full, the application should send the block later
+    if (_pending_count >= CAT_MAX_EXTRA_ROWS) {
+        return Wirehair_WouldBlock;
+    }
+
+    const uint64_t sizeBytes = static_cast<uint64_t>(CAT_MAX_EXTRA_ROWS) * _block_pitch;
+
+    // If need to allocate more:
+    if (_pending_allocated < sizeBytes)
+    {
+        FreePendingBlocks();
+
+        _pending_blocks = SIMDSafeAllocate((size_t)sizeBytes);
+        if (!_pending_blocks) {
+            return Wirehair_OOM;
+        }
+
+        _pending_allocated = sizeBytes;
+    }
+
+    // The same row would fail to pivot again, so drop repeats of it
+    if (!_received_ids.Insert(block_id)) {
+        return Wirehair_OOM;
+    }
+
+    memcpy(_pending_blocks + _block_pitch * _pending_count, block_in, data_bytes);
+    _pending_ids[_pending_count++] = block_id;
+
+    return Wirehair_InProgress;
+}
+
+WirehairResult Codec::ResumePendingBlocks()
+{
+    WirehairResult result = Wirehair_NeedMore;
+
+    for (unsigned i = 0; i < _pending_count; ++i)
+    {
+        result = ResumeSolveMatrix(_pending_ids[i], _pending_blocks + _block_pitch * i);
+
+        // If solved, or out of extra rows:
+        if (result != Wirehair_NeedMore) {
+            break;
+        }
+    }
+
+    _pending_count = 0;
+    return result;
+}
+
+void Codec::FreePendingBlocks()
+{
+    if (_pending_blocks != nullptr)
+    {
+        SIMDSafeFree(_pending_blocks);
+        _pending_blocks = nullptr;
+    }
+
+    _pending_allocated = 0;
+    _pending_count = 0;
+}
+
+void Codec::SetColumnCacheBytes(uint32_t bytes)
+{
+    _column_cache_limit = bytes;
+
+    // If a solve is already set up, size the cache for it now
+    if (_recovery_blocks) {
+        AllocateColumnCache();
+    }
+    else {
+        _column_cache_capacity = 0;
+    }
+}
+
 
 //// Diagnostic
 
@@ -3907,7 +5424,8 @@ void Codec::PrintCompressMatrix()
         for (unsigned jj = 0; jj < cols; ++jj)
         {
             const uint64_t mask = (uint64_t)1 << (jj & 63);
-            const uint64_t word = _compress_matrix[_ge_pitch * ii + (jj >> 6)];
+            const uint64_t word = !_compress_dirty[ii] ? 0 :
+                _compress_matrix[_ge_pitch * ii + (jj >> 6)];
             const bool nonzero = 0 != (word & mask);
             const char ch = '0' + nonzero; // bool is 0 when false, 1 when true
             cout << ch;
@@ -3974,11 +5492,11 @@ void Codec::PrintDeferredColumns()
 
 //// Encoder Mode
 
-WirehairResult Codec::InitializeEncoder(
+WirehairResult Codec::ChooseEncoderMatrix(
     uint64_t message_bytes,
     unsigned block_bytes)
 {
-    WirehairResult result = ChooseMatrix(message_bytes, block_bytes);
+    const WirehairResult result = ChooseMatrix(message_bytes, block_bytes);
 
     if (result == Wirehair_Success)
     {
@@ -3993,10 +5511,26 @@ WirehairResult Codec::InitializeEncoder(
         _output_final_bytes = _block_bytes;
         _extra_count = 0;
         _original_out_of_order = false;
+        _recovery_ready = false;
+    }
 
+    return result;
+}
+
+WirehairResult Codec::InitializeEncoder(
+    uint64_t message_bytes,
+    unsigned block_bytes)
+{
+    WirehairResult result = ChooseEncoderMatrix(message_bytes, block_bytes);
+
+    if (result == Wirehair_Success)
+    {
         if (!AllocateWorkspace()) {
             result = Wirehair_OOM;
         }
+        else {
+            AttachRepairRows();
+        }
     }
 
     return result;
@@ -4013,10 +5547,66 @@ WirehairResult Codec::EncodeFeed(const void * GF256_RESTRICT message_in)
 
     SetInput(message_in);
 
-    // For each input row:
-    for (uint16_t id = 0; id < _block_count; ++id) {
-        if (!OpportunisticPeeling(id, id)) {
-            return Wirehair_BadPeelSeed;
+    return EncodeInput();
+}
+
+WirehairResult Codec::EncodeFeedSegments(
+    const WirehairSegment * segments,
+    unsigned segment_count)
+{
+    CAT_IF_DUMP(cout << endl << "---- EncodeFeedSegments ----" << endl << endl;)
+
+    const WirehairResult result = SetInputSegments(segments, segment_count);
+    if (result != Wirehair_Success) {
+        return result;
+    }
+
+    return EncodeInput();
+}
+
+WirehairResult Codec::EncodeInput()
+{
+#if defined(CAT_SMALL_N_MDS)
+    // The Cauchy code is systematic, so the recovery set is the message
+    if (_mds)
+    {
+        for (unsigned block_id = 0; block_id < _block_count; ++block_id)
+        {
+            uint8_t * GF256_RESTRICT dest = _recovery_blocks + _block_pitch * block_id;
+
+            if (block_id + 1 < _block_count) {
+                memcpy(dest, GetInputBlock(block_id), _block_bytes);
+            }
+            else {
+                // Pad the final block with zeros
+                memcpy(dest, GetInputBlock(block_id), _input_final_bytes);
+                memset(dest + _input_final_bytes, 0, _block_bytes - _input_final_bytes);
+            }
+        }
+
+        _recovery_ready = true;
+        return Wirehair_Success;
+    }
+#endif // CAT_SMALL_N_MDS
+
+    // For each batch of input rows:
+    for (unsigned first = 0; first < _block_count; first += kPeelRowBatch)
+    {
+        const unsigned remaining = _block_count - first;
+        const unsigned count = (remaining < kPeelRowBatch) ? remaining : kPeelRowBatch;
+
+        uint32_t seeds[kPeelRowBatch];
+        for (unsigned i = 0; i < count; ++i) {
+            seeds[i] = first + i;
+        }
+
+        PeelRowParameters params[kPeelRowBatch];
+        InitializePeelRowBatch(params, seeds, count, _p_seed, _block_count, _mix_count);
+
+        for (unsigned i = 0; i < count; ++i) {
+            if (!OpportunisticPeeling((uint16_t)(first + i), first + i, &params[i])) {
+                return Wirehair_BadPeelSeed;
+            }
         }
     }
 
@@ -4025,142 +5615,643 @@ WirehairResult Codec::EncodeFeed(const void * GF256_RESTRICT message_in)
 
     if (result == Wirehair_Success) {
         GenerateRecoveryBlocks();
+        _recovery_ready = true;
         return Wirehair_Success;
     }
-    else if (result == Wirehair_NeedMore) {
-        return Wirehair_BadPeelSeed;
+    else if (result == Wirehair_NeedMore) {
+        return Wirehair_BadPeelSeed;
+    }
+    else {
+        return result;
+    }
+}
+
+uint32_t Codec::Encode(
+    const uint32_t block_id, ///< Block id to generate
+    void * GF256_RESTRICT block_out, ///< Block data output
+    uint32_t out_buffer_bytes, ///< Bytes in block
+    uint32_t * crc_out ///< Optional CRC32C of the block
+) const
+{
+    if (!block_out) {
+        return 0;
+    }
+
+    unsigned copyBytes;
+
+    // If this is the last block:
+    if ((uint16_t)block_id == _block_count - 1) {
+        copyBytes = _input_final_bytes;
+    }
+    else {
+        copyBytes = _block_bytes;
+    }
+
+    // If not enough space in output buffer:
+    if (out_buffer_bytes < copyBytes) {
+        return 0;
+    }
+
+    uint8_t * GF256_RESTRICT data_out = reinterpret_cast<uint8_t *>( block_out );
+
+#if defined(CAT_COPY_FIRST_N)
+    // Note that if the encoder was a decoder the original message blocks may
+    // not be available, so we regenerate them each time using the recovery set.
+    // This means that wirehair_encode() after conversion will be slow for the
+    // set of original blocks.  I noted this in the API comments to help devs.
+
+    // For the original message blocks (id < N):
+    if (block_id < _block_count &&
+        !_original_out_of_order)
+    {
+        const uint8_t * GF256_RESTRICT src = GetInputBlock(block_id);
+
+        // Copy from the original file data
+        if (crc_out) {
+            *crc_out = Crc32cCopy(0, data_out, src, copyBytes);
+        }
+        else {
+            memcpy(data_out, src, copyBytes);
+        }
+        return copyBytes;
+    }
+#endif // CAT_COPY_FIRST_N
+
+#if defined(CAT_SMALL_N_MDS)
+    if (_mds)
+    {
+        uint8_t coeffs[CAT_MDS_MAX_N];
+        if (!GetMdsCoefficients(block_id, coeffs)) {
+            return 0;
+        }
+
+        SumMdsRow(coeffs, data_out, 0, copyBytes);
+
+        if (crc_out) {
+            *crc_out = Crc32c(0, data_out, copyBytes);
+        }
+
+        return copyBytes;
+    }
+#endif // CAT_SMALL_N_MDS
+
+    CAT_IF_DUMP(cout << "Encode: Generating row " << block_id << ":";)
+
+    const uint8_t * srcs[kMaxPeelCount + RowMixIterator::kColumnCount];
+    const unsigned src_count = GetEncodeSources(block_id, srcs, copyBytes);
+
+    SumEncodeSources(data_out, srcs, src_count, 0, copyBytes);
+
+    // Checksum the block while it is still in cache
+    if (crc_out) {
+        *crc_out = Crc32c(0, data_out, copyBytes);
+    }
+
+    CAT_IF_DUMP(cout << endl;)
+
+    return copyBytes;
+}
+
+const uint8_t * Codec::GetOriginalBlock(
+    const uint32_t block_id,
+    uint32_t& bytes_out
+) const
+{
+#if defined(CAT_COPY_FIRST_N)
+    // If the original message blocks are available (see Encode()):
+    if (block_id < _block_count &&
+        !_original_out_of_order)
+    {
+        bytes_out = (block_id == (unsigned)_block_count - 1) ? _input_final_bytes : _block_bytes;
+        return GetInputBlock(block_id);
+    }
+#endif // CAT_COPY_FIRST_N
+
+    bytes_out = 0;
+    return nullptr;
+}
+
+unsigned Codec::GetEncodeSources(
+    const uint32_t block_id,
+    const uint8_t ** srcs,
+    unsigned prefetch_bytes
+) const
+{
+    /*
+        Gather all of the source blocks before reading any of them, so that
+        their cache misses overlap rather than happening one after another.
+    */
+
+    unsigned src_count = 0;
+
+    unsigned cached_count = 0;
+    const uint16_t * cached = _repair_rows ? _repair_rows->GetRow(block_id, cached_count) : nullptr;
+
+    // If the row was generated ahead of time:
+    if (cached)
+    {
+        CAT_DEBUG_ASSERT(cached_count <= kMaxPeelCount + RowMixIterator::kColumnCount);
+
+        for (unsigned i = 0; i < cached_count; ++i)
+        {
+            CAT_IF_DUMP(cout << " " << cached[i];)
+
+            CAT_DEBUG_ASSERT(cached[i] < _recovery_rows);
+            srcs[src_count++] = _recovery_blocks + _block_pitch * cached[i];
+        }
+    }
+    else
+    {
+        PeelRowParameters params;
+        params.Initialize(block_id, _p_seed, _block_count, _mix_count);
+
+        PeelRowIterator iter(params, _block_count, _block_next_prime);
+        const RowMixIterator mix(params, _mix_count, _mix_next_prime);
+
+        // For each peeler column (there is always at least one):
+        do
+        {
+            const uint16_t peel_x = iter.GetColumn();
+
+            CAT_IF_DUMP(cout << " " << peel_x;)
+
+            CAT_DEBUG_ASSERT(peel_x < _recovery_rows);
+            srcs[src_count++] = _recovery_blocks + _block_pitch * peel_x;
+        } while (iter.Iterate());
+
+        // Add in the 3 mixer columns
+        for (unsigned i = 0; i < RowMixIterator::kColumnCount; ++i)
+        {
+            CAT_IF_DUMP(cout << " " << (_block_count + mix.Columns[i]);)
+
+            CAT_DEBUG_ASSERT((unsigned)(_block_count + mix.Columns[i]) < _recovery_rows);
+            srcs[src_count++] = _recovery_blocks + _block_pitch * (_block_count + mix.Columns[i]);
+        }
+    }
+
+    for (unsigned i = 0; i < src_count; ++i) {
+        PrefetchBlock(srcs[i], prefetch_bytes);
+    }
+
+    // The sum does not depend on the order, so walk the blocks in address
+    // order.  Rows are short, so insertion sort is fine
+    for (unsigned i = 1; i < src_count; ++i)
+    {
+        const uint8_t * src = srcs[i];
+        unsigned j = i;
+        for (; j > 0 && srcs[j - 1] > src; --j) {
+            srcs[j] = srcs[j - 1];
+        }
+        srcs[j] = src;
+    }
+
+    return src_count;
+}
+
+void Codec::SumEncodeSources(
+    uint8_t * GF256_RESTRICT data_out,
+    const uint8_t * const * srcs,
+    unsigned src_count,
+    unsigned offset,
+    unsigned bytes
+) const
+{
+    // If the block is a copy of one source:
+    if (src_count == 1)
+    {
+        memcpy(data_out, srcs[0] + offset, bytes);
+        return;
+    }
+
+    // Combine first two columns into output buffer (faster than memcpy + memxor)
+    gf256_addset_mem(data_out, srcs[0] + offset, srcs[1] + offset, bytes);
+
+    // Mix in the rest two at a time
+    unsigned src_i = 2;
+    for (; src_i + 1 < src_count; src_i += 2) {
+        gf256_add2_mem(data_out, srcs[src_i] + offset, srcs[src_i + 1] + offset, bytes);
+    }
+    if (src_i < src_count) {
+        gf256_add_mem(data_out, srcs[src_i] + offset, bytes);
+    }
+}
+
+uint32_t Codec::EncodeSegments(
+    const uint32_t block_id,
+    const WirehairOutputSegment * segments,
+    unsigned segment_count
+) const
+{
+    if (!segments) {
+        return 0;
+    }
+
+    const unsigned copyBytes = ((uint16_t)block_id == _block_count - 1) ? _input_final_bytes : _block_bytes;
+
+    // If not enough space in the segments:
+    uint64_t capacity = 0;
+    for (unsigned i = 0; i < segment_count && capacity < copyBytes; ++i)
+    {
+        if (!segments[i].Data && segments[i].Bytes > 0) {
+            return 0;
+        }
+        capacity += segments[i].Bytes;
+    }
+    if (capacity < copyBytes) {
+        return 0;
+    }
+
+    const uint8_t * srcs[kMaxPeelCount + RowMixIterator::kColumnCount];
+    unsigned src_count;
+
+#if defined(CAT_COPY_FIRST_N)
+    // If the block can be copied from the original file data:
+    if (block_id < _block_count &&
+        !_original_out_of_order)
+    {
+        srcs[0] = GetInputBlock(block_id);
+        src_count = 1;
+    }
+    else
+#endif // CAT_COPY_FIRST_N
+#if defined(CAT_SMALL_N_MDS)
+    // If the row has coefficients, write each piece of it directly
+    if (_mds)
+    {
+        uint8_t coeffs[CAT_MDS_MAX_N];
+        if (!GetMdsCoefficients(block_id, coeffs)) {
+            return 0;
+        }
+
+        unsigned offset = 0;
+        for (unsigned i = 0; offset < copyBytes; ++i)
+        {
+            const unsigned remaining = copyBytes - offset;
+            const unsigned piece = (segments[i].Bytes < remaining) ? (unsigned)segments[i].Bytes : remaining;
+
+            if (piece > 0)
+            {
+                SumMdsRow(coeffs, reinterpret_cast<uint8_t *>(segments[i].Data), offset, piece);
+                offset += piece;
+            }
+        }
+
+        return copyBytes;
+    }
+    else
+#endif // CAT_SMALL_N_MDS
+    {
+        src_count = GetEncodeSources(block_id, srcs, copyBytes);
+    }
+
+    // Write each piece of the block straight into its segment
+    unsigned offset = 0;
+    for (unsigned i = 0; offset < copyBytes; ++i)
+    {
+        const unsigned remaining = copyBytes - offset;
+        const unsigned piece = (segments[i].Bytes < remaining) ? (unsigned)segments[i].Bytes : remaining;
+
+        if (piece > 0)
+        {
+            SumEncodeSources(reinterpret_cast<uint8_t *>(segments[i].Data), srcs, src_count, offset, piece);
+            offset += piece;
+        }
+    }
+
+    return copyBytes;
+}
+
+WirehairResult Codec::UpdateInput(
+    const unsigned block_id, ///< Block id to replace
+    const void * GF256_RESTRICT block_in, ///< New block data
+    const unsigned block_bytes ///< Bytes in block
+)
+{
+    CAT_IF_DUMP(cout << endl << "---- UpdateInput ----" << endl << endl;)
+
+    // Original data must be available in order, and the recovery set writable
+    if (_original_out_of_order || (!_input_blocks && !_input_rows) || !block_in ||
+        block_id >= _block_count || _recovery_view)
+    {
+        return Wirehair_InvalidInput;
+    }
+
+    const unsigned copyBytes = (block_id == (unsigned)_block_count - 1) ? _input_final_bytes : _block_bytes;
+    if (block_bytes != copyBytes) {
+        return Wirehair_InvalidInput;
+    }
+
+    uint8_t * GF256_RESTRICT input_block = GetInputBlock(block_id);
+
+#if defined(CAT_SMALL_N_MDS)
+    // The recovery set of the Cauchy code is a copy of the message
+    if (_mds)
+    {
+        memcpy(_recovery_blocks + _block_pitch * block_id, block_in, copyBytes);
+    }
+    else
+#endif // CAT_SMALL_N_MDS
+    {
+        const WirehairResult result = UpdateRecoveryBlocks(block_id, block_in, copyBytes);
+        if (result != Wirehair_Success) {
+            return result;
+        }
+    }
+
+    // If the block was gathered from several segments, the application
+    // cannot update the copy so do it here
+    if (_input_rows &&
+        input_block >= _input_segment_workspace + GetSegmentGatherOffset(_block_count) &&
+        input_block < _input_segment_workspace + _input_segment_allocated)
+    {
+        memcpy(input_block, block_in, copyBytes);
+    }
+
+    return Wirehair_Success;
+}
+
+WirehairResult Codec::UpdateRecoveryBlocks(
+    const unsigned block_id,
+    const void * GF256_RESTRICT block_in,
+    const unsigned copyBytes
+)
+{
+    /*
+        The recovery set is linear in the input, so the change is the column
+        of the inverse matrix for this input row, scaled by the block delta.
+
+        That column is found by running the value pass again with one-byte
+        blocks, where the input is the unit vector for this row.  The matrix
+        solution from EncodeFeed() is reused as-is.
+    */
+
+    const unsigned recovery_count = _block_count + _mix_count;
+    const size_t coeffBytes = recovery_count + 1;
+    uint8_t * GF256_RESTRICT workspace = SIMDSafeAllocate(coeffBytes + _block_count + copyBytes);
+    if (!workspace) {
+        return Wirehair_OOM;
+    }
+    uint8_t * GF256_RESTRICT coeffs = workspace;
+    uint8_t * GF256_RESTRICT unit_input = workspace + coeffBytes;
+    uint8_t * GF256_RESTRICT delta = unit_input + _block_count;
+
+    unit_input[block_id] = 1;
+
+    uint8_t * GF256_RESTRICT saved_recovery_blocks = _recovery_blocks;
+    uint8_t * GF256_RESTRICT saved_input_blocks = _input_blocks;
+    uint8_t ** saved_input_rows = _input_rows;
+    const unsigned saved_block_bytes = _block_bytes;
+    const unsigned saved_block_pitch = _block_pitch;
+    const unsigned saved_input_pitch = _input_pitch;
+    const unsigned saved_input_final_bytes = _input_final_bytes;
+
+    _recovery_blocks = coeffs;
+    _input_blocks = unit_input;
+    _input_rows = nullptr;
+    _block_bytes = 1;
+    _block_pitch = 1;
+    _input_pitch = 1;
+    _input_final_bytes = 1;
+
+    GenerateRecoveryBlocks();
+
+    _recovery_blocks = saved_recovery_blocks;
+    _input_blocks = saved_input_blocks;
+    _input_rows = saved_input_rows;
+    _block_bytes = saved_block_bytes;
+    _block_pitch = saved_block_pitch;
+    _input_pitch = saved_input_pitch;
+    _input_final_bytes = saved_input_final_bytes;
+
+    // Delta = old block + new block
+    gf256_addset_mem(delta, GetInputBlock(block_id), block_in, copyBytes);
+
+    // For each recovery block affected by this input row:
+    for (unsigned column_i = 0; column_i < recovery_count; ++column_i)
+    {
+        gf256_muladd_mem(
+            _recovery_blocks + _block_pitch * column_i,
+            coeffs[column_i],
+            delta,
+            copyBytes);
+    }
+
+    SIMDSafeFree(workspace);
+
+    return Wirehair_Success;
+}
+
+/*
+    Encoder state layout, in native byte order:
+
+        EncoderStateHeader
+        (zero padding up to kBlockAlignBytes)
+        uint8_t RecoveryBlocks[RecoveryRows][BlockPitch]
+
+    The recovery blocks keep the row pitch they had in memory, so an
+    encoder can read them straight out of a mapping of the state.
+*/
+
+/// Code field of saved state: Older state has zero here
+static const uint32_t kStateCodeWirehair = 0;
+static const uint32_t kStateCodeCauchy = 1;
+
+/// Passed to SelectSavedCode() to go back to the configured code
+static const uint32_t kStateCodeNone = ~(uint32_t)0;
+
+bool Codec::SelectSavedCode(uint32_t code)
+{
+#if defined(CAT_SMALL_N_MDS)
+    if (code == kStateCodeNone) {
+        _small_n_choice = SmallNChoice::Configured;
+    }
+    else if (code == kStateCodeWirehair) {
+        _small_n_choice = SmallNChoice::Wirehair;
+    }
+    else if (code == kStateCodeCauchy) {
+        _small_n_choice = SmallNChoice::Cauchy;
     }
     else {
-        return result;
+        return false;
     }
+    return true;
+#else
+    return code == kStateCodeNone || code == kStateCodeWirehair;
+#endif
 }
 
-uint32_t Codec::Encode(
-    const uint32_t block_id, ///< Block id to generate
-    void * GF256_RESTRICT block_out, ///< Block data output
-    uint32_t out_buffer_bytes ///< Bytes in block
-)
+/// Identifies encoder state, and also that it has the same byte order
+static const uint32_t kEncoderStateMagic = 0x4e454857; // "WHEN"
+
+/// Increment when the encoder state layout changes
+static const uint32_t kEncoderStateVersion = 1;
+
+struct EncoderStateHeader
 {
-    if (!block_out) {
-        return 0;
-    }
+    uint32_t Magic;
+    uint32_t Version;
+    uint64_t MessageBytes;
+    uint32_t BlockBytes;
+    uint32_t BlockPitch;
+    uint32_t RecoveryRows;
+    uint32_t PeelSeed;
+    uint32_t DenseSeed;
+    uint32_t DenseCount;
+    uint32_t Code;
+};
 
-    unsigned copyBytes;
+static_assert(sizeof(EncoderStateHeader) <= kBlockAlignBytes, "Update the encoder state layout");
 
-    // If this is the last block:
-    if ((uint16_t)block_id == _block_count - 1) {
-        copyBytes = _input_final_bytes;
-    }
-    else {
-        copyBytes = _block_bytes;
-    }
+WirehairResult Codec::ExportEncoderState(
+    void * GF256_RESTRICT state_out,
+    uint64_t out_bytes,
+    uint64_t& bytes_out) const
+{
+    bytes_out = 0;
 
-    // If not enough space in output buffer:
-    if (out_buffer_bytes < copyBytes) {
-        return 0;
+    if (!_recovery_ready) {
+        return Wirehair_InvalidInput;
     }
 
-    uint8_t * GF256_RESTRICT data_out = reinterpret_cast<uint8_t *>( block_out );
+    const unsigned recovery_rows = _block_count + _mix_count;
+    const uint64_t state_bytes = kBlockAlignBytes + (uint64_t)_block_pitch * recovery_rows;
+    bytes_out = state_bytes;
 
-#if defined(CAT_COPY_FIRST_N)
-    // Note that if the encoder was a decoder the original message blocks may
-    // not be available, so we regenerate them each time using the recovery set.
-    // This means that wirehair_encode() after conversion will be slow for the
-    // set of original blocks.  I noted this in the API comments to help devs.
+    // If the application is asking for the size:
+    if (!state_out) {
+        return Wirehair_Success;
+    }
+    if (out_bytes < state_bytes) {
+        return Wirehair_InvalidInput;
+    }
 
-    // For the original message blocks (id < N):
-    if (block_id < _block_count &&
-        !_original_out_of_order)
-    {
-        const uint8_t * GF256_RESTRICT src = _input_blocks + _block_bytes * block_id;
+    uint8_t * GF256_RESTRICT out = reinterpret_cast<uint8_t *>( state_out );
 
-        // Copy from the original file data
-        memcpy(data_out, src, copyBytes);
-        return copyBytes;
-    }
-#endif // CAT_COPY_FIRST_N
+    EncoderStateHeader header;
+    header.Magic = kEncoderStateMagic;
+    header.Version = kEncoderStateVersion;
+    header.MessageBytes = (uint64_t)_block_bytes * (_block_count - 1) + _input_final_bytes;
+    header.BlockBytes = _block_bytes;
+    header.BlockPitch = _block_pitch;
+    header.RecoveryRows = recovery_rows;
+    header.PeelSeed = _p_seed;
+    header.DenseSeed = _d_seed;
+    header.DenseCount = _dense_count;
+    header.Code = UsesCauchyCode() ? kStateCodeCauchy : kStateCodeWirehair;
 
-    CAT_IF_DUMP(cout << "Encode: Generating row " << block_id << ":";)
+    memset(out, 0, kBlockAlignBytes);
+    memcpy(out, &header, sizeof(header));
 
-    PeelRowParameters params;
-    params.Initialize(block_id, _p_seed, _block_count, _mix_count);
+    // Recovery rows are contiguous at _block_pitch stride
+    memcpy(out + kBlockAlignBytes, _recovery_blocks, (size_t)_block_pitch * recovery_rows);
 
-    PeelRowIterator iter(params, _block_count, _block_next_prime);
-    const RowMixIterator mix(params, _mix_count, _mix_next_prime);
+    return Wirehair_Success;
+}
 
-    const uint16_t peel_0 = iter.GetColumn();
+WirehairResult Codec::ImportEncoderState(
+    const void * GF256_RESTRICT state,
+    uint64_t state_bytes,
+    const void * GF256_RESTRICT message_in)
+{
+    return LoadEncoderState(state, state_bytes, message_in, false);
+}
 
-    // Remember first column (there is always at least one)
-    CAT_DEBUG_ASSERT(peel_0 < _recovery_rows);
-    const uint8_t * GF256_RESTRICT first = _recovery_blocks + _block_bytes * peel_0;
+WirehairResult Codec::AttachEncoderState(
+    const void * GF256_RESTRICT state,
+    uint64_t state_bytes,
+    const void * GF256_RESTRICT message_in)
+{
+    return LoadEncoderState(state, state_bytes, message_in, true);
+}
 
-    CAT_IF_DUMP(cout << " " << peel_0;)
+WirehairResult Codec::LoadEncoderState(
+    const void * GF256_RESTRICT state,
+    uint64_t state_bytes,
+    const void * GF256_RESTRICT message_in,
+    bool in_place)
+{
+    const uint8_t * GF256_RESTRICT in = reinterpret_cast<const uint8_t *>( state );
 
-    CAT_DEBUG_ASSERT((unsigned)(_block_count + mix.Columns[0]) < _recovery_rows);
-    const uint8_t * GF256_RESTRICT mix0_src = _recovery_blocks + _block_bytes * (_block_count + mix.Columns[0]);
+    if (!in || state_bytes < kBlockAlignBytes) {
+        return Wirehair_InvalidInput;
+    }
 
-    // If peeler has multiple columns:
-    if (iter.Iterate())
+    EncoderStateHeader header;
+    memcpy(&header, in, sizeof(header));
+
+    if (header.Magic != kEncoderStateMagic ||
+        header.Version != kEncoderStateVersion ||
+        header.BlockPitch < header.BlockBytes)
     {
-        const uint16_t peel_1 = iter.GetColumn();
+        return Wirehair_InvalidInput;
+    }
 
-        CAT_IF_DUMP(cout << " " << peel_1;)
+    if (!SelectSavedCode(header.Code)) {
+        return Wirehair_InvalidInput;
+    }
 
-        CAT_DEBUG_ASSERT(peel_1 < _recovery_rows);
+    WirehairResult result = ChooseEncoderMatrix(header.MessageBytes, header.BlockBytes);
 
-        // Combine first two columns into output buffer (faster than memcpy + memxor)
-        gf256_addset_mem(
-            data_out,
-            first,
-            _recovery_blocks + _block_bytes * peel_1,
-            copyBytes);
+    // If the exporting encoder was using different seeds, use those instead
+    if (result == Wirehair_Success && !UsesCauchyCode() &&
+        (_p_seed != header.PeelSeed ||
+         _d_seed != header.DenseSeed ||
+         _dense_count != header.DenseCount))
+    {
+        OverrideSeeds((uint16_t)header.DenseCount, (uint16_t)header.PeelSeed, (uint16_t)header.DenseSeed);
+        result = ChooseEncoderMatrix(header.MessageBytes, header.BlockBytes);
 
-        // For each remaining peeler column:
-        while (iter.Iterate())
-        {
-            const uint16_t peel_x = iter.GetColumn();
+        // Pick seeds as usual if this codec is reused for another message
+        _seed_override = false;
+    }
 
-            CAT_IF_DUMP(cout << " " << peel_x;)
+    SelectSavedCode(kStateCodeNone);
 
-            CAT_DEBUG_ASSERT(peel_x < _recovery_rows);
+    if (result != Wirehair_Success) {
+        return result;
+    }
 
-            // Mix in each column
-            gf256_add_mem(
-                data_out,
-                _recovery_blocks + _block_bytes * peel_x,
-                copyBytes);
-        }
+    const unsigned recovery_rows = _block_count + _mix_count;
+    const uint64_t rows_bytes = (uint64_t)header.BlockPitch * recovery_rows;
 
-        CAT_DEBUG_ASSERT((unsigned)(_block_count + mix.Columns[0]) < _recovery_rows);
+    if (header.RecoveryRows != recovery_rows ||
+        state_bytes < kBlockAlignBytes + rows_bytes)
+    {
+        return Wirehair_InvalidInput;
+    }
 
-        // Mix first mixer block in directly
-        gf256_add_mem(data_out, mix0_src, copyBytes);
+    const uint8_t * GF256_RESTRICT rows = in + kBlockAlignBytes;
+
+    if (in_place)
+    {
+        // Encode() only reads the recovery set, so it can use the state as-is
+        FreeWorkspace();
+        _recovery_blocks = const_cast<uint8_t *>( rows );
+        _recovery_view = true;
+        _recovery_rows = recovery_rows;
+        _block_pitch = header.BlockPitch;
     }
     else
     {
-        CAT_DEBUG_ASSERT((unsigned)(_block_count + mix.Columns[0]) < _recovery_rows);
+        if (!AllocateWorkspace()) {
+            return Wirehair_OOM;
+        }
 
-        // Mix first with first mixer block (faster than memcpy + memxor)
-        gf256_addset_mem(data_out, first, mix0_src, copyBytes);
+        // The pitch may differ if the state came from another build
+        for (unsigned row_i = 0; row_i < recovery_rows; ++row_i) {
+            memcpy(_recovery_blocks + (size_t)_block_pitch * row_i,
+                rows + (size_t)header.BlockPitch * row_i, _block_bytes);
+        }
     }
 
-    CAT_IF_DUMP(cout << " " << (_block_count + mix.Columns[0]);)
-
-    // Add in remaining 2 mixer columns:
-
-    CAT_DEBUG_ASSERT((unsigned)(_block_count + mix.Columns[1]) < _recovery_rows);
-    const uint8_t * GF256_RESTRICT mix1_src = _recovery_blocks + _block_bytes * (_block_count + mix.Columns[1]);
-    CAT_IF_DUMP(cout << " " << (_block_count + mix.Columns[1]);)
-
-    CAT_DEBUG_ASSERT((unsigned)(_block_count + mix.Columns[2]) < _recovery_rows);
-    const uint8_t * GF256_RESTRICT mix2_src = _recovery_blocks + _block_bytes * (_block_count + mix.Columns[2]);
-    CAT_IF_DUMP(cout << " " << (_block_count + mix.Columns[2]);)
-
-    gf256_add2_mem(data_out, mix1_src, mix2_src, copyBytes);
+    // Without the message, original blocks are generated like repair blocks
+    SetInput(message_in);
+    _original_out_of_order = (message_in == nullptr);
 
-    CAT_IF_DUMP(cout << endl;)
+    AttachRepairRows();
+    _recovery_ready = true;
 
-    return copyBytes;
+    return Wirehair_Success;
 }
 
 
@@ -4183,9 +6274,18 @@ WirehairResult Codec::InitializeDecoder(
     }
 
     // Decoder-specific
+    _repair_rows.reset();
+    _recovery_ready = false;
     _row_count = 0;
+    _stepped_solve = false;
+    _pending_count = 0;
+    _decode_complete = false;
     _output_final_bytes = partial_final_bytes;
 
+    if (!_received_ids.Reset(_block_count)) {
+        return Wirehair_OOM;
+    }
+
     // Hack: Prevents row-based ids from causing partial copies when they
     // happen to be the last block id.  This is only an issue because the
     // shared codec source code happens to be built with more encoder-like
@@ -4216,6 +6316,13 @@ WirehairResult Codec::InitializeEncoderFromDecoder()
     CAT_DEBUG_ASSERT(_row_count >= _block_count);
 
 #if defined(CAT_ALL_ORIGINAL)
+#if defined(CAT_SMALL_N_MDS)
+    // The Cauchy code just needs the original data copied into order
+    if (_mds && _all_original) {
+        SolveMdsCauchy();
+    }
+    else
+#endif // CAT_SMALL_N_MDS
     // If all original data, return success (common case)
     if (_all_original)
     {
@@ -4243,20 +6350,61 @@ WirehairResult Codec::InitializeEncoderFromDecoder()
 
     // Set input final bytes to output final bytes
     _input_final_bytes = _output_final_bytes;
+    _recovery_ready = true;
+
+    AttachRepairRows();
 
     return Wirehair_Success;
 }
 
+void Codec::AttachRepairRows()
+{
+#if defined(CAT_SMALL_N_MDS)
+    // Cauchy rows are not sparse, so there is nothing to cache
+    if (_mds)
+    {
+        _repair_rows.reset();
+        return;
+    }
+#endif // CAT_SMALL_N_MDS
+
+    RepairRowKey key;
+    key.BlockCount = _block_count;
+    key.BlockNextPrime = _block_next_prime;
+    key.MixCount = _mix_count;
+    key.MixNextPrime = _mix_next_prime;
+    key.PeelSeed = _p_seed;
+
+    _repair_rows = RepairRowCache::GetInstance()->Acquire(key);
+}
+
 WirehairResult Codec::DecodeFeed(
     const uint32_t block_id,
     const void * GF256_RESTRICT block_in,
-    const unsigned block_bytes)
+    const unsigned block_bytes,
+    const uint32_t * expected_crc)
 {
     // Validate input
     if (!block_in) {
         return Wirehair_InvalidInput;
     }
 
+    // If a stepped solve is generating values, the matrix is already
+    // solved and this block is not needed
+    if (_solve_stage >= SolveStage_PeelValues) {
+        return Wirehair_InProgress;
+    }
+
+    // If the message was already recovered, this block is not needed
+    if (_decode_complete) {
+        return Wirehair_Success;
+    }
+
+    // If this block id was already used, the block adds nothing
+    if (_received_ids.Contains(block_id)) {
+        return (_solve_stage != SolveStage_Idle) ? Wirehair_InProgress : Wirehair_NeedMore;
+    }
+
     const bool isFinalBlock = ((block_id + 1) == (uint32_t)_block_count);
 
     // If this is the last block:
@@ -4276,6 +6424,30 @@ WirehairResult Codec::DecodeFeed(
         }
     }
 
+    const uint16_t row_i = _row_count;
+    const unsigned data_bytes = isFinalBlock ? _output_final_bytes : _block_bytes;
+
+    // If the block arrived with a checksum, verify it before any state changes
+    bool copied = false;
+    if (expected_crc)
+    {
+        uint32_t crc;
+
+        // If the row will be stored, checksum it while copying it into the
+        // free row slot, which is not read until _row_count moves past it
+        if (row_i < _block_count) {
+            crc = Crc32cCopy(0, GetInputBlock(row_i), block_in, data_bytes);
+            copied = true;
+        }
+        else {
+            crc = Crc32c(0, block_in, data_bytes);
+        }
+
+        if (crc != *expected_crc) {
+            return Wirehair_BadChecksum;
+        }
+    }
+
 #if defined(CAT_ALL_ORIGINAL)
     // If provided a block of non-original data, mark all original as false
     if (block_id >= _block_count) {
@@ -4283,21 +6455,44 @@ WirehairResult Codec::DecodeFeed(
     }
 #endif
 
-    const uint16_t row_i = _row_count;
+    // If a stepped solve is still deciding whether it needs more rows,
+    // hold on to the block until it knows
+    if (_solve_stage != SolveStage_Idle) {
+        return QueuePendingBlock(block_id, block_in, data_bytes);
+    }
 
     // If at least N rows stored:
     if (row_i >= _block_count)
     {
+        // The same row would fail to pivot again, so drop repeats of it
+        if (!_received_ids.Insert(block_id)) {
+            return Wirehair_OOM;
+        }
+
         // Resume GE from this row
         const WirehairResult result = ResumeSolveMatrix(block_id, block_in);
 
-        if (result == Wirehair_Success) {
+        if (result == Wirehair_Success)
+        {
+            // If the application will generate the values with SolveStep():
+            if (_stepped_solve) {
+                _solve_cursor = _peel_head_rows;
+                _solve_stage = SolveStage_PeelValues;
+                return Wirehair_InProgress;
+            }
+
             GenerateRecoveryBlocks();
+            _decode_complete = true;
         }
 
         return result;
     }
 
+    // Peeling cannot be undone, so make sure the id can be stored first
+    if (!_received_ids.Reserve()) {
+        return Wirehair_OOM;
+    }
+
     // If opportunistic peeling failed for this row:
     if (!OpportunisticPeeling(row_i, block_id))
     {
@@ -4308,23 +6503,19 @@ WirehairResult Codec::DecodeFeed(
         return Wirehair_NeedMore;
     }
 
-    uint8_t * GF256_RESTRICT dest = _input_blocks + _block_bytes * row_i;
-
-    // If this is the last block id:
-    if (isFinalBlock)
-    {
-        const uint32_t final_bytes = _output_final_bytes;
+    // Cannot fail after Reserve()
+    _received_ids.Insert(block_id);
 
-        // Copy the new row data into the input block area
-        memcpy(dest, block_in, final_bytes);
+    uint8_t * GF256_RESTRICT dest = GetInputBlock(row_i);
 
-        // Pad with zeros
-        memset(dest + final_bytes, 0, _block_bytes - final_bytes);
+    // Copy the new row data into the input block area
+    if (!copied) {
+        memcpy(dest, block_in, data_bytes);
     }
-    else
-    {
-        // Copy the new row data into the input block area
-        memcpy(dest, block_in, _block_bytes);
+
+    // If this is the last block id, pad with zeros:
+    if (isFinalBlock) {
+        memset(dest + data_bytes, 0, _block_bytes - data_bytes);
     }
 
     ++_row_count;
@@ -4345,20 +6536,224 @@ WirehairResult Codec::DecodeFeed(
             _all_original = false;
             return Wirehair_InvalidInput;
         }
+        _decode_complete = true;
         return Wirehair_Success;
     }
 #endif
 
+#if defined(CAT_SMALL_N_MDS)
+    // Any N Cauchy rows are enough, and solve quickly.  If the rows turn
+    // out to be dependent, the decoder is left with fewer than N rows
+    if (_mds)
+    {
+        const WirehairResult result = SolveMds();
+
+        if (result == Wirehair_Success) {
+            _decode_complete = true;
+        }
+
+        return result;
+    }
+#endif // CAT_SMALL_N_MDS
+
+    // If the application will solve with SolveStep():
+    if (_stepped_solve) {
+        _solve_stage = SolveStage_Peeling;
+        return Wirehair_InProgress;
+    }
+
     // Attempt to solve the matrix
     const WirehairResult result = SolveMatrix();
 
     // If solve was successful (common):
     if (result == Wirehair_Success) {
         GenerateRecoveryBlocks();
+        _decode_complete = true;
     }
 
     return result;
 }
 
+/*
+    Decoder checkpoint layout, in native byte order:
+
+        CheckpointHeader
+        uint32_t RowIds[RowCount]
+        (zero padding up to a multiple of kBlockAlignBytes)
+        uint8_t Blocks[RowCount][BlockBytes]
+
+    The peeling state is not stored.  It is rebuilt on load by replaying
+    OpportunisticPeeling() over the row ids, which only touches the small
+    per-row and per-column structures and keeps their layout private.
+    The block data is aligned so that a memory-mapped file can be loaded
+    without an extra copy into a staging buffer.
+*/
+
+/// Identifies a decoder checkpoint, and also that it has the same byte order
+static const uint32_t kCheckpointMagic = 0x43444857; // "WHDC"
+
+/// Increment when the checkpoint layout changes
+static const uint32_t kCheckpointVersion = 1;
+
+struct CheckpointHeader
+{
+    uint32_t Magic;
+    uint32_t Version;
+    uint64_t MessageBytes;
+    uint32_t BlockBytes;
+    uint32_t RowCount;
+    uint32_t PeelSeed;
+    uint32_t DenseSeed;
+    uint32_t DenseCount;
+    uint32_t Code;
+};
+
+/// Offset of the block data in a checkpoint with row_count rows
+static uint64_t GetCheckpointDataOffset(uint32_t row_count)
+{
+    const uint64_t bytes = sizeof(CheckpointHeader) + sizeof(uint32_t) * (uint64_t)row_count;
+    return (bytes + kBlockAlignBytes - 1) & ~(uint64_t)(kBlockAlignBytes - 1);
+}
+
+WirehairResult Codec::SaveDecoderState(
+    void * GF256_RESTRICT state_out,
+    uint64_t out_bytes,
+    uint64_t& bytes_out) const
+{
+    bytes_out = 0;
+
+    // Once N rows have arrived the solver owns the rows, so only a decoder
+    // that is still peeling can be saved
+    if (_row_count >= _block_count ||
+        _solve_stage != SolveStage_Idle ||
+        _decode_complete)
+    {
+        return Wirehair_InvalidInput;
+    }
+
+    const uint64_t data_offset = GetCheckpointDataOffset(_row_count);
+    const uint64_t state_bytes = data_offset + (uint64_t)_block_bytes * _row_count;
+    bytes_out = state_bytes;
+
+    // If the application is asking for the size:
+    if (!state_out) {
+        return Wirehair_Success;
+    }
+    if (out_bytes < state_bytes) {
+        return Wirehair_InvalidInput;
+    }
+
+    uint8_t * GF256_RESTRICT out = reinterpret_cast<uint8_t *>( state_out );
+
+    CheckpointHeader header;
+    header.Magic = kCheckpointMagic;
+    header.Version = kCheckpointVersion;
+    header.MessageBytes = (uint64_t)_block_bytes * (_block_count - 1) + _output_final_bytes;
+    header.BlockBytes = _block_bytes;
+    header.RowCount = _row_count;
+    header.PeelSeed = _p_seed;
+    header.DenseSeed = _d_seed;
+    header.DenseCount = _dense_count;
+    header.Code = UsesCauchyCode() ? kStateCodeCauchy : kStateCodeWirehair;
+    memcpy(out, &header, sizeof(header));
+
+    uint8_t * ids = out + sizeof(header);
+    for (unsigned row_i = 0; row_i < _row_count; ++row_i, ids += sizeof(uint32_t)) {
+        memcpy(ids, &_peel_rows[row_i].RecoveryId, sizeof(uint32_t));
+    }
+    memset(ids, 0, (size_t)(out + data_offset - ids));
+
+    uint8_t * GF256_RESTRICT data = out + data_offset;
+    for (unsigned row_i = 0; row_i < _row_count; ++row_i, data += _block_bytes) {
+        memcpy(data, GetInputBlock(row_i), _block_bytes);
+    }
+
+    return Wirehair_Success;
+}
+
+WirehairResult Codec::LoadDecoderState(
+    const void * GF256_RESTRICT state,
+    uint64_t state_bytes)
+{
+    const uint8_t * GF256_RESTRICT in = reinterpret_cast<const uint8_t *>( state );
+
+    if (!in || state_bytes < sizeof(CheckpointHeader)) {
+        return Wirehair_InvalidInput;
+    }
+
+    CheckpointHeader header;
+    memcpy(&header, in, sizeof(header));
+
+    if (header.Magic != kCheckpointMagic ||
+        header.Version != kCheckpointVersion)
+    {
+        return Wirehair_InvalidInput;
+    }
+
+    if (!SelectSavedCode(header.Code)) {
+        return Wirehair_InvalidInput;
+    }
+
+    WirehairResult result = InitializeDecoder(header.MessageBytes, header.BlockBytes);
+
+    // If the saved decoder was using different seeds, use those instead
+    if (result == Wirehair_Success && !UsesCauchyCode() &&
+        (_p_seed != header.PeelSeed ||
+         _d_seed != header.DenseSeed ||
+         _dense_count != header.DenseCount))
+    {
+        OverrideSeeds((uint16_t)header.DenseCount, (uint16_t)header.PeelSeed, (uint16_t)header.DenseSeed);
+        result = InitializeDecoder(header.MessageBytes, header.BlockBytes);
+
+        // Pick seeds as usual if this codec is reused for another message
+        _seed_override = false;
+    }
+
+    SelectSavedCode(kStateCodeNone);
+
+    if (result != Wirehair_Success) {
+        return result;
+    }
+
+    const uint64_t data_offset = GetCheckpointDataOffset(header.RowCount);
+
+    if (header.RowCount >= _block_count ||
+        state_bytes < data_offset + (uint64_t)_block_bytes * header.RowCount)
+    {
+        return Wirehair_InvalidInput;
+    }
+
+    const uint8_t * ids = in + sizeof(header);
+    const uint8_t * GF256_RESTRICT data = in + data_offset;
+
+    // Replay the rows in the order they were stored
+    for (uint16_t row_i = 0; row_i < header.RowCount; ++row_i, ids += sizeof(uint32_t), data += _block_bytes)
+    {
+        uint32_t block_id;
+        memcpy(&block_id, ids, sizeof(uint32_t));
+
+        // A row that was stored before cannot be a duplicate or fail to peel
+        if (_received_ids.Contains(block_id) ||
+            !OpportunisticPeeling(row_i, block_id))
+        {
+            return Wirehair_InvalidInput;
+        }
+        if (!_received_ids.Insert(block_id)) {
+            return Wirehair_OOM;
+        }
+
+#if defined(CAT_ALL_ORIGINAL)
+        if (block_id >= _block_count) {
+            _all_original = false;
+        }
+#endif
+
+        memcpy(GetInputBlock(row_i), data, _block_bytes);
+        ++_row_count;
+    }
+
+    return Wirehair_Success;
+}
+
 
 } // namespace wirehair
@@ -209,6 +209,11 @@
 */
 
 #include "WirehairTools.h"
+#include "WirehairRowCache.h"
+
+#include <vector>
+#include <memory>
+#include <mutex>
 
 namespace wirehair {
 
@@ -298,6 +303,20 @@ struct PeelRefs
 };
 
 
+/// Code to use for small N in ChooseMatrix()
+enum class SmallNChoice
+{
+    /// Cauchy code up to the limit set by Codec::ConfigureSmallN()
+    Configured,
+
+    /// Always the Wirehair code, for example to load its saved state
+    Wirehair,
+
+    /// Always the Cauchy code, for example to load its saved state
+    Cauchy
+};
+
+
 //------------------------------------------------------------------------------
 // Codec
 
@@ -309,6 +328,13 @@ class Codec
     /// Number of bytes in a block
     unsigned _block_bytes = 0;
 
+    /// Bytes between consecutive rows of _recovery_blocks
+    unsigned _block_pitch = 0;
+
+    /// Bytes between consecutive rows of _input_blocks.  This is the block
+    /// size when the encoder reads the caller's message in place
+    unsigned _input_pitch = 0;
+
     /// Number of blocks in the message
     uint16_t _block_count = 0;
 
@@ -342,6 +368,13 @@ class Codec
     /// Recovery blocks
     uint8_t * GF256_RESTRICT _recovery_blocks = nullptr;
 
+    /// Boolean: _recovery_blocks holds a solved recovery set for Encode()
+    bool _recovery_ready = false;
+
+    /// Boolean: _recovery_blocks is read-only memory owned by the
+    /// application, from AttachEncoderState()
+    bool _recovery_view = false;
+
     /// For debugging only: Maximum number of recovery rows
     unsigned _recovery_rows = 0;
 
@@ -357,16 +390,50 @@ class Codec
     /// Number of bytes allocated for input, or 0 if referenced
     uint64_t _input_allocated = 0;
 
+    /// Pointer to each input block when the message is split across
+    /// segments, or nullptr if input rows are at _input_pitch stride
+    uint8_t ** _input_rows = nullptr;
+
+    /// _input_rows, then aligned copies of blocks that straddle segments
+    uint8_t * GF256_RESTRICT _input_segment_workspace = nullptr;
+
+    /// Number of bytes allocated for _input_segment_workspace
+    uint64_t _input_segment_allocated = 0;
+
+    /// Offset added to input rows by GenerateRecoveryTiles()
+    unsigned _input_offset = 0;
+
 #if defined(CAT_ALL_ORIGINAL)
     /// Boolean: Only seen original data block identifiers
     bool _all_original = false;
 #endif
 
+#if defined(CAT_SMALL_N_MDS)
+    /// Boolean: The message is small enough to use the Cauchy code
+    bool _mds = false;
+
+    /// Code that the next ChooseMatrix() picks for small N
+    SmallNChoice _small_n_choice = SmallNChoice::Configured;
+
+    /// Wirehair encoder of the N x N identity matrix, which gives the
+    /// coefficients of repair rows past the Cauchy rows
+    mutable std::unique_ptr<Codec> _sparse_rows;
+
+    /// Lock for _sparse_rows, which Encode() creates on first use
+    mutable std::mutex _sparse_rows_lock;
+#endif
+
     uint8_t * GF256_RESTRICT _copied_original = nullptr;
 
     /// Boolean: Original blocks are out of order?
     bool _original_out_of_order = false;
 
+    /// Boolean: Decoder has succeeded, so further blocks are ignored
+    bool _decode_complete = false;
+
+    /// Block ids already used by DecodeFeed(), so duplicates are dropped
+    ReceivedIdFilter _received_ids;
+
 
     //--------------------------------------------------------------------------
     // Peeling state
@@ -386,6 +453,14 @@ class Codec
     /// Number of bytes allocated for workspace
     uint64_t _workspace_allocated = 0;
 
+    /// Unused space at the end of the workspace allocation, which
+    /// AllocateMatrix() takes before allocating on its own
+    uint8_t * GF256_RESTRICT _workspace_tail = nullptr;
+    uint64_t _workspace_tail_bytes = 0;
+
+    /// Extra bytes the next AllocateWorkspace() should leave at the end
+    uint64_t _matrix_reserve = 0;
+
     /// Terminator for list (like nullptr in a linked list)
     static const uint16_t LIST_TERM = 0xffff;
 
@@ -408,12 +483,22 @@ class Codec
     /// Gaussian elimination compression matrix
     uint64_t * GF256_RESTRICT _compress_matrix = nullptr;
 
+    /// Nonzero for each compression matrix row that has been written.
+    /// Other rows hold stale data and are cleared on first use
+    uint8_t * GF256_RESTRICT _compress_dirty = nullptr;
+
     /// Gaussian elimination matrix
     uint64_t * GF256_RESTRICT _ge_matrix = nullptr;
 
     /// Number of bytes allocated to GE matrix
     uint64_t _ge_allocated = 0;
 
+    /// Boolean: The GE matrix is in _workspace_tail and is not freed alone
+    bool _ge_in_workspace = false;
+
+    /// Bytes used by the last AllocateMatrix()
+    uint64_t _ge_bytes = 0;
+
     /// Words per row of GE matrix and compression matrix
     unsigned _ge_pitch = 0;
 
@@ -436,6 +521,108 @@ class Codec
     unsigned _next_pivot = 0;
 
 
+    //--------------------------------------------------------------------------
+    // Stepped solver state
+
+    /// Stages of the solver run by SolveStep()
+    enum SolveStages
+    {
+        SolveStage_Idle,       ///< No solve pending
+        SolveStage_Peeling,    ///< GreedyPeeling()
+        SolveStage_Compress,   ///< PeelDiagonal()
+        SolveStage_Triangle,   ///< CompressAndTriangle()
+        SolveStage_PeelValues, ///< PeelDiagonalValues()
+        SolveStage_GEValues,   ///< InitializeColumnValues() .. BackSubstituteAboveDiagonal()
+        SolveStage_Substitute  ///< Substitute()
+    };
+
+    /// Boolean: DecodeFeed() leaves solving to SolveStep()
+    bool _stepped_solve = false;
+
+    /// One of the SolveStages enumeration
+    uint8_t _solve_stage = SolveStage_Idle;
+
+    /// Peeled row to resume the current stage from
+    uint16_t _solve_cursor = 0;
+
+    /// Blocks that arrived while the solve could still need more rows
+    uint8_t * GF256_RESTRICT _pending_blocks = nullptr;
+
+    /// Block ids of the _pending_blocks, in order of arrival
+    uint32_t _pending_ids[CAT_MAX_EXTRA_ROWS];
+
+    /// Number of blocks in _pending_blocks
+    unsigned _pending_count = 0;
+
+    /// Number of bytes allocated for _pending_blocks
+    uint64_t _pending_allocated = 0;
+
+
+    //--------------------------------------------------------------------------
+    // Column cache
+
+    /// Offset of a row that is not in the column cache
+    static const uint32_t kUncachedRow = 0xffffffff;
+
+    /// Bytes the application allows for the column cache, or 0 to disable
+    uint32_t _column_cache_limit = 0;
+
+    /// Bytes allocated for the column cache
+    uint32_t _column_cache_allocated = 0;
+
+    /// Offset into _column_cache of each of the first N rows.
+    /// This is also the start of the allocation
+    uint32_t * GF256_RESTRICT _column_cache_offsets = nullptr;
+
+    /// Mix columns then peel columns of each cached row, in row order
+    uint16_t * GF256_RESTRICT _column_cache = nullptr;
+
+    /// Entries in _column_cache, and entries used so far
+    uint32_t _column_cache_capacity = 0, _column_cache_used = 0;
+
+
+    //--------------------------------------------------------------------------
+    // Repair row cache
+
+    /// Shared rows for repair ids starting at N, or nullptr
+    std::shared_ptr<const RepairRowTable> _repair_rows;
+
+    /// Look up the shared rows for this matrix once it is chosen
+    void AttachRepairRows();
+
+
+    //--------------------------------------------------------------------------
+    // Deferral strategy
+
+    /// One of the WirehairDeferStrategy enumeration
+    uint8_t _defer_strategy = Wirehair_Defer_Weight2;
+
+    /// PickDeferInactivation() queues a column from each weight-2 component
+    /// at least 1/kDeferBatchDivisor the size of the largest one
+    static const unsigned kDeferBatchDivisor = 4;
+
+    /// Scratch space for PickDeferInactivation() during GreedyPeeling()
+    struct DeferWorkspace
+    {
+        /// Union-find parent, component size, weight-2 row count and
+        /// chosen column, for each column
+        std::vector<uint16_t> Parent, Size, Degree, Best;
+
+        /// Rows that had two or more unmarked columns at the last pass
+        std::vector<uint16_t> Pending;
+
+        /// Two unmarked columns of each weight-2 row
+        std::vector<uint32_t> Edges;
+
+        /// Component size and chosen column, for sorting
+        std::vector<uint32_t> Order;
+
+        /// Columns to defer next, from the largest component down
+        std::vector<uint16_t> Candidates;
+        unsigned NextCandidate = 0;
+    };
+
+
     //--------------------------------------------------------------------------
     // Heavy submatrix
 
@@ -503,13 +690,15 @@ class Codec
         _input_blocks data, but this function does take care of
         initializing everything else for a new row, including the
         row ID number and the peeling column generator parameters.
+        Bulk callers may pass parameters from InitializePeelRowBatch().
 
         Returns true on success.
         Returns false if there was not enough space in the reference list.
     */
     bool OpportunisticPeeling(
         const uint16_t row_i, ///< Row index
-        const uint32_t row_seed ///< Row PRNG seed
+        const uint32_t row_seed, ///< Row PRNG seed
+        const PeelRowParameters* params = nullptr ///< Precomputed parameters or null
     );
 
     /**
@@ -578,8 +767,49 @@ class Codec
         In practice with a well-designed (good distribution) peeling matrix,
         about sqrt(N) + N/150 columns must be deferred to Gaussian elimination
         using this greedy approach.
+
+        With Wirehair_Defer_Inactivation the columns are chosen by
+        PickDeferInactivation() instead.
+
+        Pass 0 for defer_limit to run to completion.  Otherwise it returns
+        after deferring that many columns, and can be called again to resume.
+
+        Returns true when all columns are marked.
+        Returns false if it stopped early.
+    */
+    bool GreedyPeeling(unsigned defer_limit);
+
+    /**
+        PickDeferWeight2()
+
+        Returns the unmarked column with the most weight-2 row references,
+        breaking ties by the most row references overall.
+        Returns LIST_TERM if all columns are marked.
     */
-    void GreedyPeeling();
+    uint16_t PickDeferWeight2() const;
+
+    /**
+        PickDeferInactivation()
+
+        Inactivation decoding as in RaptorQ (RFC 6330 section 5.4.2.2),
+        where deferring a column is an inactivation.
+
+        Of the rows that are not solved yet, it looks at the ones with the
+        fewest unmarked columns.  If those have two left, then the rows form
+        a graph with an edge between the two columns of each row.  Deferring
+        any column in a tree-shaped component lets peeling solve the rest of
+        it.  So it defers the column with the most edges in the largest
+        component, and queues the same choice for the next largest ones to
+        save passes over the rows.  Otherwise it defers the column of that
+        row with the most row references, and the row moves one step closer
+        to solving a column by itself.
+
+        This usually defers 5-8% fewer columns than PickDeferWeight2(),
+        which makes the GE matrix smaller.
+
+        Returns LIST_TERM if no unsolved row has an unmarked column.
+    */
+    uint16_t PickDeferInactivation(DeferWorkspace& ws);
 
     /** \page Peeling Solver Output
 
@@ -705,7 +935,8 @@ class Codec
         This function diagonalizes the peeled rows and columns of the
         matrix.  The result is that the peeled submatrix is the identity
         matrix, and that the other columns of the peeled rows are very
-        dense and have temporary block values assigned.
+        dense.  The matching temporary block values are assigned later
+        by PeelDiagonalValues().
 
         These dense columns are used to efficiently zero-out the peeled
         columns of the other rows.
@@ -715,13 +946,36 @@ class Codec
 
         For each peeled row in forward solution order,
             Set mixing column bits for the row in the Compression matrix.
-            Generate row block value.
             For each row that references this row in the peeling matrix,
                 Add Compression matrix row to referencing row.
-                If row is peeled,
-                    Add row block value.
+
+        It processes at most row_limit rows (0 = all) starting from the given
+        peeled row, and returns the row to resume from, or LIST_TERM when done.
+    */
+    uint16_t PeelDiagonal(
+        uint16_t peel_row_i, ///< First peeled row to process
+        unsigned row_limit ///< Maximum rows to process, or 0 for all
+    );
+
+    /**
+        PeelDiagonalValues()
+
+        This function follows the same order of operations as PeelDiagonal()
+        to generate the temporary block values for the peeled columns.
+        It only reads the matrix structure, so it can be repeated with
+        different input data after the matrix has been solved.
+
+        For each peeled row in forward solution order,
+            Generate row block value.
+            For each peeled row that references this row,
+                Add row block value.
+
+        Resumes like PeelDiagonal().  A pass starts at _peel_head_rows.
     */
-    void PeelDiagonal();
+    uint16_t PeelDiagonalValues(
+        uint16_t peel_row_i, ///< First peeled row to process
+        unsigned row_limit ///< Maximum rows to process, or 0 for all
+    );
 
     /**
         CopyDeferredRows()
@@ -1142,8 +1396,60 @@ class Codec
         and substitute into that matrix.  However, because the mixing columns
         are so dense, it is actually faster in every case to just regenerate
         the rows from scratch and throw away those results.
+
+        Resumes like PeelDiagonal().
     */
-    void Substitute();
+    /// Regenerate one peeled row into its column.  Returns row ops used
+    unsigned SubstituteRow(
+        uint16_t row_i ///< Peeled row to regenerate
+    );
+
+    /// Prefetch the blocks that SubstituteRow() will touch for this row.
+    /// Only worth it for blocks of at least kMinPrefetchRowBytes.
+    /// Returns the number of blocks prefetched
+    unsigned PrefetchSubstituteRow(
+        uint16_t row_i ///< Peeled row to be regenerated soon
+    ) const;
+
+    uint16_t Substitute(
+        uint16_t row_i, ///< First peeled row to process
+        unsigned row_limit ///< Maximum rows to process, or 0 for all
+    );
+
+
+    /// Runs the value stages of GenerateRecoveryBlocks() over _block_bytes
+    void GenerateRecoveryValues();
+
+#if defined(CAT_TILED_SOLVE)
+    /// Cache budget for one tile of the value stages, about one L2 cache
+    static const unsigned kSolveTileCacheBytes = 512 * 1024;
+
+    /// Smallest tile worth another pass through the solution
+    static const unsigned kMinSolveTileBytes = 16 * 1024;
+
+    /**
+        GetSolveTileBytes()
+
+        Returns the tile width at which one byte range of every recovery
+        and input row fits in kSolveTileCacheBytes, rounded down to a whole
+        number of cache lines and no smaller than kMinSolveTileBytes.
+    */
+    unsigned GetSolveTileBytes() const;
+
+    /**
+        GenerateRecoveryTiles()
+
+        Runs GenerateRecoveryValues() once per tile_bytes wide byte range
+        of every block, by offsetting the recovery and input rows to the
+        tile and shrinking _block_bytes to its width for the pass.  All of the
+        value stages work byte-wise, so this produces the same output.
+
+        With blocks of hundreds of kilobytes each row op otherwise streams
+        its whole block from memory, and nothing is still in cache by the
+        time a dependent row op reads it back.
+    */
+    void GenerateRecoveryTiles(unsigned tile_bytes);
+#endif // CAT_TILED_SOLVE
 
 
     //--------------------------------------------------------------------------
@@ -1155,6 +1461,22 @@ class Codec
         uint64_t message_bytes,
         unsigned block_bytes);
 
+    /// ChooseMatrix() and set up the encoder fields, without allocating
+    WirehairResult ChooseEncoderMatrix(
+        uint64_t message_bytes,
+        unsigned block_bytes);
+
+    /// Make the next ChooseMatrix() pick the code named in saved state.
+    /// Returns false if the code is unknown or not built in
+    bool SelectSavedCode(uint32_t code);
+
+    /// Shared by ImportEncoderState() and AttachEncoderState()
+    WirehairResult LoadEncoderState(
+        const void * GF256_RESTRICT state,
+        uint64_t state_bytes,
+        const void * GF256_RESTRICT message_in,
+        bool in_place);
+
     /**
         SolveMatrix()
 
@@ -1190,6 +1512,25 @@ class Codec
     */
     WirehairResult SolveMatrix();
 
+    /// Peel every input row, then solve and generate the recovery blocks
+    WirehairResult EncodeInput();
+
+    /// Add the change to one input block into the recovery blocks, for
+    /// UpdateInput().  The input block must still hold the old data
+    WirehairResult UpdateRecoveryBlocks(
+        const unsigned block_id,
+        const void * GF256_RESTRICT block_in,
+        const unsigned copyBytes
+    );
+
+    /// Allocate the GE matrix and start the Compression matrix.
+    /// Returns false on OOM
+    bool SetupCompression();
+
+    /// Finish compression after PeelDiagonal() and run Triangle().
+    /// Returns false if more rows are needed
+    bool CompressAndTriangle();
+
     /**
         ResumeSolveMatrix()
 
@@ -1219,6 +1560,86 @@ class Codec
 #endif
 
 
+#if defined(CAT_SMALL_N_MDS)
+    //--------------------------------------------------------------------------
+    // Small N Cauchy Code
+
+    /*
+        For small N the peeling, dense rows and GE cost more to set up than
+        the blocks cost to process, and Wirehair may still need an extra
+        block or two.  So when enabled by ConfigureSmallN(), a systematic
+        Cauchy code over GF(256) is used instead.
+
+        Block ids below N are the message blocks, and repair block id x
+        below 256 is:
+
+            sum over j < N of 1/(x + j) * block j
+
+        Any N of these blocks recover the message.  There are only 256 - N
+        Cauchy rows, so repair ids from 256 up are the rows of the Wirehair
+        code for the same N, written over the message blocks.  With those
+        rows in the mix a few extra blocks may be needed, as for Wirehair.
+
+        The recovery set is a copy of the message blocks.
+    */
+
+    /// First block id that is a Wirehair row rather than a Cauchy row
+    static const uint32_t kMdsSparseFirstId = 256;
+
+    /**
+        GetMdsCoefficients()
+
+        Write the N coefficients of block_id over the message blocks.
+        Rows past the Cauchy rows come from _sparse_rows, which is built
+        the first time it is needed.  Returns false on OOM.
+    */
+    bool GetMdsCoefficients(
+        const uint32_t block_id,
+        uint8_t * coeffs_out
+    ) const;
+
+    /**
+        SolveMds()
+
+        Fill the recovery set from the N received rows.
+
+        If they are all message blocks or Cauchy rows, received message
+        blocks are copied, and the rest are solved from the repair rows
+        using the closed-form inverse of the Cauchy submatrix.  The repair
+        rows are overwritten.
+
+        Otherwise the coefficient matrix is inverted by Gauss-Jordan
+        elimination.  If it is singular, the rows that add nothing are
+        dropped and Wirehair_NeedMore is returned.
+    */
+    WirehairResult SolveMds();
+
+    /// Solve the received rows if they only hold Cauchy rows
+    void SolveMdsCauchy();
+
+    /// Solve any N received rows, or drop dependent rows
+    WirehairResult SolveMdsGeneral();
+
+    /// Sum bytes of the recovery set by coeffs starting at offset
+    void SumMdsRow(
+        const uint8_t * coeffs,
+        uint8_t * GF256_RESTRICT data_out,
+        unsigned offset,
+        unsigned bytes
+    ) const;
+#endif // CAT_SMALL_N_MDS
+
+    /// True if the message uses the small N Cauchy code
+    GF256_FORCE_INLINE bool UsesCauchyCode() const
+    {
+#if defined(CAT_SMALL_N_MDS)
+        return _mds;
+#else
+        return false;
+#endif
+    }
+
+
     //--------------------------------------------------------------------------
     // Memory Management
 
@@ -1226,12 +1647,139 @@ class Codec
     bool AllocateInput();
     void FreeInput();
 
+    /**
+        SetInputSegments()
+
+        Points _input_rows at each block of a message that is split across
+        several buffers.  Blocks inside one segment are read in place, and
+        blocks that straddle segments are gathered into a copy.
+
+        Returns Wirehair_InvalidInput if the segments do not add up to the
+        message size passed to InitializeEncoder().
+    */
+    WirehairResult SetInputSegments(
+        const WirehairSegment * segments,
+        unsigned segment_count);
+
+    void FreeInputSegments();
+
+    /// Get an input block
+    GF256_FORCE_INLINE uint8_t * GetInputBlock(unsigned row_i) const
+    {
+        if (_input_rows) {
+            return _input_rows[row_i] + _input_offset;
+        }
+        return _input_blocks + _input_pitch * row_i + _input_offset;
+    }
+
     bool AllocateMatrix();
+
+    /// Get a compression matrix row to modify, clearing it on first use
+    GF256_FORCE_INLINE uint64_t * GetCompressRow(uint16_t row_i)
+    {
+        uint64_t * GF256_RESTRICT row = _compress_matrix + _ge_pitch * row_i;
+        if (!_compress_dirty[row_i])
+        {
+            memset(row, 0, _ge_pitch * sizeof(uint64_t));
+            _compress_dirty[row_i] = 1;
+        }
+        return row;
+    }
+
     void FreeMatrix();
 
     bool AllocateWorkspace();
     void FreeWorkspace();
 
+    /**
+        AllocateColumnCache()
+
+        OpportunisticPeeling() stores the mix and peel columns of each row
+        it sees, up to _column_cache_limit bytes.  The later stages of the
+        same solve read them back with CachedPeelRowIterator instead of
+        stepping the column generators again.  Rows that did not fit are
+        regenerated as before.
+
+        Called from AllocateWorkspace() to empty the cache for a new solve.
+        Returns false if the cache is disabled or could not be allocated.
+    */
+    bool AllocateColumnCache();
+    void FreeColumnCache();
+
+    /**
+        QueuePendingBlock()
+
+        Store a block that arrived during a stepped solve.  The solve may
+        still end up short of rows, and then ResumePendingBlocks() feeds
+        the stored blocks to ResumeSolveMatrix() in order of arrival.
+
+        Returns Wirehair_InProgress if the block was stored.
+        Returns Wirehair_WouldBlock if the queue is full.
+        Returns Wirehair_OOM if the queue could not be allocated.
+    */
+    WirehairResult QueuePendingBlock(
+        uint32_t block_id, ///< Block ID
+        const void * GF256_RESTRICT block_in, ///< Block data
+        unsigned data_bytes ///< Bytes of block data
+    );
+
+    /**
+        ResumePendingBlocks()
+
+        Called when a stepped solve needs more rows.  Blocks left over
+        once the matrix is solved are not needed, and the queue is emptied
+        either way.
+
+        Returns Wirehair_Success if the queued blocks completed the matrix.
+        Returns Wirehair_NeedMore if more blocks are needed.
+        Returns other codes on error.
+    */
+    WirehairResult ResumePendingBlocks();
+    void FreePendingBlocks();
+
+    /// Returns the cached columns of a row, or nullptr if not cached
+    GF256_FORCE_INLINE const uint16_t * GetCachedRow(uint16_t row_i) const
+    {
+        if (_column_cache_capacity == 0 || row_i >= _block_count) {
+            return nullptr;
+        }
+        const uint32_t offset = _column_cache_offsets[row_i];
+        return (offset != kUncachedRow) ? _column_cache + offset : nullptr;
+    }
+
+
+    //--------------------------------------------------------------------------
+    // Output Helpers
+
+    /**
+        GetEncodeSources()
+
+        Fills srcs with the recovery blocks that sum to block_id, sorted by
+        address, and prefetches prefetch_bytes of each.  Returns the count.
+    */
+    unsigned GetEncodeSources(
+        const uint32_t block_id,
+        const uint8_t ** srcs,
+        unsigned prefetch_bytes
+    ) const;
+
+    /// Sum bytes of the sources starting at offset into data_out
+    void SumEncodeSources(
+        uint8_t * GF256_RESTRICT data_out,
+        const uint8_t * const * srcs,
+        unsigned src_count,
+        unsigned offset,
+        unsigned bytes
+    ) const;
+
+    /// Write each block to output_rows[block_id] if provided, or otherwise
+    /// to output_blocks at a stride of _block_bytes.  If block_crcs is
+    /// provided, it is set to the CRC32C of each block as it is written
+    void ReconstructOutputRows(
+        uint8_t * GF256_RESTRICT output_blocks,
+        uint8_t * const * output_rows,
+        uint32_t * block_crcs = nullptr);
+
 public:
     Codec();
     ~Codec();
@@ -1243,6 +1791,15 @@ public:
     GF256_FORCE_INLINE uint32_t PSeed() const { return _p_seed; }
     GF256_FORCE_INLINE uint32_t CSeed() const { return _d_seed; }
     GF256_FORCE_INLINE uint32_t BlockCount() const { return _block_count; }
+    GF256_FORCE_INLINE unsigned BlockBytes() const { return _block_bytes; }
+
+    /// Bytes of block data and solver state currently allocated
+    GF256_FORCE_INLINE uint64_t AllocatedBytes() const
+    {
+        return _input_allocated + _input_segment_allocated +
+            _workspace_allocated + _ge_allocated + _column_cache_allocated +
+            _pending_allocated;
+    }
 
 
     //--------------------------------------------------------------------------
@@ -1254,11 +1811,36 @@ public:
         uint16_t p_seed,
         uint16_t d_seed);
 
+    /**
+        ConfigureSmallN()
+
+        Use the Cauchy code for messages of up to max_n blocks, for all
+        codecs initialized after this call.  0 disables it (the default).
+        Returns Wirehair_InvalidInput if max_n is above CAT_MDS_MAX_N, or
+        Wirehair_UnsupportedPlatform if built without CAT_SMALL_N_MDS.
+    */
+    static WirehairResult ConfigureSmallN(unsigned max_n);
+
     /// Initialize encoder mode
     WirehairResult InitializeEncoder(
         uint64_t message_bytes,
         unsigned block_bytes);
 
+    /**
+        SetMatrixReserve()
+
+        Have the next AllocateWorkspace() leave this many bytes at the end
+        of its allocation for AllocateMatrix(), so that a solve makes one
+        large allocation instead of two.  The matrix size is only known
+        after peeling, so pass MatrixBytes() from an earlier codec with the
+        same message and block size.  Too small a reserve is not an error,
+        and AllocateMatrix() allocates as before.
+    */
+    GF256_FORCE_INLINE void SetMatrixReserve(uint64_t bytes) { _matrix_reserve = bytes; }
+
+    /// Bytes used by the GE matrix of the last solve
+    GF256_FORCE_INLINE uint64_t MatrixBytes() const { return _ge_bytes; }
+
     /**
         EncodeFeed()
 
@@ -1273,6 +1855,16 @@ public:
     */
     WirehairResult EncodeFeed(const void * GF256_RESTRICT message_in);
 
+    /**
+        EncodeFeedSegments()
+
+        Same as EncodeFeed() for a message that is the concatenation of
+        segment_count buffers.  See SetInputSegments().
+    */
+    WirehairResult EncodeFeedSegments(
+        const WirehairSegment * segments,
+        unsigned segment_count);
+
     /**
         Encode()
 
@@ -1280,11 +1872,124 @@ public:
         it simply copies the input to the output block.  For other
         block identifiers, it will generate a new random row and
         sum together recovery blocks to produce the new block.
+
+        Repair ids covered by the shared RepairRowTable skip the row
+        generation and read the columns from the table instead.
+
+        It only reads the input and recovery blocks, so once the
+        recovery set is generated it may be called from any number of
+        threads at once.  Calls that modify the codec (UpdateInput(),
+        re-initialization) must not overlap with it.
+
+        If crc_out is provided, it is set to the CRC32C of the bytes
+        written, computed while the block is still in cache.
     */
     uint32_t Encode(
         const uint32_t block_id, ///< Block id to generate
         void * GF256_RESTRICT block_out, ///< Block data output
-        uint32_t out_buffer_bytes ///< Output buffer bytes
+        uint32_t out_buffer_bytes, ///< Output buffer bytes
+        uint32_t * crc_out = nullptr ///< Optional CRC32C of the block
+    ) const;
+
+    /**
+        GetOriginalBlock()
+
+        Returns a pointer to the original data of block_id and sets
+        bytes_out to its size, or returns nullptr if the block must be
+        generated by Encode() instead.
+    */
+    const uint8_t * GetOriginalBlock(
+        const uint32_t block_id, ///< Block id to look up
+        uint32_t& bytes_out ///< Set to the bytes in the block
+    ) const;
+
+    /**
+        EncodeSegments()
+
+        Same as Encode(), but the block is written across the segments in
+        order, filling each one before moving on to the next.  Each piece is
+        summed straight into its segment, so there is no staging copy.
+
+        Returns 0 if the segments cannot hold the block.
+    */
+    uint32_t EncodeSegments(
+        const uint32_t block_id, ///< Block id to generate
+        const WirehairOutputSegment * segments, ///< Output segments
+        unsigned segment_count ///< Number of segments
+    ) const;
+
+    /**
+        ExportEncoderState()
+
+        Write the solved recovery set and the parameters needed to encode
+        with it, so that ImportEncoderState() or AttachEncoderState() can
+        skip EncodeFeed().  If state_out is null, only bytes_out is set to
+        the size needed.
+
+        The recovery blocks start kBlockAlignBytes into the state and keep
+        their row pitch, so the state can be attached in place.
+
+        Returns Wirehair_InvalidInput if there is no solved recovery set,
+        or if out_bytes is too small.
+    */
+    WirehairResult ExportEncoderState(
+        void * GF256_RESTRICT state_out, ///< State output, or null
+        uint64_t out_bytes, ///< Bytes available at state_out
+        uint64_t& bytes_out ///< Set to the state size
+    ) const;
+
+    /**
+        ImportEncoderState()
+
+        Initialize the encoder with a copy of the ExportEncoderState() data.
+
+        If message_in is provided, original blocks are read from it as with
+        EncodeFeed().  Otherwise they are generated from the recovery set.
+    */
+    WirehairResult ImportEncoderState(
+        const void * GF256_RESTRICT state, ///< Exported state
+        uint64_t state_bytes, ///< Bytes of state
+        const void * GF256_RESTRICT message_in ///< Original message or null
+    );
+
+    /**
+        AttachEncoderState()
+
+        Same as ImportEncoderState(), but Encode() reads the recovery set
+        from the state in place.  The state may be read-only memory, for
+        example a shared mapping, and must outlive the encoder.
+        UpdateInput() is not available in this mode.
+    */
+    WirehairResult AttachEncoderState(
+        const void * GF256_RESTRICT state, ///< Exported state
+        uint64_t state_bytes, ///< Bytes of state
+        const void * GF256_RESTRICT message_in ///< Original message or null
+    );
+
+    /**
+        UpdateInput()
+
+        This function replaces one block of the input message, updating the
+        recovery blocks in place instead of running EncodeFeed() again.
+
+        The change is propagated through the solution found by EncodeFeed():
+        a one-byte version of the value pass yields the GF(256) coefficient
+        of the block in each recovery block, and the delta between the old
+        and new block data is multiplied into each of them.
+
+        Precondition: The message passed to EncodeFeed() still holds the old
+        block data.  The application must copy the new data over it afterwards
+        so that the original blocks produced by Encode() match.  Blocks that
+        EncodeFeedSegments() gathered from several segments are a copy, which
+        is updated here.
+
+        Returns Wirehair_InvalidInput if the original data is not available,
+        for example after InitializeEncoderFromDecoder().
+    */
+    WirehairResult UpdateInput(
+        const unsigned block_id, ///< Block id to replace
+        const void * GF256_RESTRICT block_in, ///< New block data
+        const unsigned block_bytes ///< Bytes in block
     );
 
 
@@ -1303,13 +2008,92 @@ public:
         This function accumulates the new block in a large staging buffer.
         As soon as N blocks are collected, SolveMatrix() is run.
         After N blocks, ResumeSolveMatrix() is run.
+
+        A block id that was already used is dropped before any work is
+        done on it, returning Wirehair_NeedMore.
+
+        If expected_crc is provided, the block is checksummed as it is
+        copied in, and Wirehair_BadChecksum is returned without changing
+        the decoder state if it does not match.
     */
     WirehairResult DecodeFeed(
         const unsigned block_id,
         const void * GF256_RESTRICT block_in,
-        const unsigned block_bytes
+        const unsigned block_bytes,
+        const uint32_t * expected_crc = nullptr
     );
 
+    /**
+        SaveDecoderState()
+
+        Write a checkpoint of the blocks received so far: the block id and
+        data of each stored row.  If state_out is null, only bytes_out is
+        set to the size needed.
+
+        Returns Wirehair_InvalidInput if N rows have already arrived, since
+        the solver state is not saved, or if out_bytes is too small.
+    */
+    WirehairResult SaveDecoderState(
+        void * GF256_RESTRICT state_out, ///< Checkpoint output, or null
+        uint64_t out_bytes, ///< Bytes available at state_out
+        uint64_t& bytes_out ///< Set to the checkpoint size
+    ) const;
+
+    /**
+        LoadDecoderState()
+
+        Initialize the decoder from a SaveDecoderState() checkpoint.  The
+        peeling state is rebuilt from the row ids, and the block data is
+        copied in, so decoding continues as if the blocks were fed again.
+    */
+    WirehairResult LoadDecoderState(
+        const void * GF256_RESTRICT state, ///< Checkpoint data
+        uint64_t state_bytes ///< Bytes of checkpoint data
+    );
+
+    /// Enable or disable the stepped solver for DecodeFeed()
+    GF256_FORCE_INLINE void SetSteppedSolve(bool enabled) { _stepped_solve = enabled; }
+
+    /**
+        SetColumnCacheBytes()
+
+        Set the memory budget for the column cache, or 0 to disable it.
+        The cache is sized for the current solve right away, and covers the
+        rows that arrive from then on.
+    */
+    void SetColumnCacheBytes(uint32_t bytes);
+
+    /// Select how GreedyPeeling() chooses columns to defer
+    GF256_FORCE_INLINE void SetDeferStrategy(WirehairDeferStrategy strategy)
+    {
+        _defer_strategy = (uint8_t)strategy;
+    }
+
+
+    /**
+        SolveStep()
+
+        When the stepped solver is enabled, DecodeFeed() returns
+        Wirehair_InProgress instead of solving once enough rows arrive.
+        This function then runs the solver in slices until about
+        budget_usec microseconds have passed:
+
+            GreedyPeeling()        - A few deferred columns per slice
+            PeelDiagonal()         - A few dozen rows per slice
+            CompressAndTriangle()  - One slice
+            PeelDiagonalValues()   - A few dozen rows per slice
+            GE value stages        - One slice
+            Substitute()           - A few dozen rows per slice
+
+        Returns Wirehair_InProgress if more steps are needed.
+        Returns Wirehair_Success when the message can be recovered.
+        Returns Wirehair_NeedMore if the matrix needs more rows, which are
+        then fed through DecodeFeed() as usual.  Blocks that DecodeFeed()
+        queued during the solve are tried first.
+        Returns other codes on error.
+    */
+    WirehairResult SolveStep(unsigned budget_usec);
+
     /**
         GenerateRecoveryBlocks()
 
@@ -1320,6 +2104,10 @@ public:
 
         (4) Substitution:
 
+            Generates peeled row values:
+
+                PeelDiagonalValues()
+
             Solves across GE matrix rows:
 
                 InitializeColumnValues()
@@ -1333,6 +2121,9 @@ public:
             Solves remaining columns:
 
                 Substitute()
+
+        Blocks wider than GetSolveTileBytes() are solved one tile at a time
+        by GenerateRecoveryTiles().
     */
     void GenerateRecoveryBlocks();
 
@@ -1343,11 +2134,26 @@ public:
         that were from the first N blocks, and regenerating the rest.
         This is only done during decoding.
 
+        If block_crcs is provided, it is set to the CRC32C of each block.
+
         Precondition: DecodeFeed() has returned success
     */
     WirehairResult ReconstructOutput(
         void * GF256_RESTRICT message_out,
-        uint64_t message_bytes);
+        uint64_t message_bytes,
+        uint32_t * block_crcs = nullptr);
+
+    /**
+        ReconstructOutputSegments()
+
+        Same as ReconstructOutput() for a message buffer that is split
+        across segments.  Blocks inside one segment are written in place,
+        and blocks that straddle segments are written to a temporary slot
+        and then copied out.
+    */
+    WirehairResult ReconstructOutputSegments(
+        const WirehairOutputSegment * segments,
+        unsigned segment_count);
 
     /**
         ReconstructBlock()
@@ -0,0 +1,176 @@
+/** \file
+    \brief Wirehair : Decoder Block Intake
+    \copyright Copyright (c) 2012-2018 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Wirehair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "WirehairIntake.h"
+
+namespace wirehair {
+
+
+//------------------------------------------------------------------------------
+// BlockIntake
+
+BlockIntake::~BlockIntake()
+{
+    delete[] _slots;
+    SIMDSafeFree(_slot_data);
+}
+
+WirehairResult BlockIntake::Initialize(
+    Codec * decoder, ///< Decoder to feed
+    unsigned capacity ///< Number of blocks to stage
+)
+{
+    if (!decoder || capacity < 1 || capacity > 0x40000000) {
+        return Wirehair_InvalidInput;
+    }
+
+    // Round capacity up to a power of two
+    uint32_t slot_count = 2;
+    while (slot_count < capacity) {
+        slot_count <<= 1;
+    }
+
+    _decoder = decoder;
+    _block_bytes = decoder->BlockBytes();
+    _mask = slot_count - 1;
+
+    _slots = new (std::nothrow) Slot[slot_count];
+    _slot_data = SIMDSafeAllocate((size_t)_block_bytes * slot_count);
+    if (!_slots || !_slot_data) {
+        return Wirehair_OOM;
+    }
+
+    // Slot i is free for the producer that claims position i
+    for (uint32_t i = 0; i < slot_count; ++i) {
+        _slots[i].Sequence.store(i, std::memory_order_relaxed);
+    }
+
+    _result = Wirehair_NeedMore;
+    _dequeue_pos = 0;
+    _enqueue_pos.store(0, std::memory_order_release);
+
+    return Wirehair_Success;
+}
+
+WirehairResult BlockIntake::Push(
+    const unsigned block_id, ///< Block identifier
+    const void * GF256_RESTRICT block_in, ///< Block data
+    const unsigned block_bytes ///< Bytes in block
+)
+{
+    if (!block_in || block_bytes < 1 || block_bytes > _block_bytes) {
+        return Wirehair_InvalidInput;
+    }
+
+    Slot * slot;
+    uint32_t pos = _enqueue_pos.load(std::memory_order_relaxed);
+
+    for (;;)
+    {
+        slot = &_slots[pos & _mask];
+        const uint32_t seq = slot->Sequence.load(std::memory_order_acquire);
+        const int32_t diff = (int32_t)(seq - pos);
+
+        // If the slot is free for this position:
+        if (diff == 0)
+        {
+            // Claim it
+            if (_enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+            // pos was reloaded by the failed exchange
+        }
+        else if (diff < 0)
+        {
+            // The consumer has not released this slot yet: Ring is full
+            return Wirehair_WouldBlock;
+        }
+        else
+        {
+            // Another producer claimed this position first
+            pos = _enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    memcpy(_slot_data + (size_t)_block_bytes * (pos & _mask), block_in, block_bytes);
+    slot->BlockId = block_id;
+    slot->Bytes = block_bytes;
+
+    // Publish to the consumer
+    slot->Sequence.store(pos + 1, std::memory_order_release);
+
+    return Wirehair_Success;
+}
+
+WirehairResult BlockIntake::Drain(unsigned max_blocks)
+{
+    bool in_progress = false;
+
+    for (unsigned count = 0; max_blocks == 0 || count < max_blocks; ++count)
+    {
+        const uint32_t pos = _dequeue_pos;
+        Slot * slot = &_slots[pos & _mask];
+
+        // If the next slot has not been published yet:
+        if (slot->Sequence.load(std::memory_order_acquire) != pos + 1) {
+            break;
+        }
+
+        // If the decoder still needs data:
+        if (_result == Wirehair_NeedMore)
+        {
+            const WirehairResult result = _decoder->DecodeFeed(
+                slot->BlockId,
+                _slot_data + (size_t)_block_bytes * (pos & _mask),
+                slot->Bytes);
+
+            // If a stepped solve is pending, the block is not needed
+            if (result == Wirehair_InProgress) {
+                in_progress = true;
+            }
+            // Drop malformed blocks rather than failing the whole decode
+            else if (result != Wirehair_InvalidInput) {
+                _result = result;
+            }
+        }
+
+        // Release the slot for the producer that wraps around to it
+        slot->Sequence.store(pos + _mask + 1, std::memory_order_release);
+        _dequeue_pos = pos + 1;
+    }
+
+    if (in_progress && _result == Wirehair_NeedMore) {
+        return Wirehair_InProgress;
+    }
+
+    return _result;
+}
+
+
+} // namespace wirehair
@@ -0,0 +1,165 @@
+/** \file
+    \brief Wirehair : Decoder Block Intake
+    \copyright Copyright (c) 2012-2018 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Wirehair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef WIREHAIR_INTAKE_H
+#define WIREHAIR_INTAKE_H
+
+/** \page Decoder Block Intake
+
+    DecodeFeed() must be called by one thread at a time.  When blocks arrive
+    on several receive threads, the intake lets those threads hand off blocks
+    without taking a lock:
+
+        Receive threads                     Solver thread
+        ---------------                     -------------
+        Push(id, data) --+
+        Push(id, data) --+--> [ ring ] --> Drain() --> DecodeFeed()
+        Push(id, data) --+
+
+    The ring is a bounded multi-producer queue in the style of Dmitry Vyukov's
+    MPMC queue: Each slot has a sequence number that tells producers when the
+    slot is free and tells the consumer when its data is ready.  Producers
+    claim a slot with one compare-and-swap on the enqueue position, copy the
+    block into the slot, then publish it by bumping the slot sequence number.
+    Only one thread drains, so the dequeue position is a plain integer.
+
+    Drain() feeds the staged blocks to the decoder in arrival order, so the
+    peeling work happens in batches on the solver thread and the matrix solve
+    is started as soon as N rows have been staged.
+*/
+
+#include "WirehairCodec.h"
+
+#include <atomic>
+
+namespace wirehair {
+
+
+//------------------------------------------------------------------------------
+// BlockIntake
+
+class BlockIntake
+{
+public:
+    ~BlockIntake();
+
+    /**
+        Initialize()
+
+        Allocate the ring for the given decoder.  The capacity is rounded up
+        to the next power of two.
+
+        Returns Wirehair_Success on success.
+        Returns other codes on error.
+    */
+    WirehairResult Initialize(
+        Codec * decoder, ///< Decoder to feed
+        unsigned capacity ///< Number of blocks to stage
+    );
+
+    /**
+        Push()
+
+        Stage a received block.  May be called from any number of threads.
+
+        Returns Wirehair_Success if the block was staged.
+        Returns Wirehair_WouldBlock if the ring is full.
+        Returns Wirehair_InvalidInput if the block is malformed.
+    */
+    WirehairResult Push(
+        const unsigned block_id, ///< Block identifier
+        const void * GF256_RESTRICT block_in, ///< Block data
+        const unsigned block_bytes ///< Bytes in block
+    );
+
+    /**
+        Drain()
+
+        Feed up to max_blocks staged blocks to the decoder, or all staged
+        blocks if max_blocks is 0.  Must only be called by one thread.
+
+        Blocks that DecodeFeed() rejects as invalid are dropped.  Once the
+        decoder succeeds or fails, any further blocks are discarded.
+
+        Returns Wirehair_InProgress if the decoder is waiting on SolveStep().
+        Returns Wirehair_NeedMore if more blocks are needed.
+        Returns Wirehair_Success once the message can be recovered.
+        Returns other codes on error.
+    */
+    WirehairResult Drain(unsigned max_blocks);
+
+protected:
+    /// Bytes between fields written by different threads
+    static const unsigned kCacheLineBytes = 64;
+
+    struct Slot
+    {
+        /// Sequence number for this slot
+        std::atomic<uint32_t> Sequence;
+
+        /// Block identifier
+        uint32_t BlockId;
+
+        /// Bytes in block
+        uint32_t Bytes;
+    };
+
+    /// Decoder being fed
+    Codec * _decoder = nullptr;
+
+    /// Ring slots
+    Slot * _slots = nullptr;
+
+    /// Block data for each slot
+    uint8_t * GF256_RESTRICT _slot_data = nullptr;
+
+    /// Bytes per block
+    unsigned _block_bytes = 0;
+
+    /// Capacity - 1
+    uint32_t _mask = 0;
+
+    /// Result of the last DecodeFeed() that was not NeedMore
+    WirehairResult _result = Wirehair_NeedMore;
+
+    uint8_t _padding0[kCacheLineBytes];
+
+    /// Next position for producers to claim
+    std::atomic<uint32_t> _enqueue_pos;
+
+    uint8_t _padding1[kCacheLineBytes];
+
+    /// Next position for the consumer
+    uint32_t _dequeue_pos = 0;
+};
+
+
+} // namespace wirehair
+
+#endif // WIREHAIR_INTAKE_H
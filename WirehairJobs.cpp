@@ -0,0 +1,355 @@
+/** \file
+    \brief Wirehair : Asynchronous Jobs
+    \copyright Copyright (c) 2012-2018 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Wirehair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#include "WirehairJobs.h"
+
+namespace wirehair {
+
+
+/// Index of the pool worker running on this thread, or -1
+static thread_local int t_worker_index = -1;
+
+
+//------------------------------------------------------------------------------
+// Job
+
+Job::Job(
+    Work work, ///< Work to run on a worker thread
+    Codec * codec, ///< Codec the work operates on, or nullptr
+    WirehairCallback callback, ///< Optional completion callback
+    void * context, ///< Application context for the callback
+    bool auto_free ///< Free the job after completion
+)
+    : _work(std::move(work))
+    , _codec(codec)
+    , _queue_codec(codec)
+    , _callback(callback)
+    , _context(context)
+    , _references(auto_free ? 1 : 2)
+{
+}
+
+WirehairResult Job::Poll()
+{
+    std::lock_guard<std::mutex> locker(_lock);
+    return _complete ? _result : Wirehair_InProgress;
+}
+
+WirehairResult Job::Wait()
+{
+    std::unique_lock<std::mutex> locker(_lock);
+    while (!_complete) {
+        _done.wait(locker);
+    }
+    return _result;
+}
+
+Codec * Job::GetCodec()
+{
+    std::lock_guard<std::mutex> locker(_lock);
+    return _complete ? _codec : nullptr;
+}
+
+void Job::Release()
+{
+    if (_references.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete this;
+    }
+}
+
+void Job::Run()
+{
+    Codec * codec = _codec;
+    const WirehairResult result = _work(codec);
+
+    // Note the callback runs before waiters are released, so that the
+    // application can rely on it having finished once Wait() returns
+    if (_callback) {
+        _callback(_context, result, reinterpret_cast<WirehairCodec>(codec));
+    }
+
+    {
+        std::lock_guard<std::mutex> locker(_lock);
+        _codec = codec;
+        _result = result;
+        _complete = true;
+        _done.notify_all();
+    }
+
+    // Release() may delete the job, so keep the codec to hand on
+    const Codec * queue_codec = _queue_codec;
+
+    Release();
+
+    // The callback has returned, so the next job for the codec may run
+    if (queue_codec) {
+        JobPool::GetInstance()->FinishCodecJob(queue_codec);
+    }
+}
+
+
+//------------------------------------------------------------------------------
+// JobPool
+
+JobPool * JobPool::GetInstance()
+{
+    // Function-local statics are initialized once, even with many callers
+    static JobPool pool;
+    static const bool started = pool.Start();
+
+    return started ? &pool : nullptr;
+}
+
+JobPool::JobPool()
+{
+    _next_worker.store(0, std::memory_order_relaxed);
+    _queued.store(0, std::memory_order_relaxed);
+    _terminated.store(false, std::memory_order_relaxed);
+}
+
+JobPool::~JobPool()
+{
+    {
+        std::lock_guard<std::mutex> locker(_idle_lock);
+        _terminated = true;
+        _idle_wake.notify_all();
+    }
+
+    for (auto& thread : _threads) {
+        thread.join();
+    }
+
+    // Jobs still queued at process exit are dropped
+    for (Worker * worker : _workers) {
+        delete worker;
+    }
+}
+
+bool JobPool::Start()
+{
+    unsigned worker_count = std::thread::hardware_concurrency();
+
+    // Keep at least two workers so one slow job does not stall the rest
+    if (worker_count < 2) {
+        worker_count = 2;
+    }
+
+    try {
+        for (unsigned i = 0; i < worker_count; ++i) {
+            _workers.push_back(new Worker);
+        }
+
+        for (unsigned i = 0; i < worker_count; ++i) {
+            _threads.push_back(std::thread(&JobPool::Loop, this, i));
+        }
+    }
+    catch (...) {
+        // Queues without a thread of their own are drained by stealing
+        return !_threads.empty();
+    }
+
+    return true;
+}
+
+bool JobPool::Submit(Job * job)
+{
+    if (_terminated.load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    const Codec * codec = job->GetQueueCodec();
+
+    // If the job operates on an existing codec:
+    if (codec)
+    {
+        std::lock_guard<std::mutex> locker(_codec_lock);
+
+        try {
+            auto it = _codec_queues.find(codec);
+
+            // If another job for this codec is queued or running, wait for it
+            if (it != _codec_queues.end())
+            {
+                it->second.push_back(job);
+                return true;
+            }
+
+            _codec_queues.emplace(codec, std::deque<Job *>());
+        }
+        catch (...) {
+            return false;
+        }
+    }
+
+    if (!Enqueue(job))
+    {
+        // Pass the codec on to any job that queued behind this one
+        if (codec) {
+            FinishCodecJob(codec);
+        }
+        return false;
+    }
+
+    return true;
+}
+
+void JobPool::FinishCodecJob(const Codec * codec)
+{
+    Job * next = nullptr;
+
+    {
+        std::lock_guard<std::mutex> locker(_codec_lock);
+
+        auto it = _codec_queues.find(codec);
+        if (it == _codec_queues.end()) {
+            return;
+        }
+
+        // If no other jobs are waiting for this codec:
+        if (it->second.empty())
+        {
+            _codec_queues.erase(it);
+            return;
+        }
+
+        next = it->second.front();
+        it->second.pop_front();
+    }
+
+    // Note this runs on the worker that just finished with the codec, so
+    // the next job goes to the front of its queue while the codec is in cache
+    if (!Enqueue(next)) {
+        next->Run();
+    }
+}
+
+bool JobPool::Enqueue(Job * job)
+{
+    try {
+        // If submitted from a job callback, or handed on by a finished job:
+        if (t_worker_index >= 0)
+        {
+            // Run it next on this worker while its data is in cache
+            Worker * worker = _workers[t_worker_index];
+            std::lock_guard<std::mutex> locker(worker->Lock);
+            worker->Jobs.push_front(job);
+        }
+        else
+        {
+            const unsigned index = _next_worker.fetch_add(1, std::memory_order_relaxed);
+            Worker * worker = _workers[index % _workers.size()];
+            std::lock_guard<std::mutex> locker(worker->Lock);
+            worker->Jobs.push_back(job);
+        }
+    }
+    catch (...) {
+        return false;
+    }
+
+    _queued.fetch_add(1, std::memory_order_seq_cst);
+
+    // Taking the lock orders this with a worker that is about to sleep
+    {
+        std::lock_guard<std::mutex> locker(_idle_lock);
+        _idle_wake.notify_one();
+    }
+
+    return true;
+}
+
+Job * JobPool::TakeJob(unsigned worker_index)
+{
+    const unsigned worker_count = (unsigned)_workers.size();
+    Job * job = nullptr;
+
+    // Take the oldest job from our own queue
+    {
+        Worker * worker = _workers[worker_index];
+        std::lock_guard<std::mutex> locker(worker->Lock);
+        if (!worker->Jobs.empty())
+        {
+            job = worker->Jobs.front();
+            worker->Jobs.pop_front();
+        }
+    }
+
+    // Steal the newest job from another queue
+    for (unsigned i = 1; !job && i < worker_count; ++i)
+    {
+        Worker * victim = _workers[(worker_index + i) % worker_count];
+        std::lock_guard<std::mutex> locker(victim->Lock);
+        if (!victim->Jobs.empty())
+        {
+            job = victim->Jobs.back();
+            victim->Jobs.pop_back();
+        }
+    }
+
+    if (job) {
+        _queued.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    return job;
+}
+
+void JobPool::Loop(unsigned worker_index)
+{
+    t_worker_index = (int)worker_index;
+
+    for (;;)
+    {
+        Job * job = TakeJob(worker_index);
+
+        if (job)
+        {
+            job->Run();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> locker(_idle_lock);
+
+        if (_terminated.load(std::memory_order_relaxed)) {
+            break;
+        }
+
+        // If a job was queued but another worker is about to take it:
+        if (_queued.load(std::memory_order_seq_cst) > 0)
+        {
+            locker.unlock();
+            std::this_thread::yield();
+            continue;
+        }
+
+        _idle_wake.wait(locker);
+    }
+}
+
+
+} // namespace wirehair
@@ -0,0 +1,226 @@
+/** \file
+    \brief Wirehair : Asynchronous Jobs
+    \copyright Copyright (c) 2012-2018 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Wirehair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+
+#ifndef WIREHAIR_JOBS_H
+#define WIREHAIR_JOBS_H
+
+/** \page Asynchronous Jobs
+
+    The *_async() API functions wrap the synchronous ones in a Job and hand
+    it to a library-owned JobPool, which runs it on a worker thread and then
+    completes it through a callback, a pollable handle, or both.
+
+    The pool is work-stealing: Each worker has its own deque of jobs.  A
+    worker takes the oldest job from the front of its own deque, and when
+    that is empty it steals the newest job from the back of another
+    worker's deque.  Jobs that are submitted from outside the pool are
+    spread round-robin over the workers.  Jobs submitted from inside a job
+    callback go to the front of the current worker's deque, so a decode
+    callback that starts the recovery keeps the data in the same cache.
+
+    A Codec is not thread-safe, so jobs that operate on the same codec run
+    one at a time.  The first job for a codec goes to the workers, and
+    later jobs for it wait in a per-codec queue until the one before them
+    is done and its callback has returned, so they do not hold a worker
+    while waiting.  Jobs for
+    different codecs run in parallel.
+
+    The pool is started on first use with one worker per hardware thread,
+    and is stopped when the process exits.
+*/
+
+#include "WirehairCodec.h"
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <deque>
+#include <vector>
+#include <unordered_map>
+
+namespace wirehair {
+
+
+//------------------------------------------------------------------------------
+// Job
+
+class Job
+{
+public:
+    /// Work to run: Receives the codec to operate on, and may replace it
+    typedef std::function<WirehairResult(Codec*&)> Work;
+
+    /**
+        Job()
+
+        If auto_free is true, the job frees itself after the callback runs,
+        and the application never sees the handle.  Otherwise both the pool
+        and the application hold a reference, and the application must
+        call Release().
+    */
+    Job(
+        Work work, ///< Work to run on a worker thread
+        Codec * codec, ///< Codec the work operates on, or nullptr
+        WirehairCallback callback, ///< Optional completion callback
+        void * context, ///< Application context for the callback
+        bool auto_free ///< Free the job after completion
+    );
+
+    /// Returns Wirehair_InProgress until the job completes
+    WirehairResult Poll();
+
+    /// Block until the job completes and return its result
+    WirehairResult Wait();
+
+    /// Codec the work operated on, once the job completes
+    Codec * GetCodec();
+
+    /// Drop one reference, deleting the job when none are left
+    void Release();
+
+    /// Run the job.  Called by the pool on a worker thread
+    void Run();
+
+    /// Codec this job must not run at the same time as others for
+    GF256_FORCE_INLINE const Codec * GetQueueCodec() const
+    {
+        return _queue_codec;
+    }
+
+protected:
+    /// Work to run
+    Work _work;
+
+    /// Codec the work operates on
+    Codec * _codec = nullptr;
+
+    /// Codec the job was submitted for, which the work may replace
+    const Codec * _queue_codec = nullptr;
+
+    /// Completion callback
+    WirehairCallback _callback = nullptr;
+
+    /// Application context for the callback
+    void * _context = nullptr;
+
+    /// Number of owners: The pool and optionally the application
+    std::atomic<int> _references;
+
+    /// Held while reading or writing the result
+    std::mutex _lock;
+    std::condition_variable _done;
+
+    /// Boolean: Work has completed
+    bool _complete = false;
+
+    /// Result of the work
+    WirehairResult _result = Wirehair_InProgress;
+};
+
+
+//------------------------------------------------------------------------------
+// JobPool
+
+class JobPool
+{
+public:
+    /// Returns the shared pool, starting it on first use.  nullptr on error
+    static JobPool * GetInstance();
+
+    ~JobPool();
+
+    /// Queue a job to run.  Returns false if the pool is stopping
+    bool Submit(Job * job);
+
+    /// Called when a job is done with its codec, to start the next job for it
+    void FinishCodecJob(const Codec * codec);
+
+protected:
+    /// Bytes between fields written by different threads
+    static const unsigned kCacheLineBytes = 64;
+
+    struct Worker
+    {
+        /// Held while touching Jobs
+        std::mutex Lock;
+
+        /// Owner takes from the front, thieves steal from the back
+        std::deque<Job *> Jobs;
+
+        uint8_t Padding[kCacheLineBytes];
+    };
+
+    /// Per-worker queues
+    std::vector<Worker *> _workers;
+
+    /// Worker threads
+    std::vector<std::thread> _threads;
+
+    /// Jobs waiting for a codec, in the order they were submitted.  A codec
+    /// has an entry while one of its jobs is queued on a worker or running
+    std::unordered_map<const Codec *, std::deque<Job *>> _codec_queues;
+
+    /// Held while touching _codec_queues
+    std::mutex _codec_lock;
+
+    /// Next worker for jobs submitted from outside the pool
+    std::atomic<unsigned> _next_worker;
+
+    /// Number of jobs queued but not yet taken by a worker
+    std::atomic<int> _queued;
+
+    /// Idle workers sleep on this
+    std::mutex _idle_lock;
+    std::condition_variable _idle_wake;
+
+    /// Set to stop the workers
+    std::atomic<bool> _terminated;
+
+    JobPool();
+
+    /// Start the worker threads.  Returns false on error
+    bool Start();
+
+    /// Put a job that is ready to run on a worker queue.  Returns false on error
+    bool Enqueue(Job * job);
+
+    /// Take a job from the given worker's queue or steal one
+    Job * TakeJob(unsigned worker_index);
+
+    /// Worker thread loop
+    void Loop(unsigned worker_index);
+};
+
+
+} // namespace wirehair
+
+#endif // WIREHAIR_JOBS_H
@@ -0,0 +1,213 @@
+/** \file
+    \brief Wirehair : Repair-Ahead Encoder
+    \copyright Copyright (c) 2012-2018 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Wirehair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "WirehairRepairAhead.h"
+
+#include <chrono>
+
+namespace wirehair {
+
+
+//------------------------------------------------------------------------------
+// RepairAhead
+
+RepairAhead::~RepairAhead()
+{
+    Stop();
+
+    delete[] _slots;
+    SIMDSafeFree(_slot_data);
+}
+
+WirehairResult RepairAhead::Start(
+    const Codec * encoder, ///< Encoder to read from
+    unsigned first_block_id, ///< First repair block id
+    unsigned capacity ///< Number of blocks to generate ahead
+)
+{
+    if (!encoder || capacity < 1 || capacity > 0x40000000) {
+        return Wirehair_InvalidInput;
+    }
+
+    // Round capacity up to a power of two
+    uint32_t slot_count = 2;
+    while (slot_count < capacity) {
+        slot_count <<= 1;
+    }
+
+    _encoder = encoder;
+    _block_bytes = encoder->BlockBytes();
+    _mask = slot_count - 1;
+    _next_block_id = first_block_id;
+
+    _slots = new (std::nothrow) Slot[slot_count];
+    _slot_data = SIMDSafeAllocate((size_t)_block_bytes * slot_count);
+    if (!_slots || !_slot_data) {
+        return Wirehair_OOM;
+    }
+
+    // Slot i is free for the producer at position i
+    for (uint32_t i = 0; i < slot_count; ++i) {
+        _slots[i].Sequence.store(i, std::memory_order_relaxed);
+    }
+
+    _enqueue_pos = 0;
+    _dequeue_pos.store(0, std::memory_order_relaxed);
+    _terminated.store(false, std::memory_order_relaxed);
+    _producer_waiting.store(false, std::memory_order_relaxed);
+
+    try {
+        _thread = std::thread(&RepairAhead::Loop, this);
+    }
+    catch (...) {
+        return Wirehair_Error;
+    }
+
+    return Wirehair_Success;
+}
+
+void RepairAhead::Loop()
+{
+    while (!_terminated.load(std::memory_order_relaxed))
+    {
+        const uint32_t pos = _enqueue_pos;
+        Slot * slot = &_slots[pos & _mask];
+
+        // If consumers have not released this slot yet:
+        if (slot->Sequence.load(std::memory_order_acquire) != pos)
+        {
+            std::unique_lock<std::mutex> locker(_lock);
+            _producer_waiting.store(true, std::memory_order_seq_cst);
+
+            // Check again now that consumers will notify us
+            if (slot->Sequence.load(std::memory_order_seq_cst) != pos &&
+                !_terminated.load(std::memory_order_relaxed))
+            {
+                // Timeout covers any wakeup raced with the flag
+                _wake.wait_for(locker, std::chrono::milliseconds(10));
+            }
+
+            _producer_waiting.store(false, std::memory_order_relaxed);
+            continue;
+        }
+
+        const unsigned block_id = _next_block_id++;
+
+        slot->BlockId = block_id;
+        slot->Bytes = _encoder->Encode(
+            block_id,
+            _slot_data + (size_t)_block_bytes * (pos & _mask),
+            _block_bytes);
+
+        // Publish to consumers
+        slot->Sequence.store(pos + 1, std::memory_order_release);
+        _enqueue_pos = pos + 1;
+    }
+}
+
+WirehairResult RepairAhead::Dequeue(
+    void * GF256_RESTRICT block_out, ///< Output block buffer
+    uint32_t out_buffer_bytes, ///< Bytes in output buffer
+    unsigned * block_id_out, ///< Block id written
+    uint32_t * bytes_out ///< Bytes written
+)
+{
+    if (!block_out || out_buffer_bytes < _block_bytes) {
+        return Wirehair_InvalidInput;
+    }
+
+    Slot * slot;
+    uint32_t pos = _dequeue_pos.load(std::memory_order_relaxed);
+
+    for (;;)
+    {
+        slot = &_slots[pos & _mask];
+        const uint32_t seq = slot->Sequence.load(std::memory_order_acquire);
+        const int32_t diff = (int32_t)(seq - (pos + 1));
+
+        // If the slot holds a block for this position:
+        if (diff == 0)
+        {
+            // Claim it
+            if (_dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+            // pos was reloaded by the failed exchange
+        }
+        else if (diff < 0)
+        {
+            // Producer has not caught up: Ring is empty
+            return Wirehair_WouldBlock;
+        }
+        else
+        {
+            // Another consumer claimed this position first
+            pos = _dequeue_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    const uint32_t bytes = slot->Bytes;
+    memcpy(block_out, _slot_data + (size_t)_block_bytes * (pos & _mask), bytes);
+    if (block_id_out) {
+        *block_id_out = slot->BlockId;
+    }
+    if (bytes_out) {
+        *bytes_out = bytes;
+    }
+
+    // Release the slot for the producer when it wraps around to it
+    slot->Sequence.store(pos + _mask + 1, std::memory_order_seq_cst);
+
+    // If the producer may be sleeping:
+    if (_producer_waiting.load(std::memory_order_seq_cst))
+    {
+        std::lock_guard<std::mutex> locker(_lock);
+        _wake.notify_one();
+    }
+
+    return Wirehair_Success;
+}
+
+void RepairAhead::Stop()
+{
+    if (!_thread.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> locker(_lock);
+        _terminated = true;
+        _wake.notify_one();
+    }
+
+    _thread.join();
+}
+
+
+} // namespace wirehair
@@ -0,0 +1,174 @@
+/** \file
+    \brief Wirehair : Repair-Ahead Encoder
+    \copyright Copyright (c) 2012-2018 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Wirehair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef WIREHAIR_REPAIR_AHEAD_H
+#define WIREHAIR_REPAIR_AHEAD_H
+
+/** \page Repair-Ahead Encoder
+
+    Generating a repair block takes time proportional to the block size, and
+    doing it inside a paced send loop adds jitter.  The repair-ahead encoder
+    runs Codec::Encode() on a background thread to keep a bounded ring of
+    ready repair blocks, so that send threads only copy out a finished block.
+
+        Producer thread                     Send threads
+        ---------------                     ------------
+        Encode(id++) --> [ ring ] --+--> Dequeue()
+                                    +--> Dequeue()
+
+    The ring uses the same per-slot sequence numbers as BlockIntake, with the
+    roles reversed: one producer and any number of consumers.  Consumers
+    claim a slot with one compare-and-swap on the dequeue position.
+
+    The producer only sleeps when the ring is full, and consumers only wake
+    it if it has said that it is sleeping, so the send path does not touch
+    the mutex in the common case.
+*/
+
+#include "WirehairCodec.h"
+
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace wirehair {
+
+
+//------------------------------------------------------------------------------
+// RepairAhead
+
+class RepairAhead
+{
+public:
+    ~RepairAhead();
+
+    /**
+        Start()
+
+        Allocate the ring and start generating repair blocks from the given
+        block id onwards.  The capacity is rounded up to a power of two.
+
+        Precondition: The encoder has generated its recovery blocks, and
+        outlives this object.
+
+        Returns Wirehair_Success on success.
+        Returns other codes on error.
+    */
+    WirehairResult Start(
+        const Codec * encoder, ///< Encoder to read from
+        unsigned first_block_id, ///< First repair block id
+        unsigned capacity ///< Number of blocks to generate ahead
+    );
+
+    /**
+        Dequeue()
+
+        Copy out the next ready block.  May be called from any number of
+        threads.
+
+        Returns Wirehair_Success if a block was written.
+        Returns Wirehair_WouldBlock if no block is ready yet.
+        Returns Wirehair_InvalidInput if the output buffer is too small.
+    */
+    WirehairResult Dequeue(
+        void * GF256_RESTRICT block_out, ///< Output block buffer
+        uint32_t out_buffer_bytes, ///< Bytes in output buffer
+        unsigned * block_id_out, ///< Block id written
+        uint32_t * bytes_out ///< Bytes written
+    );
+
+    /// Stop the producer thread.  No threads may be in Dequeue()
+    void Stop();
+
+protected:
+    /// Bytes between fields written by different threads
+    static const unsigned kCacheLineBytes = 64;
+
+    struct Slot
+    {
+        /// Sequence number for this slot
+        std::atomic<uint32_t> Sequence;
+
+        /// Block identifier
+        uint32_t BlockId;
+
+        /// Bytes in block
+        uint32_t Bytes;
+    };
+
+    /// Encoder being read
+    const Codec * _encoder = nullptr;
+
+    /// Ring slots
+    Slot * _slots = nullptr;
+
+    /// Block data for each slot
+    uint8_t * GF256_RESTRICT _slot_data = nullptr;
+
+    /// Bytes per block
+    unsigned _block_bytes = 0;
+
+    /// Capacity - 1
+    uint32_t _mask = 0;
+
+    /// Next block id to generate
+    unsigned _next_block_id = 0;
+
+    /// Producer thread
+    std::thread _thread;
+
+    /// Producer sleeps on this when the ring is full
+    std::mutex _lock;
+    std::condition_variable _wake;
+
+    /// Set to stop the producer
+    std::atomic<bool> _terminated;
+
+    /// Set while the producer may be waiting
+    std::atomic<bool> _producer_waiting;
+
+    uint8_t _padding0[kCacheLineBytes];
+
+    /// Next position for the producer (only touched by producer thread)
+    uint32_t _enqueue_pos = 0;
+
+    uint8_t _padding1[kCacheLineBytes];
+
+    /// Next position for consumers to claim
+    std::atomic<uint32_t> _dequeue_pos;
+
+    /// Producer thread loop
+    void Loop();
+};
+
+
+} // namespace wirehair
+
+#endif // WIREHAIR_REPAIR_AHEAD_H
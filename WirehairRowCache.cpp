@@ -0,0 +1,205 @@
+/** \file
+    \brief Wirehair : Repair Row Cache
+    \copyright Copyright (c) 2012-2018 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Wirehair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "WirehairRowCache.h"
+
+namespace wirehair {
+
+
+//------------------------------------------------------------------------------
+// RepairRowTable
+
+bool RepairRowTable::Initialize(
+    const RepairRowKey& key, ///< Matrix parameters
+    uint32_t repair_count ///< Number of repair ids to cover
+)
+{
+    _key = key;
+    _row_count = 0;
+
+    try
+    {
+        _offsets.clear();
+        _columns.clear();
+        _offsets.reserve(repair_count + 1);
+
+        // Rows average a little under 9 columns
+        _columns.reserve((size_t)repair_count * 9);
+
+        _offsets.push_back(0);
+
+        PeelRowParameters batch[kPeelRowBatch];
+
+        for (uint32_t i = 0; i < repair_count; ++i)
+        {
+            const unsigned batch_i = i % kPeelRowBatch;
+
+            // Generate row parameters a batch at a time
+            if (batch_i == 0)
+            {
+                const uint32_t remaining = repair_count - i;
+                const unsigned count = (remaining < kPeelRowBatch) ? remaining : kPeelRowBatch;
+
+                uint32_t seeds[kPeelRowBatch];
+                for (unsigned j = 0; j < count; ++j) {
+                    seeds[j] = key.BlockCount + i + j;
+                }
+
+                InitializePeelRowBatch(batch, seeds, count, key.PeelSeed, key.BlockCount, key.MixCount);
+            }
+
+            const PeelRowParameters& params = batch[batch_i];
+
+            PeelRowIterator iter(params, key.BlockCount, key.BlockNextPrime);
+            do {
+                _columns.push_back(iter.GetColumn());
+            } while (iter.Iterate());
+
+            const RowMixIterator mix(params, key.MixCount, key.MixNextPrime);
+            for (unsigned j = 0; j < RowMixIterator::kColumnCount; ++j) {
+                _columns.push_back((uint16_t)(key.BlockCount + mix.Columns[j]));
+            }
+
+            _offsets.push_back((uint32_t)_columns.size());
+        }
+    }
+    catch (...) {
+        return false;
+    }
+
+    _row_count = repair_count;
+    return true;
+}
+
+
+//------------------------------------------------------------------------------
+// RepairRowCache
+
+RepairRowCache * RepairRowCache::GetInstance()
+{
+    // Function-local statics are initialized once, even with many callers
+    static RepairRowCache cache;
+    return &cache;
+}
+
+void RepairRowCache::Configure(
+    uint32_t repair_count, ///< Repair ids per table
+    unsigned table_count ///< Maximum tables to keep
+)
+{
+    std::lock_guard<std::mutex> locker(_lock);
+
+    if (repair_count == 0 || table_count == 0)
+    {
+        repair_count = 0;
+        table_count = 0;
+    }
+
+    // Tables of a different size are rebuilt on next use
+    if (repair_count != _repair_count) {
+        _tables.clear();
+    }
+
+    _repair_count = repair_count;
+    _table_count = table_count;
+
+    while (_tables.size() > _table_count) {
+        _tables.pop_back();
+    }
+}
+
+std::shared_ptr<const RepairRowTable> RepairRowCache::Acquire(const RepairRowKey& key)
+{
+    uint32_t repair_count;
+
+    {
+        std::lock_guard<std::mutex> locker(_lock);
+
+        repair_count = _repair_count;
+        if (repair_count == 0) {
+            return nullptr;
+        }
+
+        for (auto it = _tables.begin(); it != _tables.end(); ++it)
+        {
+            // If found:
+            if ((*it)->GetKey() == key)
+            {
+                // Move to front
+                if (it != _tables.begin()) {
+                    _tables.splice(_tables.begin(), _tables, it);
+                }
+                return _tables.front();
+            }
+        }
+    }
+
+    // Build outside the lock so other shapes are not held up.  Two threads
+    // may build the same table at once, in which case one copy is dropped
+    std::shared_ptr<RepairRowTable> table;
+    try {
+        table = std::make_shared<RepairRowTable>();
+    }
+    catch (...) {
+        return nullptr;
+    }
+    if (!table->Initialize(key, repair_count)) {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> locker(_lock);
+
+    // If the configuration changed meanwhile, do not cache it
+    if (_repair_count != repair_count) {
+        return table;
+    }
+
+    for (auto& cached : _tables)
+    {
+        if (cached->GetKey() == key) {
+            return cached;
+        }
+    }
+
+    try {
+        _tables.push_front(table);
+    }
+    catch (...) {
+        return table;
+    }
+
+    while (_tables.size() > _table_count) {
+        _tables.pop_back();
+    }
+
+    return table;
+}
+
+
+} // namespace wirehair
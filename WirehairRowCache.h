@@ -0,0 +1,185 @@
+/** \file
+    \brief Wirehair : Repair Row Cache
+    \copyright Copyright (c) 2012-2018 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Wirehair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef WIREHAIR_ROW_CACHE_H
+#define WIREHAIR_ROW_CACHE_H
+
+/** \page Repair Row Cache
+
+    Codec::Encode() spends part of each call generating the row for the
+    block id: PeelRowParameters::Initialize() runs the PRNG, and then the
+    peel and mix column generators step through the prime-stride sequence.
+    A carousel sender encodes the same repair ids again for every message,
+    and for equal N the rows are the same every time.
+
+    A RepairRowTable holds the finished list of recovery block indices for
+    a run of repair ids starting at N.  It is immutable once built, so any
+    number of codecs and threads may read it at once.  For ids inside the
+    table, Encode() is a pure gather and XOR.
+
+    The process-wide RepairRowCache keeps the most recently used tables,
+    one per matrix shape.  Codecs hold a shared reference to their table,
+    so evicting a table from the cache does not pull it out from under an
+    encoder that is still using it.
+*/
+
+#include "WirehairTools.h"
+
+#include <memory>
+#include <mutex>
+#include <list>
+#include <vector>
+
+namespace wirehair {
+
+
+//------------------------------------------------------------------------------
+// RepairRowTable
+
+/// Matrix parameters that decide which columns each row uses
+struct RepairRowKey
+{
+    uint16_t BlockCount = 0;
+    uint16_t BlockNextPrime = 0;
+    uint16_t MixCount = 0;
+    uint16_t MixNextPrime = 0;
+    uint32_t PeelSeed = 0;
+
+    bool operator==(const RepairRowKey& other) const
+    {
+        return BlockCount == other.BlockCount &&
+            BlockNextPrime == other.BlockNextPrime &&
+            MixCount == other.MixCount &&
+            MixNextPrime == other.MixNextPrime &&
+            PeelSeed == other.PeelSeed;
+    }
+};
+
+class RepairRowTable
+{
+public:
+    /**
+        Initialize()
+
+        Generate the rows for block ids N .. N + repair_count - 1.
+        Each row lists the recovery block index of every peel column,
+        then every mix column.
+
+        Returns false on allocation failure.
+    */
+    bool Initialize(
+        const RepairRowKey& key, ///< Matrix parameters
+        uint32_t repair_count ///< Number of repair ids to cover
+    );
+
+    /// Matrix parameters the rows were generated for
+    GF256_FORCE_INLINE const RepairRowKey& GetKey() const
+    {
+        return _key;
+    }
+
+    /// Returns the recovery block indices for the block id, or nullptr if
+    /// the id is not covered.  Sets count to the number of entries
+    GF256_FORCE_INLINE const uint16_t* GetRow(uint32_t block_id, unsigned& count) const
+    {
+        const uint32_t index = block_id - _key.BlockCount;
+
+        // Note ids below N wrap around to large values
+        if (index >= _row_count) {
+            return nullptr;
+        }
+
+        const uint32_t offset = _offsets[index];
+        count = _offsets[index + 1] - offset;
+        return &_columns[offset];
+    }
+
+protected:
+    /// Matrix parameters
+    RepairRowKey _key;
+
+    /// Number of repair ids covered
+    uint32_t _row_count = 0;
+
+    /// Start of each row in _columns, plus one past the end
+    std::vector<uint32_t> _offsets;
+
+    /// Recovery block indices of all rows
+    std::vector<uint16_t> _columns;
+};
+
+
+//------------------------------------------------------------------------------
+// RepairRowCache
+
+class RepairRowCache
+{
+public:
+    /// Returns the shared cache
+    static RepairRowCache * GetInstance();
+
+    /**
+        Configure()
+
+        Set how many repair ids each table covers and how many tables are
+        kept.  Tables already held by codecs are not affected.  Setting
+        either value to 0 disables the cache and drops all tables.
+    */
+    void Configure(
+        uint32_t repair_count, ///< Repair ids per table
+        unsigned table_count ///< Maximum tables to keep
+    );
+
+    /**
+        Acquire()
+
+        Returns the table for the given matrix parameters, building it if
+        it is not cached yet.  Returns nullptr if the cache is disabled or
+        the table could not be built.
+    */
+    std::shared_ptr<const RepairRowTable> Acquire(const RepairRowKey& key);
+
+protected:
+    /// Held while touching the members below
+    std::mutex _lock;
+
+    /// Repair ids per table
+    uint32_t _repair_count = 0;
+
+    /// Maximum tables to keep
+    unsigned _table_count = 0;
+
+    /// Cached tables, most recently used first
+    std::list<std::shared_ptr<const RepairRowTable>> _tables;
+};
+
+
+} // namespace wirehair
+
+#endif // WIREHAIR_ROW_CACHE_H
@@ -0,0 +1,320 @@
+/** \file
+    \brief Wirehair : Decoder Session Table
+    \copyright Copyright (c) 2012-2018 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Wirehair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "WirehairSessionTable.h"
+
+namespace wirehair {
+
+
+//------------------------------------------------------------------------------
+// SessionTable
+
+SessionTable::~SessionTable()
+{
+    for (auto& entry : _sessions)
+    {
+        delete entry.second->Decoder;
+        delete entry.second;
+    }
+    for (Codec * decoder : _pool) {
+        delete decoder;
+    }
+}
+
+void SessionTable::Initialize(
+    uint64_t memory_budget_bytes, ///< Bytes all decoders may hold
+    unsigned idle_timeout_msec ///< Evict incomplete sessions idle this long
+)
+{
+    _memory_budget = memory_budget_bytes;
+    _idle_timeout = std::chrono::milliseconds(idle_timeout_msec);
+}
+
+WirehairResult SessionTable::Decode(
+    uint64_t message_id, ///< Message identifier
+    uint64_t message_bytes, ///< Bytes in the message
+    unsigned block_bytes, ///< Bytes in each block
+    const unsigned block_id, ///< Block identifier
+    const void * GF256_RESTRICT block_in, ///< Block data
+    const unsigned data_bytes ///< Bytes in block
+)
+{
+    Expire();
+
+    Session * session;
+    auto found = _sessions.find(message_id);
+
+    // If this is the first block for the message:
+    if (found == _sessions.end())
+    {
+        // Reuse a pooled decoder if possible
+        Codec * decoder;
+        if (!_pool.empty())
+        {
+            decoder = _pool.back();
+            _pool.pop_back();
+        }
+        else
+        {
+            decoder = new (std::nothrow) Codec;
+            if (!decoder) {
+                return Wirehair_OOM;
+            }
+        }
+
+        // Allocations are kept if the new message fits in them
+        const uint64_t old_bytes = decoder->AllocatedBytes();
+        const WirehairResult result = decoder->InitializeDecoder(message_bytes, block_bytes);
+        _memory_bytes = _memory_bytes - old_bytes + decoder->AllocatedBytes();
+
+        session = nullptr;
+        if (result == Wirehair_Success) {
+            session = new (std::nothrow) Session;
+        }
+
+        if (!session)
+        {
+            _pool.push_back(decoder);
+            EnforceBudget(nullptr);
+            return (result != Wirehair_Success) ? result : Wirehair_OOM;
+        }
+
+        session->MessageId = message_id;
+        session->MessageBytes = message_bytes;
+        session->Decoder = decoder;
+        session->Complete = false;
+        _sessions[message_id] = session;
+        LinkNewest(session);
+
+        // If the new session does not fit even after evicting the others:
+        if (!EnforceBudget(session))
+        {
+            Release(session);
+            EnforceBudget(nullptr);
+            return Wirehair_OOM;
+        }
+    }
+    else
+    {
+        session = found->second;
+
+        if (session->MessageBytes != message_bytes ||
+            session->Decoder->BlockBytes() != block_bytes)
+        {
+            return Wirehair_InvalidInput;
+        }
+
+        // If the message was already recovered, this block is not needed
+        if (session->Complete) {
+            return Wirehair_Success;
+        }
+    }
+
+    // The solver allocates its matrix once N blocks have arrived
+    Codec * decoder = session->Decoder;
+    const uint64_t old_bytes = decoder->AllocatedBytes();
+    const WirehairResult result = decoder->DecodeFeed(block_id, block_in, data_bytes);
+    _memory_bytes = _memory_bytes - old_bytes + decoder->AllocatedBytes();
+
+    if (result == Wirehair_Success)
+    {
+        Unlink(session);
+        session->Complete = true;
+        ++_complete_count;
+    }
+    else if (result == Wirehair_NeedMore)
+    {
+        session->LastFed = Clock::now();
+        Unlink(session);
+        LinkNewest(session);
+    }
+    // A malformed block does not spoil the session
+    else if (result != Wirehair_InvalidInput)
+    {
+        Release(session);
+        session = nullptr;
+    }
+
+    EnforceBudget(session);
+
+    return result;
+}
+
+WirehairResult SessionTable::Recover(
+    uint64_t message_id, ///< Message identifier
+    void * GF256_RESTRICT message_out, ///< Message buffer
+    uint64_t message_bytes ///< Bytes in the message
+)
+{
+    auto found = _sessions.find(message_id);
+
+    if (found == _sessions.end() || !found->second->Complete) {
+        return Wirehair_InvalidInput;
+    }
+
+    return found->second->Decoder->ReconstructOutput(message_out, message_bytes);
+}
+
+WirehairResult SessionTable::Remove(uint64_t message_id)
+{
+    auto found = _sessions.find(message_id);
+
+    if (found == _sessions.end()) {
+        return Wirehair_InvalidInput;
+    }
+
+    Release(found->second);
+    EnforceBudget(nullptr);
+
+    return Wirehair_Success;
+}
+
+unsigned SessionTable::Expire()
+{
+    if (_idle_timeout == Clock::duration::zero() || !_oldest) {
+        return 0;
+    }
+
+    const Clock::time_point cutoff = Clock::now() - _idle_timeout;
+    unsigned count = 0;
+
+    // The list is ordered by LastFed, so stop at the first recent session
+    while (_oldest && _oldest->LastFed < cutoff)
+    {
+        Release(_oldest);
+        ++count;
+    }
+
+    _evicted_count += count;
+    return count;
+}
+
+void SessionTable::GetStats(WirehairSessionStats& stats_out) const
+{
+    stats_out.ActiveSessions = (unsigned)_sessions.size() - _complete_count;
+    stats_out.CompleteSessions = _complete_count;
+    stats_out.PooledDecoders = (unsigned)_pool.size();
+    stats_out.EvictedSessions = _evicted_count;
+    stats_out.MemoryBytes = _memory_bytes;
+}
+
+void SessionTable::Unlink(Session * session)
+{
+    if (session->Complete) {
+        return;
+    }
+
+    if (session->Newer) {
+        session->Newer->Older = session->Older;
+    }
+    else {
+        _newest = session->Older;
+    }
+
+    if (session->Older) {
+        session->Older->Newer = session->Newer;
+    }
+    else {
+        _oldest = session->Newer;
+    }
+
+    session->Newer = nullptr;
+    session->Older = nullptr;
+}
+
+void SessionTable::LinkNewest(Session * session)
+{
+    session->LastFed = Clock::now();
+    session->Newer = nullptr;
+    session->Older = _newest;
+
+    if (_newest) {
+        _newest->Newer = session;
+    }
+    else {
+        _oldest = session;
+    }
+    _newest = session;
+}
+
+void SessionTable::Release(Session * session)
+{
+    if (session->Complete) {
+        --_complete_count;
+    }
+    else {
+        Unlink(session);
+    }
+
+    _sessions.erase(session->MessageId);
+    _pool.push_back(session->Decoder);
+    delete session;
+}
+
+bool SessionTable::EnforceBudget(const Session * keep)
+{
+    if (_memory_budget == 0) {
+        return true;
+    }
+
+    // Release pooled decoders first, since they hold no data
+    while (_memory_bytes > _memory_budget && !_pool.empty())
+    {
+        Codec * decoder = _pool.back();
+        _pool.pop_back();
+
+        _memory_bytes -= decoder->AllocatedBytes();
+        delete decoder;
+    }
+
+    // Then evict the least recently fed sessions
+    while (_memory_bytes > _memory_budget)
+    {
+        Session * victim = _oldest;
+        if (victim == keep) {
+            victim = victim->Newer;
+        }
+        if (!victim) {
+            return false;
+        }
+
+        Codec * decoder = victim->Decoder;
+        Release(victim);
+        _pool.pop_back();
+        ++_evicted_count;
+
+        _memory_bytes -= decoder->AllocatedBytes();
+        delete decoder;
+    }
+
+    return true;
+}
+
+
+} // namespace wirehair
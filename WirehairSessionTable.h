@@ -0,0 +1,193 @@
+/** \file
+    \brief Wirehair : Decoder Session Table
+    \copyright Copyright (c) 2012-2018 Christopher A. Taylor.  All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+
+    * Redistributions of source code must retain the above copyright notice,
+      this list of conditions and the following disclaimer.
+    * Redistributions in binary form must reproduce the above copyright notice,
+      this list of conditions and the following disclaimer in the documentation
+      and/or other materials provided with the distribution.
+    * Neither the name of Wirehair nor the names of its contributors may be
+      used to endorse or promote products derived from this software without
+      specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+    AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+    IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+    ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+    LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+    CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+    SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+    INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+    CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+    ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#ifndef WIREHAIR_SESSION_TABLE_H
+#define WIREHAIR_SESSION_TABLE_H
+
+/** \page Decoder Session Table
+
+    A receiver that gets many messages at once needs a decoder per message.
+    The session table owns those decoders, keyed by a 64-bit message id:
+
+        Decode(message_id, block) --> [ id -> Session ] --> DecodeFeed()
+
+    Decoders are recycled through a free pool instead of being freed, and
+    InitializeDecoder() keeps their allocations when the next message fits,
+    so steady-state traffic does not allocate at all.
+
+    Incomplete sessions are kept on a list ordered by the time of their last
+    block.  When the memory held by all decoders goes over the budget, the
+    pool is released first and then the least recently fed sessions are
+    evicted.  Sessions that have not been fed for the idle timeout are
+    evicted from the same end of the list.  Complete sessions are taken off
+    the list, so they are kept until the application removes them.
+
+    The table is not thread-safe: Calls must not overlap.
+*/
+
+#include "WirehairCodec.h"
+
+#include <chrono>
+#include <unordered_map>
+
+namespace wirehair {
+
+
+//------------------------------------------------------------------------------
+// SessionTable
+
+class SessionTable
+{
+public:
+    ~SessionTable();
+
+    /// Set the memory budget and idle timeout.  0 disables either limit
+    void Initialize(
+        uint64_t memory_budget_bytes, ///< Bytes all decoders may hold
+        unsigned idle_timeout_msec ///< Evict incomplete sessions idle this long
+    );
+
+    /**
+        Decode()
+
+        Feed a block to the decoder for message_id, creating the session if
+        this is the first block for it.
+
+        Returns Wirehair_Success once the message can be recovered.
+        Returns Wirehair_NeedMore if more blocks are needed.
+        Returns Wirehair_OOM if the session does not fit in the budget.
+        Returns Wirehair_InvalidInput if the message size or block size
+        does not match the existing session.
+        Returns other codes on error, after removing the session.
+    */
+    WirehairResult Decode(
+        uint64_t message_id, ///< Message identifier
+        uint64_t message_bytes, ///< Bytes in the message
+        unsigned block_bytes, ///< Bytes in each block
+        const unsigned block_id, ///< Block identifier
+        const void * GF256_RESTRICT block_in, ///< Block data
+        const unsigned data_bytes ///< Bytes in block
+    );
+
+    /**
+        Recover()
+
+        Reconstruct the message for a complete session.
+
+        Returns Wirehair_Success if the message was recovered.
+        Returns Wirehair_InvalidInput if the session is unknown or incomplete.
+    */
+    WirehairResult Recover(
+        uint64_t message_id, ///< Message identifier
+        void * GF256_RESTRICT message_out, ///< Message buffer
+        uint64_t message_bytes ///< Bytes in the message
+    );
+
+    /**
+        Remove()
+
+        Remove a session and return its decoder to the pool.
+
+        Returns Wirehair_Success if the session was removed.
+        Returns Wirehair_InvalidInput if the session is unknown.
+    */
+    WirehairResult Remove(uint64_t message_id);
+
+    /// Evict incomplete sessions past the idle timeout.  Returns the count
+    unsigned Expire();
+
+    /// Get statistics
+    void GetStats(WirehairSessionStats& stats_out) const;
+
+protected:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Session
+    {
+        /// Message identifier
+        uint64_t MessageId;
+
+        /// Bytes in the message
+        uint64_t MessageBytes;
+
+        /// Decoder for the message
+        Codec * Decoder;
+
+        /// Time of the last block fed to the decoder
+        Clock::time_point LastFed;
+
+        /// Boolean: Decoder has succeeded and the session is off the list
+        bool Complete;
+
+        /// Neighbors on the list of incomplete sessions, newest first
+        Session * Newer;
+        Session * Older;
+    };
+
+    /// Bytes all decoders may hold, or 0 for no limit
+    uint64_t _memory_budget = 0;
+
+    /// Idle time before an incomplete session is evicted, or 0 for none
+    Clock::duration _idle_timeout = Clock::duration::zero();
+
+    /// Sessions by message id
+    std::unordered_map<uint64_t, Session *> _sessions;
+
+    /// Incomplete sessions, most recently fed first
+    Session * _newest = nullptr;
+    Session * _oldest = nullptr;
+
+    /// Decoders that are not in use
+    std::vector<Codec *> _pool;
+
+    /// Bytes held by decoders in sessions and in the pool
+    uint64_t _memory_bytes = 0;
+
+    /// Counts for GetStats()
+    unsigned _complete_count = 0;
+    uint64_t _evicted_count = 0;
+
+    /// Unlink an incomplete session from the list
+    void Unlink(Session * session);
+
+    /// Link an incomplete session at the newest end of the list
+    void LinkNewest(Session * session);
+
+    /// Remove the session and return its decoder to the pool
+    void Release(Session * session);
+
+    /// Evict pooled decoders and then old sessions other than keep,
+    /// until memory is within budget.  Returns false if it cannot be
+    bool EnforceBudget(const Session * keep);
+};
+
+
+} // namespace wirehair
+
+#endif // WIREHAIR_SESSION_TABLE_H
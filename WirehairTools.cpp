@@ -29,6 +29,7 @@
 
 #include "WirehairTools.h"
 
+#include <algorithm> // std::fill
 #include <cmath>
 #include <cstdlib>
 
@@ -37,6 +38,15 @@
 #pragma intrinsic(_BitScanReverse)
 #endif
 
+#if (defined(__SSE4_2__) || (defined(_MSC_VER) && defined(__AVX__))) && \
+    (defined(__x86_64__) || defined(_M_X64))
+    #define CAT_CRC32C_SSE42 /* _mm_crc32_u64 */
+    #include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32) && defined(__aarch64__)
+    #define CAT_CRC32C_ARMV8 /* __crc32cd */
+    #include <arm_acle.h>
+#endif
+
 
 namespace wirehair {
 
@@ -468,9 +478,6 @@ void ShuffleDeck16(
 /// Stop using weight-1 after this
 static const uint32_t kMaxNForWeight1 = 2048;
 
-/// Maximum columns per peel matrix row
-static const unsigned kMaxPeelCount = 64;
-
 /// Map from a 32-bit uniform random number to a row weight
 /// Probability of weight i = (i-1)/i
 /// e.g. P(2) = 1/2, P(3) = 2/3, ...
@@ -570,17 +577,186 @@ void PeelRowParameters::Initialize(
 }
 
 
+//------------------------------------------------------------------------------
+// Utility: Batched Peel Matrix Row Parameter Initialization
+
+#ifdef GF256_TRY_AVX2
+
+/// PCGRandom::Next() output function for four 64-bit states.
+/// The result is in the low 32 bits of each 64-bit lane
+static GF256_FORCE_INLINE GF256_M256 PCGOutput4(const GF256_M256 state)
+{
+    const GF256_M256 xorshifted = _mm256_srli_epi64(
+        _mm256_xor_si256(_mm256_srli_epi64(state, 18), state), 27);
+    const GF256_M256 rot = _mm256_srli_epi64(state, 59);
+
+    // Shifting left by 32 yields zero, matching the scalar (-rot & 31) mask
+    return _mm256_or_si256(
+        _mm256_srlv_epi32(xorshifted, rot),
+        _mm256_sllv_epi32(xorshifted, _mm256_sub_epi32(_mm256_set1_epi32(32), rot)));
+}
+
+/// PCGRandom::Next() state update for four 64-bit states
+static GF256_FORCE_INLINE GF256_M256 PCGStep4(const GF256_M256 state, const GF256_M256 inc)
+{
+    const GF256_M256 mul_lo = _mm256_set1_epi64x(UINT64_C(6364136223846793005) & 0xffffffff);
+    const GF256_M256 mul_hi = _mm256_set1_epi64x(UINT64_C(6364136223846793005) >> 32);
+
+    // 64x64 -> 64 bit multiply from three 32x32 -> 64 bit multiplies
+    const GF256_M256 cross = _mm256_add_epi64(
+        _mm256_mul_epu32(_mm256_srli_epi64(state, 32), mul_lo),
+        _mm256_mul_epu32(state, mul_hi));
+    const GF256_M256 product = _mm256_add_epi64(
+        _mm256_mul_epu32(state, mul_lo),
+        _mm256_slli_epi64(cross, 32));
+
+    return _mm256_add_epi64(product, inc);
+}
+
+/// Gather the low 32 bits of the 64-bit lanes of two vectors into one
+static GF256_FORCE_INLINE GF256_M256 PackLow32(const GF256_M256 lo, const GF256_M256 hi)
+{
+    const GF256_M256 order = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+    return _mm256_permute2x128_si256(
+        _mm256_permutevar8x32_epi32(lo, order),
+        _mm256_permutevar8x32_epi32(hi, order),
+        0x20);
+}
+
+/// Remainder of 16-bit values in 32-bit lanes by a 16-bit divisor.
+/// For x, d < 2^16 the single-precision quotient never rounds up past the
+/// next integer, so truncating it gives the exact floor(x / d)
+static GF256_FORCE_INLINE GF256_M256 Mod16(const GF256_M256 x, const uint16_t d)
+{
+    const GF256_M256 q = _mm256_cvttps_epi32(_mm256_div_ps(
+        _mm256_cvtepi32_ps(x), _mm256_set1_ps((float)d)));
+    return _mm256_sub_epi32(x, _mm256_mullo_epi32(q, _mm256_set1_epi32(d)));
+}
+
+/// Unsigned a <= b for 32-bit lanes
+static GF256_FORCE_INLINE GF256_M256 LessEqual32(const GF256_M256 a, const GF256_M256 b)
+{
+    return _mm256_cmpeq_epi32(_mm256_min_epu32(a, b), a);
+}
+
+/// GeneratePeelRowWeight() for eight random values
+static GF256_FORCE_INLINE GF256_M256 GeneratePeelRowWeight8(GF256_M256 rv, const uint16_t block_count)
+{
+    GF256_M256 weight1 = _mm256_setzero_si256();
+
+    if (block_count <= kMaxNForWeight1)
+    {
+        // rv < P1 selects weight 1, otherwise rescale to match table values
+        weight1 = LessEqual32(rv, _mm256_set1_epi32((int32_t)(P1 - 1)));
+        rv = _mm256_sub_epi32(rv, _mm256_set1_epi32((int32_t)P1));
+    }
+
+    // Weight is 2 + the number of entries in table[1..62] below rv.
+    // Binary search over table[1..64): probes stay below the last entry
+    const int32_t* table = reinterpret_cast<const int32_t*>(kPeelCountDistribution + 1);
+    GF256_M256 base = _mm256_setzero_si256();
+
+    for (int half = kMaxPeelCount / 2; half >= 1; half /= 2)
+    {
+        const GF256_M256 probe = _mm256_add_epi32(base, _mm256_set1_epi32(half - 1));
+        const GF256_M256 entry = _mm256_i32gather_epi32(table, probe, 4);
+        base = _mm256_add_epi32(base, _mm256_andnot_si256(
+            LessEqual32(rv, entry), _mm256_set1_epi32(half)));
+    }
+
+    const GF256_M256 weight = _mm256_add_epi32(base, _mm256_set1_epi32(2));
+    return _mm256_blendv_epi8(weight, _mm256_set1_epi32(1), weight1);
+}
+
+#endif // GF256_TRY_AVX2
+
+void InitializePeelRowBatch(
+    PeelRowParameters * GF256_RESTRICT params,
+    const uint32_t * GF256_RESTRICT row_seeds,
+    unsigned count,
+    uint32_t p_seed,
+    uint16_t peel_column_count,
+    uint16_t mix_column_count)
+{
+#ifdef GF256_TRY_AVX2
+    const GF256_M256 x = _mm256_set1_epi64x(p_seed);
+    const GF256_M256 low16 = _mm256_set1_epi32(0xffff);
+    const GF256_M256 one = _mm256_set1_epi32(1);
+    const GF256_M256 max_weight = _mm256_set1_epi32(peel_column_count / 2);
+
+    for (; count >= kPeelRowBatch; count -= kPeelRowBatch,
+        row_seeds += kPeelRowBatch, params += kPeelRowBatch)
+    {
+        GF256_M256 rv[3][2];
+
+        for (unsigned half = 0; half < 2; ++half)
+        {
+            // PCGRandom::Seed(row_seed, p_seed)
+            const GF256_M256 seed = _mm256_cvtepu32_epi64(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(row_seeds + half * 4)));
+            const GF256_M256 inc = _mm256_or_si256(_mm256_slli_epi64(seed, 1), _mm256_set1_epi64x(1));
+            GF256_M256 state = PCGStep4(_mm256_add_epi64(inc, x), inc);
+
+            // Three calls to PCGRandom::Next()
+            for (unsigned i = 0; i < 3; ++i)
+            {
+                rv[i][half] = PCGOutput4(state);
+                state = PCGStep4(state, inc);
+            }
+        }
+
+        const GF256_M256 rv_weight = PackLow32(rv[0][0], rv[0][1]);
+        const GF256_M256 rv_peel = PackLow32(rv[1][0], rv[1][1]);
+        const GF256_M256 rv_mix = PackLow32(rv[2][0], rv[2][1]);
+
+        // Do not set more than N/2 at a time
+        const GF256_M256 peel_count = _mm256_min_epu32(
+            GeneratePeelRowWeight8(rv_weight, peel_column_count), max_weight);
+
+        const GF256_M256 peel_add = _mm256_add_epi32(
+            Mod16(_mm256_and_si256(rv_peel, low16), peel_column_count - 1), one);
+        const GF256_M256 peel_first = Mod16(_mm256_srli_epi32(rv_peel, 16), peel_column_count);
+        const GF256_M256 mix_add = _mm256_add_epi32(
+            Mod16(_mm256_and_si256(rv_mix, low16), mix_column_count - 1), one);
+        const GF256_M256 mix_first = Mod16(_mm256_srli_epi32(rv_mix, 16), mix_column_count);
+
+        GF256_ALIGNED uint32_t fields[5][kPeelRowBatch];
+        _mm256_store_si256(reinterpret_cast<GF256_M256*>(fields[0]), peel_count);
+        _mm256_store_si256(reinterpret_cast<GF256_M256*>(fields[1]), peel_first);
+        _mm256_store_si256(reinterpret_cast<GF256_M256*>(fields[2]), peel_add);
+        _mm256_store_si256(reinterpret_cast<GF256_M256*>(fields[3]), mix_first);
+        _mm256_store_si256(reinterpret_cast<GF256_M256*>(fields[4]), mix_add);
+
+        for (unsigned i = 0; i < kPeelRowBatch; ++i)
+        {
+            params[i].PeelCount = (uint16_t)fields[0][i];
+            params[i].PeelFirst = (uint16_t)fields[1][i];
+            params[i].PeelAdd = (uint16_t)fields[2][i];
+            params[i].MixFirst = (uint16_t)fields[3][i];
+            params[i].MixAdd = (uint16_t)fields[4][i];
+
+            CAT_DEBUG_ASSERT(params[i].PeelCount > 0 && params[i].PeelCount <= kMaxPeelCount);
+        }
+    }
+#endif // GF256_TRY_AVX2
+
+    for (unsigned i = 0; i < count; ++i) {
+        params[i].Initialize(row_seeds[i], p_seed, peel_column_count, mix_column_count);
+    }
+}
+
+
 //------------------------------------------------------------------------------
 // SIMD-Safe Aligned Memory Allocations
 
 uint8_t* SIMDSafeAllocate(size_t size)
 {
-    uint8_t* data = (uint8_t*)calloc(1, GF256_ALIGN_BYTES + size);
+    uint8_t* data = (uint8_t*)calloc(1, kBlockAlignBytes + size);
     if (!data) {
         return nullptr;
     }
-    unsigned offset = (unsigned)((uintptr_t)data % GF256_ALIGN_BYTES);
-    data += GF256_ALIGN_BYTES - offset;
+    unsigned offset = (unsigned)((uintptr_t)data % kBlockAlignBytes);
+    data += kBlockAlignBytes - offset;
     data[-1] = (uint8_t)offset;
     return data;
 }
@@ -592,15 +768,229 @@ void SIMDSafeFree(void* ptr)
     }
     uint8_t* data = (uint8_t*)ptr;
     unsigned offset = data[-1];
-    if (offset >= GF256_ALIGN_BYTES) {
+    if (offset >= kBlockAlignBytes) {
         CAT_DEBUG_BREAK(); // Should never happen
         return;
     }
-    data -= GF256_ALIGN_BYTES - offset;
+    data -= kBlockAlignBytes - offset;
     free(data);
 }
 
 
+//------------------------------------------------------------------------------
+// CRC32C
+
+#if !defined(CAT_CRC32C_SSE42) && !defined(CAT_CRC32C_ARMV8)
+
+/// Byte-at-a-time table for the reflected CRC32C polynomial
+struct Crc32cTable
+{
+    uint32_t Table[256];
+
+    Crc32cTable()
+    {
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t crc = i;
+            for (unsigned j = 0; j < 8; ++j) {
+                crc = (crc >> 1) ^ (0x82F63B78 & (0 - (crc & 1)));
+            }
+            Table[i] = crc;
+        }
+    }
+};
+
+static const uint32_t* GetCrc32cTable()
+{
+    static const Crc32cTable table;
+    return table.Table;
+}
+
+#endif // CAT_CRC32C_SSE42 || CAT_CRC32C_ARMV8
+
+uint32_t Crc32c(uint32_t crc, const void* data, size_t bytes)
+{
+    const uint8_t* src = reinterpret_cast<const uint8_t*>(data);
+    crc = ~crc;
+
+#if defined(CAT_CRC32C_SSE42) || defined(CAT_CRC32C_ARMV8)
+    uint64_t crc64 = crc;
+    for (; bytes >= 8; bytes -= 8, src += 8)
+    {
+        uint64_t word;
+        memcpy(&word, src, 8);
+#if defined(CAT_CRC32C_SSE42)
+        crc64 = _mm_crc32_u64(crc64, word);
+#else
+        crc64 = __crc32cd((uint32_t)crc64, word);
+#endif
+    }
+    crc = (uint32_t)crc64;
+    for (; bytes > 0; --bytes, ++src) {
+#if defined(CAT_CRC32C_SSE42)
+        crc = _mm_crc32_u8(crc, *src);
+#else
+        crc = __crc32cb(crc, *src);
+#endif
+    }
+#else
+    const uint32_t* table = GetCrc32cTable();
+    for (; bytes > 0; --bytes, ++src) {
+        crc = table[(crc ^ *src) & 0xff] ^ (crc >> 8);
+    }
+#endif
+
+    return ~crc;
+}
+
+uint32_t Crc32cCopy(uint32_t crc, void* dest, const void* src, size_t bytes)
+{
+    uint8_t* out = reinterpret_cast<uint8_t*>(dest);
+    const uint8_t* in = reinterpret_cast<const uint8_t*>(src);
+    crc = ~crc;
+
+#if defined(CAT_CRC32C_SSE42) || defined(CAT_CRC32C_ARMV8)
+    uint64_t crc64 = crc;
+    for (; bytes >= 8; bytes -= 8, in += 8, out += 8)
+    {
+        uint64_t word;
+        memcpy(&word, in, 8);
+        memcpy(out, &word, 8);
+#if defined(CAT_CRC32C_SSE42)
+        crc64 = _mm_crc32_u64(crc64, word);
+#else
+        crc64 = __crc32cd((uint32_t)crc64, word);
+#endif
+    }
+    crc = (uint32_t)crc64;
+    for (; bytes > 0; --bytes, ++in, ++out)
+    {
+        const uint8_t b = *in;
+        *out = b;
+#if defined(CAT_CRC32C_SSE42)
+        crc = _mm_crc32_u8(crc, b);
+#else
+        crc = __crc32cb(crc, b);
+#endif
+    }
+#else
+    const uint32_t* table = GetCrc32cTable();
+    for (; bytes > 0; --bytes, ++in, ++out)
+    {
+        const uint8_t b = *in;
+        *out = b;
+        crc = table[(crc ^ b) & 0xff] ^ (crc >> 8);
+    }
+#endif
+
+    return ~crc;
+}
+
+
+//------------------------------------------------------------------------------
+// Received Block Id Filter
+
+bool ReceivedIdFilter::Reset(unsigned block_count)
+{
+    try
+    {
+        _originals.assign((block_count + 63) / 64, 0);
+
+        // Keep a grown hash set from the last message, since the next one
+        // likely sees a similar number of repair blocks
+        if (_repairs.size() < kMinRepairSlots) {
+            _repairs.assign(kMinRepairSlots, 0);
+        }
+        else if (_repair_count > 0) {
+            std::fill(_repairs.begin(), _repairs.end(), 0);
+        }
+    }
+    catch (...)
+    {
+        // Leave the filter empty so that Contains() stays safe to call
+        _block_count = 0;
+        _originals.clear();
+        _repairs.clear();
+        _repair_count = 0;
+        return false;
+    }
+
+    _block_count = block_count;
+    _repair_count = 0;
+    return true;
+}
+
+bool ReceivedIdFilter::Insert(uint32_t id)
+{
+    if (id < _block_count) {
+        _originals[id / 64] |= (uint64_t)1 << (id % 64);
+    }
+    else if (!FindRepair(id))
+    {
+        if (!Reserve()) {
+            return false;
+        }
+        InsertRepair(id);
+    }
+    return true;
+}
+
+bool ReceivedIdFilter::FindRepair(uint32_t id) const
+{
+    // If Reset() failed, nothing was inserted
+    if (_repairs.empty()) {
+        return false;
+    }
+
+    const unsigned mask = (unsigned)(_repairs.size() - 1);
+
+    // Linear probe until the id or an empty slot is found
+    for (unsigned slot = GetRepairSlot(id);; slot = (slot + 1) & mask)
+    {
+        const uint32_t stored = _repairs[slot];
+        if (stored == id) {
+            return true;
+        }
+        if (stored == 0) {
+            return false;
+        }
+    }
+}
+
+void ReceivedIdFilter::InsertRepair(uint32_t id)
+{
+    const unsigned mask = (unsigned)(_repairs.size() - 1);
+    unsigned slot = GetRepairSlot(id);
+    while (_repairs[slot] != 0) {
+        slot = (slot + 1) & mask;
+    }
+
+    _repairs[slot] = id;
+    ++_repair_count;
+}
+
+bool ReceivedIdFilter::GrowRepairs()
+{
+    std::vector<uint32_t> old_repairs;
+    try {
+        old_repairs.assign(_repairs.empty() ? kMinRepairSlots : _repairs.size() * 2, 0);
+    }
+    catch (...) {
+        return false;
+    }
+    old_repairs.swap(_repairs);
+    _repair_count = 0;
+
+    for (uint32_t stored : old_repairs) {
+        if (stored != 0) {
+            InsertRepair(stored);
+        }
+    }
+
+    return true;
+}
+
+
 //------------------------------------------------------------------------------
 // Tables for small N
 
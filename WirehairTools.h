@@ -33,6 +33,7 @@
 #include <wirehair/wirehair.h>
 #include "gf256.h"
 #include <new> // std::nothrow
+#include <vector>
 
 // Compiler-specific debug break
 #if defined(_DEBUG) || defined(DEBUG)
@@ -66,6 +67,7 @@ namespace wirehair {
 #define CAT_MAX_EXTRA_ROWS 32    /**< Maximum number of extra rows to support before reusing existing rows */
 #define CAT_WIREHAIR_MAX_N 64000 /**< Largest N value to allow */
 #define CAT_WIREHAIR_MIN_N 2     /**< Smallest N value to allow */
+#define CAT_MDS_MAX_N      40    /**< Largest N value the Cauchy code can be configured for */
 
 // Optimization options:
 #define CAT_COPY_FIRST_N      /**< Copy the first N rows from the input (faster) */
@@ -73,6 +75,9 @@ namespace wirehair {
 #define CAT_WINDOWED_BACKSUB  /**< Use window optimization for back-substitution (faster) */
 #define CAT_WINDOWED_LOWERTRI /**< Use window optimization for lower triangle elimination (faster) */
 #define CAT_ALL_ORIGINAL      /**< Avoid doing calculations for 0 losses -- Requires CAT_COPY_FIRST_N (faster) */
+#define CAT_PREFETCH_BLOCKS   /**< Prefetch recovery blocks ahead of row operations (for large N and blocks) */
+#define CAT_TILED_SOLVE       /**< Solve very large blocks one cache-sized tile at a time (faster for large blocks) */
+#define CAT_SMALL_N_MDS       /**< Build the Cauchy code for small N, enabled by wirehair_small_n_configure() (faster for small N) */
 
 /// Number of heavy rows at the bottom of the matrix
 static const unsigned kHeavyRows = 6;
@@ -288,6 +293,9 @@ uint16_t GeneratePeelRowWeight(
 //------------------------------------------------------------------------------
 // Utility: Peel Matrix Row Parameter Initialization
 
+/// Maximum columns per peel matrix row
+static const unsigned kMaxPeelCount = 64;
+
 struct PeelRowParameters
 {
     /// Peeling matrix: Column generator
@@ -305,6 +313,26 @@ struct PeelRowParameters
         uint16_t mix_column_count);
 };
 
+/// Number of rows InitializePeelRowBatch() generates per SIMD pass
+static const unsigned kPeelRowBatch = 8;
+
+/**
+    InitializePeelRowBatch()
+
+    Same result as calling PeelRowParameters::Initialize() for each seed.
+
+    When AVX2 is available, the PRNG, row weight and column generator
+    parameters are computed for kPeelRowBatch rows at a time.  This matters
+    when a message has many small blocks.  Leftover rows use the scalar code.
+*/
+void InitializePeelRowBatch(
+    PeelRowParameters * GF256_RESTRICT params, ///< Output parameters, one per seed
+    const uint32_t * GF256_RESTRICT row_seeds, ///< Row PRNG seeds
+    unsigned count, ///< Number of rows
+    uint32_t p_seed,
+    uint16_t peel_column_count,
+    uint16_t mix_column_count);
+
 
 //------------------------------------------------------------------------------
 // Utility: Peel Row Iterator
@@ -409,6 +437,24 @@ public:
         }
     }
 
+    /// Initialize from a cached row if provided, or else from parameters
+    GF256_FORCE_INLINE RowMixIterator(
+        const uint16_t* cachedRow,
+        const PeelRowParameters& params,
+        uint16_t columnCount,
+        uint16_t columnCountNextPrime)
+    {
+        if (cachedRow)
+        {
+            for (unsigned i = 0; i < kColumnCount; ++i) {
+                Columns[i] = cachedRow[i];
+            }
+        }
+        else {
+            *this = RowMixIterator(params, columnCount, columnCountNextPrime);
+        }
+    }
+
     /// Number of output columns
     static const unsigned kColumnCount = 3;
 
@@ -417,16 +463,257 @@ public:
 };
 
 
+//------------------------------------------------------------------------------
+// Utility: Cached Peel Row Iterator
+
+/**
+    Generates the same columns as PeelRowIterator, but reads them from a
+    list that was stored when the row was first seen, if one is provided.
+    The list holds the RowMixIterator columns first, then the peel columns.
+*/
+class CachedPeelRowIterator
+{
+public:
+    /// Initialize iterator with parameters and an optional cached row
+    GF256_FORCE_INLINE CachedPeelRowIterator(
+        const uint16_t* cachedRow,
+        const PeelRowParameters& params,
+        uint16_t columnCount,
+        uint16_t columnCountNextPrime)
+        : Generator(params, columnCount, columnCountNextPrime)
+    {
+        if (cachedRow)
+        {
+            // Skip the mix columns
+            Cached = cachedRow + RowMixIterator::kColumnCount;
+            ColumnsRemaining = params.PeelCount - 1;
+            Column = Cached[0];
+        }
+        else {
+            Column = Generator.GetColumn();
+        }
+    }
+
+    /// Get current column
+    GF256_FORCE_INLINE uint16_t GetColumn() const
+    {
+        return Column;
+    }
+
+    /// Get the next column.
+    /// Returns true on success.
+    /// Returns false if no more columns remain
+    GF256_FORCE_INLINE bool Iterate()
+    {
+        if (Cached)
+        {
+            if (ColumnsRemaining <= 0) {
+                return false;
+            }
+            --ColumnsRemaining;
+            Column = *++Cached;
+            return true;
+        }
+
+        if (!Generator.Iterate()) {
+            return false;
+        }
+        Column = Generator.GetColumn();
+        return true;
+    }
+
+protected:
+    /// Used when the row is not cached
+    PeelRowIterator Generator;
+
+    /// Next cached column, or nullptr
+    const uint16_t* Cached = nullptr;
+
+    /// Number of cached columns remaining in this row
+    uint16_t ColumnsRemaining = 0;
+
+    /// Current column
+    uint16_t Column = 0;
+};
+
+
 //------------------------------------------------------------------------------
 // SIMD-Safe Aligned Memory Allocations
 
-/// Allocate memory and return a pointer aligned to the size used for SIMD ops
+/// Alignment of SIMDSafeAllocate() pointers: a cache line, which is also a
+/// multiple of the size used for SIMD ops
+static const unsigned kBlockAlignBytes = 64;
+
+/// Blocks shorter than this are stored packed, since padding them out to a
+/// cache line would waste more memory than the aligned row operations save
+static const unsigned kMinPaddedBlockBytes = 512;
+
+/**
+    GetBlockPitch()
+
+    Returns the row pitch for block storage owned by the codec.  Rows are
+    padded to a multiple of kBlockAlignBytes so that every row starts on a
+    cache line: row operations then never split a SIMD load across lines
+    and the prefetcher sees whole lines per block.
+*/
+GF256_FORCE_INLINE unsigned GetBlockPitch(unsigned block_bytes)
+{
+    if (block_bytes < kMinPaddedBlockBytes ||
+        block_bytes > 0xffffffffu - (kBlockAlignBytes - 1))
+    {
+        return block_bytes;
+    }
+    return (block_bytes + kBlockAlignBytes - 1) & ~(kBlockAlignBytes - 1);
+}
+
+/// Allocate memory and return a pointer aligned to kBlockAlignBytes
 uint8_t* SIMDSafeAllocate(size_t size);
 
 /// Free an aligned pointer
 void SIMDSafeFree(void* ptr);
 
 
+//------------------------------------------------------------------------------
+// Block Prefetch
+
+/// Cache lines fetched at the start of each block.  The hardware prefetcher
+/// picks up the rest of a long block once it is being read in order
+static const unsigned kPrefetchLines = 4;
+
+/// Bytes per cache line assumed for prefetching
+static const unsigned kPrefetchLineBytes = 64;
+
+/// Substitute() only prefetches the next row's blocks for blocks at least
+/// this large.  Finding the blocks means stepping the row's column
+/// generators a second time, and for smaller blocks that extra work is
+/// about as large as the cache misses it hides
+static const unsigned kMinPrefetchRowBytes = 4096;
+
+/**
+    PrefetchBlock()
+
+    Hint that a block will be read or written soon.  The row operations
+    visit recovery blocks in a pseudo-random order, so for large N each
+    block access would otherwise be a cache miss.  Issuing the hint a few
+    operations ahead overlaps the miss with the preceding XORs.
+*/
+GF256_FORCE_INLINE void PrefetchBlock(const void* block, unsigned bytes)
+{
+#if defined(CAT_PREFETCH_BLOCKS)
+    const char* line = reinterpret_cast<const char*>(block);
+    const unsigned lines = (bytes + kPrefetchLineBytes - 1) / kPrefetchLineBytes;
+    const unsigned count = (lines < kPrefetchLines) ? lines : kPrefetchLines;
+
+    for (unsigned i = 0; i < count; ++i, line += kPrefetchLineBytes)
+    {
+#if defined(_MSC_VER) && !defined(GF256_TARGET_MOBILE)
+        _mm_prefetch(line, _MM_HINT_T0);
+#elif defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(line);
+#endif
+    }
+#else
+    (void)block;
+    (void)bytes;
+#endif
+}
+
+
+//------------------------------------------------------------------------------
+// CRC32C
+
+/**
+    Crc32c()
+
+    Returns the CRC32C (Castagnoli) of the data, continuing from crc.
+    Pass crc = 0 for the first piece.  Uses the SSE4.2 or ARMv8 CRC
+    instructions when the build targets them, and a table otherwise.
+*/
+uint32_t Crc32c(uint32_t crc, const void* data, size_t bytes);
+
+/**
+    Crc32cCopy()
+
+    Same as Crc32c(), but also copies the data from src to dest.  Each
+    word is loaded once and feeds both the store and the checksum, so it
+    costs about the same as the checksum alone.
+*/
+uint32_t Crc32cCopy(uint32_t crc, void* dest, const void* src, size_t bytes);
+
+
+//------------------------------------------------------------------------------
+// Received Block Id Filter
+
+/**
+    ReceivedIdFilter
+
+    Remembers the block ids the decoder has used, so that duplicates can be
+    dropped in O(1) before any copying or peeling.  Original ids (< N) are
+    a dense bitmap.  Repair ids go into an open-addressed hash set that
+    starts small and doubles when it is half full.
+*/
+class ReceivedIdFilter
+{
+public:
+    /// Forget all ids and size the bitmap for block_count original blocks.
+    /// Returns false if out of memory
+    bool Reset(unsigned block_count);
+
+    /// Returns true if the id was inserted since the last Reset()
+    GF256_FORCE_INLINE bool Contains(uint32_t id) const
+    {
+        if (id < _block_count) {
+            return (_originals[id / 64] & ((uint64_t)1 << (id % 64))) != 0;
+        }
+        return FindRepair(id);
+    }
+
+    /// Make room so that the next Insert() cannot fail.
+    /// Returns false if out of memory
+    GF256_FORCE_INLINE bool Reserve()
+    {
+        // If the set would be more than half full, double it
+        if ((_repair_count + 1) * 2 > _repairs.size()) {
+            return GrowRepairs();
+        }
+        return true;
+    }
+
+    /// Remember the id.  Returns false if out of memory, in which case
+    /// the id was not inserted
+    bool Insert(uint32_t id);
+
+protected:
+    /// Initial number of hash set slots.  Must be a power of two
+    static const unsigned kMinRepairSlots = 64;
+
+    /// Number of original blocks
+    uint32_t _block_count = 0;
+
+    /// Bit per original id
+    std::vector<uint64_t> _originals;
+
+    /// Hash set slots for repair ids.  Repair ids are at least N >= 2,
+    /// so zero marks an empty slot
+    std::vector<uint32_t> _repairs;
+
+    /// Number of repair ids in the hash set
+    unsigned _repair_count = 0;
+
+    /// First slot to probe for the id
+    GF256_FORCE_INLINE unsigned GetRepairSlot(uint32_t id) const
+    {
+        return (id * 0x9E3779B1u) & (unsigned)(_repairs.size() - 1);
+    }
+
+    bool FindRepair(uint32_t id) const;
+    void InsertRepair(uint32_t id);
+
+    /// Double the hash set and rehash.  Returns false if out of memory
+    bool GrowRepairs();
+};
+
+
 //------------------------------------------------------------------------------
 // Tables for small N
 
@@ -115,10 +115,32 @@ typedef enum WirehairResult_t
     /// Platform is not supported yet
     Wirehair_UnsupportedPlatform = 10,
 
+    /// The operation would have to wait (for example a queue is full)
+    Wirehair_WouldBlock          = 11,
+
+    /// Solving has started but is not finished: Call wirehair_decode_step()
+    Wirehair_InProgress          = 12,
+
+    /// The block data does not match the CRC32C passed with it
+    Wirehair_BadChecksum         = 13,
+
     WirehairResult_Count, /* for asserts */
     WirehairResult_Padding = 0x7fffffff /* int32_t padding */
 } WirehairResult;
 
+/// Ways the solver can choose columns to defer to Gaussian elimination
+typedef enum WirehairDeferStrategy_t
+{
+    /// Defer the column in the most rows with two unsolved columns (default)
+    Wirehair_Defer_Weight2       = 0,
+
+    /// RaptorQ-style inactivation: Usually a smaller GE matrix
+    Wirehair_Defer_Inactivation  = 1,
+
+    WirehairDeferStrategy_Count, /* for asserts */
+    WirehairDeferStrategy_Padding = 0x7fffffff /* int32_t padding */
+} WirehairDeferStrategy;
+
 /// Get WirehairResult string function
 WIREHAIR_EXPORT const char *wirehair_result_string(
     WirehairResult result ///< Result code to convert to string
@@ -178,6 +200,82 @@ WIREHAIR_EXPORT WirehairCodec wirehair_encoder_create(
     uint32_t    blockBytes  ///< Bytes in an output block
 );
 
+/// One piece of a message that is split across several buffers
+typedef struct WirehairSegment_t
+{
+    /// Pointer to segment data
+    const void* Data;
+
+    /// Bytes in the segment, which may be zero
+    uint64_t Bytes;
+} WirehairSegment;
+
+/// One piece of an output buffer that is split across several buffers
+typedef struct WirehairOutputSegment_t
+{
+    /// Pointer to segment data
+    void* Data;
+
+    /// Bytes in the segment, which may be zero
+    uint64_t Bytes;
+} WirehairOutputSegment;
+
+/**
+    wirehair_encoder_create_segments()
+
+    Encode a message that is the concatenation of segmentCount buffers,
+    for example a list of pages or protocol buffers, without first copying
+    it into one contiguous buffer.
+
+    Blocks that lie inside one segment are read in place.  Blocks that
+    straddle a segment boundary are gathered into a copy owned by the codec,
+    so at most segmentCount - 1 blocks are copied.  As with
+    wirehair_encoder_create(), the segments must stay valid and unchanged
+    while the encoder is in use.
+
+    The produced blocks are the same as for wirehair_encoder_create() on the
+    concatenated message.
+
+    Pass 0 for reuseOpt if you do not want to reuse a WirehairCodec object.
+
+    Returns a non-zero object pointer on success.
+    Returns nullptr(0) on failure.
+*/
+WIREHAIR_EXPORT WirehairCodec wirehair_encoder_create_segments(
+    WirehairCodec           reuseOpt, ///< [Optional] Pointer to prior codec object
+    const WirehairSegment* segments, ///< Pointer to each segment
+    unsigned           segmentCount, ///< Number of segments
+    uint32_t             blockBytes  ///< Bytes in an output block
+);
+
+/**
+    wirehair_encoder_create_many()
+
+    Create an encoder for each of a batch of messages, for example when
+    flushing many objects to storage at once.
+
+    The work is spread over threadCount threads, including the calling
+    thread.  Messages are handed out largest first, in small groups with
+    the same N, so each thread tends to build codecs of the same shape
+    back to back.  After the first codec of a group, each one makes a
+    single large allocation for its solver state instead of two, which
+    keeps the threads from queuing up in the allocator.
+
+    On return codecsOut[i] is the encoder for messages[i], or nullptr if
+    that message failed.  Each encoder must be freed with wirehair_free().
+
+    Returns Wirehair_Success if every encoder was created.
+    Returns the error for the first message that failed otherwise.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_encoder_create_many(
+    const void* const* messages, ///< Pointer to each message
+    const uint64_t* messageBytes, ///< Bytes in each message
+    unsigned              count, ///< Number of messages
+    uint32_t         blockBytes, ///< Bytes in an output block
+    WirehairCodec*    codecsOut, ///< Set to an encoder for each message
+    unsigned        threadCount  ///< Number of threads, or 0 for all cores
+);
+
 /**
     wirehair_encode()
 
@@ -187,6 +285,15 @@ WIREHAIR_EXPORT WirehairCodec wirehair_encoder_create(
     This "systematic" property can be used to run the encoder
     in parallel with sending original data.
     The `blockId` >= N blocks are generated on demand.
+    If wirehair_small_n_configure() enabled the Cauchy code for this N,
+    the blocks with N <= `blockId` < 256 come from that code instead
+    (see below).
+
+    Thread-safety: This function does not modify the codec, so any number of
+    threads may call it at the same time on the same encoder, for example to
+    produce different repair blocks for each peer.  It must not be called
+    while another thread is running wirehair_encoder_update(), or is
+    re-creating or freeing the codec.
 
     Preconditions:
        Block is at least `blockBytes` in size
@@ -202,6 +309,226 @@ WIREHAIR_EXPORT WirehairResult wirehair_encode(
     uint32_t* dataBytesOut  ///< Number of bytes written <= blockBytes
 );
 
+/**
+    wirehair_encode_view()
+
+    Same as wirehair_encode(), but instead of copying the block into a
+    buffer it returns a pointer to it, so that zero-copy senders can
+    transmit original blocks without touching the bytes.
+
+    For `blockId` < N the pointer is into the message passed to
+    wirehair_encoder_create(), and stays valid as long as the message.
+    Other blocks are generated into a buffer owned by the calling thread,
+    which is overwritten by that thread's next call.  This includes the
+    original blocks after wirehair_decoder_becomes_encoder().
+
+    Returns Wirehair_Success on success.
+    Returns other codes on error.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_encode_view(
+    WirehairCodec      codec, ///< Pointer to codec from wirehair_encoder_init()
+    unsigned         blockId, ///< Identifier of block to generate
+    const void** blockDataOut, ///< Set to a pointer to the block data
+    uint32_t*   dataBytesOut  ///< Set to the number of bytes in the block
+);
+
+/**
+    wirehair_encode_segments()
+
+    Same as wirehair_encode(), but the block is written across a list of
+    output segments in order, filling each before moving on to the next.
+    For example, a block can be split between the end of one send buffer
+    and the start of the next.  The block is written directly into the
+    segments without a staging copy.
+
+    Preconditions:
+       The segments hold at least `blockBytes` bytes in total
+
+    Returns Wirehair_Success on success.
+    Returns other codes on error.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_encode_segments(
+    WirehairCodec                    codec, ///< Pointer to codec from wirehair_encoder_init()
+    unsigned                       blockId, ///< Identifier of block to generate
+    const WirehairOutputSegment* segments, ///< Pointer to each output segment
+    unsigned                  segmentCount, ///< Number of segments
+    uint32_t*                 dataBytesOut  ///< Number of bytes written <= blockBytes
+);
+
+/**
+    wirehair_encode_crc()
+
+    Same as wirehair_encode(), and also sets crcOut to the CRC32C of the
+    bytes written.  The checksum is computed while the block is produced,
+    which is cheaper than a separate pass over the block afterwards.
+
+    Send the CRC with the block and pass it to wirehair_decode_crc().
+
+    Returns Wirehair_Success on success.
+    Returns other codes on error.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_encode_crc(
+    WirehairCodec    codec, ///< Pointer to codec from wirehair_encoder_init()
+    unsigned       blockId, ///< Identifier of block to generate
+    void*     blockDataOut, ///< Pointer to output block data
+    uint32_t      outBytes, ///< Bytes in the output buffer
+    uint32_t* dataBytesOut, ///< Number of bytes written <= blockBytes
+    uint32_t*        crcOut  ///< Set to the CRC32C of the bytes written
+);
+
+/**
+    wirehair_repair_cache_configure()
+
+    Precompute the rows for repair ids N .. N + repairCount - 1, and share
+    them between all encoders with the same N.  This suits carousel and
+    multicast senders that encode the same repair ids for many messages.
+    For the covered ids, wirehair_encode() skips generating the row and
+    only sums the blocks.
+
+    Tables are kept for the tableCount most recently used values of N.
+    Each table takes about 20 bytes per repair id and is built the first
+    time an encoder with that N is created after this call.  Encoders keep
+    using their table after it is evicted, until they are freed.
+
+    Pass 0 for either value to disable the cache, which is the default.
+    This may be called from any thread at any time.
+
+    Returns Wirehair_Success on success.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_repair_cache_configure(
+    uint32_t repairCount, ///< Repair ids to precompute per N, or 0 to disable
+    unsigned  tableCount  ///< Number of N values to keep
+);
+
+/**
+    wirehair_small_n_configure()
+
+    Use a systematic Cauchy Reed-Solomon code over GF(256) for messages of
+    up to maxN blocks, where maxN is at most 40.  Any N different blocks
+    with ids below 256 recover the message, so there is no reception
+    overhead, and the code is faster to set up than Wirehair at that size.
+
+    Repair ids from 256 up produce the same blocks as the Wirehair code,
+    so an encoder keeps producing new blocks as usual.  When those are
+    received, a few extra blocks may be needed as for Wirehair.
+
+    Wire format: Repair blocks with N <= `blockId` < 256 differ from the
+    Wirehair code.  Both peers must use the same setting for each N, for
+    example by agreeing on it when the session is set up.
+
+    This applies to codecs created after the call, and 0 disables it,
+    which is the default.  State from wirehair_encoder_export() and
+    wirehair_decoder_save() records which code it uses, so it loads the
+    same way under any setting.  This may be called from any thread.
+
+    Returns Wirehair_Success on success.
+    Returns Wirehair_InvalidInput if maxN is above 40.
+    Returns Wirehair_UnsupportedPlatform if the library was built without
+    the Cauchy code.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_small_n_configure(
+    unsigned maxN ///< Largest N to use the Cauchy code for, or 0 to disable
+);
+
+/**
+    wirehair_encoder_update()
+
+    Replace one block of the message given to wirehair_encoder_create(),
+    updating the recovery blocks without encoding the whole message again.
+
+    The cost is proportional to the size of the recovery set for each
+    changed block, so it is best suited to messages where only a few
+    blocks change between versions.
+
+    This modifies the recovery set, so no wirehair_encode() calls may be in
+    progress on other threads while it runs.
+
+    The message buffer must still contain the old block data when this is
+    called.  After it succeeds, the application must copy the new data into
+    the message buffer, since blockId < N blocks are read from there by
+    wirehair_encode().
+
+    Preconditions:
+        Codec was created by wirehair_encoder_create()
+        blockId < N
+        dataBytes = blockBytes (or the size of the final partial block)
+
+    Returns Wirehair_Success on success.
+    Returns other codes on error.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_encoder_update(
+    WirehairCodec    codec, ///< Pointer to codec from wirehair_encoder_create()
+    unsigned       blockId, ///< Identifier of the message block to replace
+    const void*    newData, ///< Pointer to new block data
+    uint32_t     dataBytes  ///< Number of bytes in the block
+);
+
+/**
+    wirehair_encoder_export()
+
+    Write the solved state of an encoder, so that it can be loaded again
+    with wirehair_encoder_import() or wirehair_encoder_attach() without
+    running the solver.  This suits content that is served repeatedly, or
+    by several sender processes.
+
+    The state is about (N + a few percent) * blockBytes long.  It uses the
+    native byte order and is only valid for the same library version.
+
+    Call once with stateOut = nullptr to get the size in stateBytesOut,
+    then again with a buffer of that size.
+
+    Returns Wirehair_Success on success.
+    Returns Wirehair_InvalidInput if the codec has no solved state, for
+    example a decoder that is still receiving, or if the buffer is too small.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_encoder_export(
+    WirehairCodec       codec, ///< Encoder to export
+    void*            stateOut, ///< State output, or nullptr for the size
+    uint64_t         outBytes, ///< Bytes available at stateOut
+    uint64_t*   stateBytesOut  ///< Set to the state size in bytes
+);
+
+/**
+    wirehair_encoder_import()
+
+    Create an encoder from a copy of wirehair_encoder_export() state.
+
+    If messageOpt is provided, original blocks are read from it as with
+    wirehair_encoder_create(), and it must stay valid while the encoder is
+    in use.  Otherwise wirehair_encode() generates the original blocks from
+    the solved state, which is slower, as after
+    wirehair_decoder_becomes_encoder().
+
+    Returns a non-zero object pointer on success.
+    Returns nullptr(0) on failure.
+*/
+WIREHAIR_EXPORT WirehairCodec wirehair_encoder_import(
+    WirehairCodec reuseOpt, ///< Codec object to reuse
+    const void*      state, ///< Exported state
+    uint64_t    stateBytes, ///< Bytes of exported state
+    const void* messageOpt  ///< Original message, or nullptr
+);
+
+/**
+    wirehair_encoder_attach()
+
+    Same as wirehair_encoder_import(), but the encoder reads the exported
+    state in place instead of copying it.  The state may be read-only, for
+    example a shared memory mapping of a file, so several processes can
+    encode from one copy.  The state must outlive the encoder.
+
+    wirehair_encoder_update() is not available for attached encoders.
+
+    Returns a non-zero object pointer on success.
+    Returns nullptr(0) on failure.
+*/
+WIREHAIR_EXPORT WirehairCodec wirehair_encoder_attach(
+    WirehairCodec reuseOpt, ///< Codec object to reuse
+    const void*      state, ///< Exported state
+    uint64_t    stateBytes, ///< Bytes of exported state
+    const void* messageOpt  ///< Original message, or nullptr
+);
+
 /**
     wirehair_decoder_create()
 
@@ -225,14 +552,17 @@ WIREHAIR_EXPORT WirehairCodec wirehair_decoder_create(
 
     Provide the decoder with a block from the wirehair_encode() function.
 
-    Preconditions:
-    The application must not provide duplicate data for the same packet.
-    In other words, blockId values cannot be used twice.
+    Blocks with a blockId that was already provided are ignored and return
+    Wirehair_NeedMore, so the application does not need to filter out
+    retransmitted blocks itself.  The check is a bitmap lookup for original
+    blocks and a hash lookup for repair blocks.
 
     Returns Wirehair_Success if data recovery is complete.
     + Use wirehair_recover() or wirehair_recover_block()
       to reconstruct the recovered data.
     Returns Wirehair_NeedsMoreData if more data is needed to decode.
+    Returns Wirehair_InProgress if stepped solving is enabled and
+    wirehair_decode_step() should be called.
     Returns other codes on error.
 */
 WIREHAIR_EXPORT WirehairResult wirehair_decode(
@@ -242,6 +572,129 @@ WIREHAIR_EXPORT WirehairResult wirehair_decode(
     uint32_t    dataBytes  ///< Number of bytes in the data block
 );
 
+/**
+    wirehair_decode_crc()
+
+    Same as wirehair_decode(), but the block is checked against the CRC32C
+    from wirehair_encode_crc() as it is copied into the decoder.  The CRC
+    covers the data bytes of the block, which is fewer than blockBytes for
+    the final block.
+
+    A corrupted block is dropped before it can affect the decoder, so the
+    application can keep feeding other blocks as if it was never received.
+
+    Returns Wirehair_BadChecksum if the data does not match the CRC.
+    Returns other values as wirehair_decode() does.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_decode_crc(
+    WirehairCodec   codec, ///< Codec object
+    unsigned      blockId, ///< ID number of received block
+    const void* blockData, ///< Pointer to block data
+    uint32_t    dataBytes, ///< Number of bytes in the data block
+    uint32_t          crc  ///< CRC32C of the data bytes from the encoder
+);
+
+/**
+    wirehair_decoder_set_stepped()
+
+    Opt in to running the decoder's matrix solver in time slices, for
+    applications that decode on a single-threaded event loop.
+
+    When enabled, wirehair_decode() does not solve the matrix itself once
+    enough blocks have arrived.  It returns Wirehair_InProgress instead,
+    and the application calls wirehair_decode_step() until it returns
+    something else.
+
+    Blocks passed to wirehair_decode() while a solve is in progress also
+    return Wirehair_InProgress.  Until the decoder knows whether it has
+    enough blocks, it keeps a copy of up to 32 of them, and uses them if
+    the solve ends up needing more rows.  When that queue is full,
+    wirehair_decode() returns Wirehair_WouldBlock, and the block should be
+    passed in again after wirehair_decode_step() returns.
+
+    This must be called after wirehair_decoder_create().
+
+    Returns Wirehair_Success on success.
+    Returns other codes on error.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_decoder_set_stepped(
+    WirehairCodec codec, ///< Decoder object
+    int         enabled  ///< Non-zero to enable stepped solving
+);
+
+/**
+    wirehair_decode_step()
+
+    Continue a stepped solve for about budgetUsec microseconds.
+
+    The budget may be overrun by a small slice of work.  Gaussian
+    elimination and the dense-row value stages each run as a single slice,
+    which for the largest N can take a few milliseconds.
+
+    Returns Wirehair_InProgress if more steps are needed.
+    Returns Wirehair_Success if wirehair_recover() can now be called.
+    Returns Wirehair_NeedMore if more blocks must be passed to
+    wirehair_decode().
+    Returns other codes on error.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_decode_step(
+    WirehairCodec  codec, ///< Decoder object
+    uint32_t  budgetUsec  ///< Time budget in microseconds
+);
+
+/**
+    wirehair_set_column_cache()
+
+    Let the solver remember which columns each received block touches,
+    using at most maxBytes of extra memory.  The later solver stages then
+    read the lists back instead of regenerating them, which saves integer
+    work that dominates decoding when blocks are small.
+
+    Covering every block takes about 24 bytes per block, so about 1.5 MB
+    for N = 64000.  With a smaller budget the first blocks to arrive are
+    covered and the rest are regenerated as before.  The default is 0,
+    which disables the cache.
+
+    For a decoder, call this before the first wirehair_decode().  The
+    setting is kept when the codec is passed as reuseOpt, so to use it for
+    an encoder, set it on a codec and then recreate the encoder with that
+    codec.
+
+    Returns Wirehair_Success on success.
+    Returns other codes on error.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_set_column_cache(
+    WirehairCodec codec, ///< Encoder or decoder object
+    uint32_t   maxBytes  ///< Memory budget in bytes, or 0 to disable
+);
+
+/**
+    wirehair_set_defer_strategy()
+
+    Choose how the solver picks columns to defer to Gaussian elimination
+    (GE) once peeling stalls.  The result is the same either way.  Fewer
+    deferred columns make the GE matrix smaller, which makes solving
+    faster.
+
+    Wirehair_Defer_Inactivation follows RaptorQ inactivation decoding.
+    It usually defers fewer columns, but choosing them takes extra time.
+    It is only likely to decode faster for N in the tens of thousands,
+    so measure before switching: Benchmark_DeferStrategy() in the unit
+    test times both on the same block streams.
+    The default is Wirehair_Defer_Weight2.
+
+    The setting is kept when the codec is passed as reuseOpt, so to use it
+    for an encoder, set it on a codec and then recreate the encoder with
+    that codec.
+
+    Returns Wirehair_Success on success.
+    Returns other codes on error.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_set_defer_strategy(
+    WirehairCodec            codec, ///< Encoder or decoder object
+    WirehairDeferStrategy strategy  ///< Strategy to use
+);
+
 /**
     wirehair_recover()
 
@@ -259,6 +712,49 @@ WIREHAIR_EXPORT WirehairResult wirehair_recover(
     uint64_t  messageBytes  ///< Bytes in the message
 );
 
+/**
+    wirehair_recover_crc()
+
+    Same as wirehair_recover(), and also writes the CRC32C of each block of
+    the recovered message to blockCrcsOut[0 .. N-1].  Each checksum is
+    computed while its block is written, so the application can compare
+    them with checksums from the sender without reading the message again.
+
+    Preconditions:
+    blockCrcsOut has room for N values
+
+    Returns Wirehair_Success if the message was recovered.
+    Returns other codes on error.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_recover_crc(
+    WirehairCodec    codec, ///< Codec object
+    void*       messageOut, ///< Buffer where reconstructed message will be written
+    uint64_t  messageBytes, ///< Bytes in the message
+    uint32_t* blockCrcsOut  ///< Set to the CRC32C of each block
+);
+
+/**
+    wirehair_recover_segments()
+
+    Same as wirehair_recover(), but the message is written across a list of
+    output segments, for example pages or a registered I/O buffer list.
+
+    Blocks that lie inside one segment are written in place, and blocks
+    that straddle segments are staged in a temporary buffer, so at most
+    segmentCount - 1 blocks are copied.
+
+    Preconditions:
+    The segments add up to exactly the size of the message
+
+    Returns Wirehair_Success if the message was recovered.
+    Returns other codes on error.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_recover_segments(
+    WirehairCodec                    codec, ///< Codec object
+    const WirehairOutputSegment* segments, ///< Pointer to each output segment
+    unsigned                  segmentCount  ///< Number of segments
+);
+
 /**
     wirehair_recover_block()
 
@@ -304,6 +800,47 @@ WIREHAIR_EXPORT WirehairResult wirehair_decoder_becomes_encoder(
     WirehairCodec codec ///< Codec to change
 );
 
+/**
+    wirehair_decoder_save()
+
+    Write a checkpoint of a decoder that is still receiving blocks, so that
+    a restarted process can continue from it with wirehair_decoder_load()
+    instead of receiving every block again.
+
+    The checkpoint holds the id and data of each block the decoder has
+    stored, with the block data aligned for memory-mapped files.  It uses
+    the native byte order, and is only valid for the same library version.
+
+    Call once with stateOut = nullptr to get the size in stateBytesOut,
+    then again with a buffer of that size.
+
+    Returns Wirehair_Success on success.
+    Returns Wirehair_InvalidInput if the decoder has already received N
+    blocks, or if the buffer is too small.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_decoder_save(
+    WirehairCodec       codec, ///< Decoder to save
+    void*            stateOut, ///< Checkpoint output, or nullptr for the size
+    uint64_t         outBytes, ///< Bytes available at stateOut
+    uint64_t*   stateBytesOut  ///< Set to the checkpoint size in bytes
+);
+
+/**
+    wirehair_decoder_load()
+
+    Create a decoder from a wirehair_decoder_save() checkpoint.  Decoding
+    then continues with wirehair_decode() as if the saved blocks had been
+    passed to it again, without the copies and bookkeeping of doing so.
+
+    Returns a non-zero object pointer on success.
+    Returns nullptr(0) on failure.
+*/
+WIREHAIR_EXPORT WirehairCodec wirehair_decoder_load(
+    WirehairCodec reuseOpt, ///< Codec object to reuse
+    const void*      state, ///< Checkpoint data
+    uint64_t    stateBytes  ///< Bytes of checkpoint data
+);
+
 /**
     wirehair_free()
 
@@ -314,6 +851,424 @@ WIREHAIR_EXPORT void wirehair_free(
 );
 
 
+//------------------------------------------------------------------------------
+// Multi-Threaded Decoder Intake
+
+/// WirehairIntake: From wirehair_intake_create()
+typedef struct WirehairIntake_t { char impl; }* WirehairIntake;
+
+/**
+    wirehair_intake_create()
+
+    Create a lock-free staging ring for a decoder, so that several receive
+    threads can hand blocks to it without a mutex.  Receive threads call
+    wirehair_intake_push(), and a single solver thread calls
+    wirehair_intake_drain() to feed the staged blocks to the decoder.
+
+    While an intake is in use, the application must not call
+    wirehair_decode() on the same decoder directly.
+
+    The capacity is rounded up to a power of two.  A few hundred blocks is
+    usually plenty if the solver thread drains regularly.
+
+    Preconditions:
+        decoder is from wirehair_decoder_create()
+        decoder outlives the intake
+
+    Returns a non-zero object pointer on success.
+    Returns nullptr(0) on failure.
+*/
+WIREHAIR_EXPORT WirehairIntake wirehair_intake_create(
+    WirehairCodec  decoder, ///< Decoder to feed
+    unsigned capacityBlocks ///< Number of blocks that can be staged
+);
+
+/**
+    wirehair_intake_push()
+
+    Stage a received block.  This may be called from any number of threads
+    at the same time.
+
+    Returns Wirehair_Success if the block was staged.
+    Returns Wirehair_WouldBlock if the ring is full.  The application may
+    retry after the solver thread drains, or drop the block.
+    Returns other codes on error.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_intake_push(
+    WirehairIntake  intake, ///< Intake object
+    unsigned       blockId, ///< ID number of received block
+    const void*  blockData, ///< Pointer to block data
+    uint32_t     dataBytes  ///< Number of bytes in the data block
+);
+
+/**
+    wirehair_intake_drain()
+
+    Feed staged blocks to the decoder.  Only one thread may call this.
+
+    Pass 0 for maxBlocks to drain everything that is staged right now.
+    Malformed blocks are dropped.  After the decoder succeeds, any other
+    staged blocks are discarded.
+
+    Returns Wirehair_Success once wirehair_recover() can be called.
+    Returns Wirehair_NeedMore if more blocks are needed.
+    Returns other codes on error.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_intake_drain(
+    WirehairIntake intake, ///< Intake object
+    unsigned    maxBlocks  ///< Maximum blocks to feed, or 0 for all
+);
+
+/**
+    wirehair_intake_free()
+
+    Free memory associated with a WirehairIntake object.
+    No threads may be pushing into it at this point.
+*/
+WIREHAIR_EXPORT void wirehair_intake_free(
+    WirehairIntake intake ///< Intake object to free
+);
+
+
+//------------------------------------------------------------------------------
+// Background Repair-Ahead Encoder
+
+/// WirehairRepairAhead: From wirehair_repair_ahead_start()
+typedef struct WirehairRepairAhead_t { char impl; }* WirehairRepairAhead;
+
+/**
+    wirehair_repair_ahead_start()
+
+    Start a background thread that generates repair blocks from the encoder
+    ahead of time, with consecutive block ids starting at firstBlockId.
+    Ready blocks are kept in a bounded lock-free ring of capacityBlocks,
+    rounded up to a power of two.  Send threads call
+    wirehair_repair_ahead_dequeue() to copy out the next ready block.
+
+    This relies on wirehair_encode() being safe to call concurrently, so the
+    same rules apply: wirehair_encoder_update() must not be called while the
+    repair-ahead thread is running.
+
+    Preconditions:
+        encoder is from wirehair_encoder_create() or
+            wirehair_decoder_becomes_encoder()
+        encoder outlives the repair-ahead object
+
+    Returns a non-zero object pointer on success.
+    Returns nullptr(0) on failure.
+*/
+WIREHAIR_EXPORT WirehairRepairAhead wirehair_repair_ahead_start(
+    WirehairCodec  encoder, ///< Encoder to generate blocks from
+    unsigned  firstBlockId, ///< First block id to generate, usually >= N
+    unsigned capacityBlocks ///< Number of blocks to generate ahead
+);
+
+/**
+    wirehair_repair_ahead_dequeue()
+
+    Copy out the next ready repair block.  This may be called from any
+    number of threads at the same time.  Each block id is handed out once.
+
+    Preconditions:
+        outBytes >= blockBytes
+
+    Returns Wirehair_Success if a block was written.
+    Returns Wirehair_WouldBlock if the background thread has not produced
+    another block yet.  wirehair_encode() may be used as a fallback.
+    Returns other codes on error.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_repair_ahead_dequeue(
+    WirehairRepairAhead ahead, ///< Repair-ahead object
+    void*        blockDataOut, ///< Pointer to output block data
+    uint32_t         outBytes, ///< Bytes in the output buffer
+    unsigned*      blockIdOut, ///< Identifier of the block written
+    uint32_t*    dataBytesOut  ///< Number of bytes written <= blockBytes
+);
+
+/**
+    wirehair_repair_ahead_stop()
+
+    Stop the background thread and free the repair-ahead object.
+    No threads may be dequeuing from it at this point.
+*/
+WIREHAIR_EXPORT void wirehair_repair_ahead_stop(
+    WirehairRepairAhead ahead ///< Repair-ahead object to stop
+);
+
+
+//------------------------------------------------------------------------------
+// Asynchronous Jobs
+
+/// WirehairJob: From the *_async() functions
+typedef struct WirehairJob_t { char impl; }* WirehairJob;
+
+/// Completion callback for the *_async() functions
+typedef void (*WirehairCallback)(
+    void*         context, ///< Application context from the *_async() call
+    WirehairResult result, ///< Result of the operation
+    WirehairCodec   codec  ///< Codec the operation ran on, or nullptr
+);
+
+/*
+    The *_async() functions queue the matching synchronous function on a
+    work-stealing thread pool owned by the library, with one worker per
+    hardware thread.  The pool is started by the first call.
+
+    Each call completes through the callback, through a job handle, or both:
+
+    + If jobOut is not null, a WirehairJob is written to it.  The application
+      can use wirehair_job_poll() or wirehair_job_wait() to get the result,
+      and must call wirehair_job_free() when done with it.
+    + If callback is not null, it is called on a worker thread when the work
+      completes.  It may queue more *_async() work, but must not wait for or
+      free its own job.  If jobOut is null, the job is freed automatically.
+
+    At least one of callback or jobOut must be provided.
+
+    Jobs for the same codec are run one at a time, in the order they were
+    queued.  A job's callback returns before the next job for its codec
+    starts, so callbacks for one codec do not overlap.  Jobs waiting for a codec do not hold up a worker thread, so
+    jobs for different codecs run in parallel.  While a codec has jobs
+    queued, the application must not call synchronous functions on it.
+
+    Each returns Wirehair_Success if the work was queued.
+    Returns other codes on error, in which case no callback will be made.
+*/
+
+/**
+    wirehair_encoder_create_async()
+
+    Queue wirehair_encoder_create().  The message buffer must stay valid
+    until the job completes.  The new encoder is passed to the callback and
+    is returned by wirehair_job_codec(), or is nullptr on failure.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_encoder_create_async(
+    WirehairCodec   reuseOpt, ///< [Optional] Pointer to prior codec object
+    const void*      message, ///< Pointer to message
+    uint64_t    messageBytes, ///< Bytes in the message
+    uint32_t      blockBytes, ///< Bytes in an output block
+    WirehairCallback callback, ///< [Optional] Completion callback
+    void*            context, ///< [Optional] Context for the callback
+    WirehairJob*      jobOut  ///< [Optional] Set to the job handle
+);
+
+/**
+    wirehair_decode_async()
+
+    Queue wirehair_decode().  The block buffer must stay valid until the
+    job completes.  It is not copied, so a receive buffer can be handed
+    over without an allocation for each block.  After one job completes with
+    Wirehair_Success, any remaining queued blocks also complete with
+    Wirehair_Success without doing any work.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_decode_async(
+    WirehairCodec      codec, ///< Decoder object
+    unsigned         blockId, ///< ID number of received block
+    const void*    blockData, ///< Pointer to block data
+    uint32_t       dataBytes, ///< Number of bytes in the data block
+    WirehairCallback callback, ///< [Optional] Completion callback
+    void*            context, ///< [Optional] Context for the callback
+    WirehairJob*      jobOut  ///< [Optional] Set to the job handle
+);
+
+/**
+    wirehair_recover_async()
+
+    Queue wirehair_recover().  The output buffer must stay valid until the
+    job completes.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_recover_async(
+    WirehairCodec      codec, ///< Decoder object
+    void*         messageOut, ///< Buffer where reconstructed message will be written
+    uint64_t    messageBytes, ///< Bytes in the message
+    WirehairCallback callback, ///< [Optional] Completion callback
+    void*            context, ///< [Optional] Context for the callback
+    WirehairJob*      jobOut  ///< [Optional] Set to the job handle
+);
+
+/**
+    wirehair_job_poll()
+
+    Returns Wirehair_InProgress if the job has not completed yet.
+    Otherwise returns the result of the queued function.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_job_poll(
+    WirehairJob job ///< Job handle
+);
+
+/**
+    wirehair_job_wait()
+
+    Block until the job completes.  Must not be called from a job callback.
+
+    Returns the result of the queued function.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_job_wait(
+    WirehairJob job ///< Job handle
+);
+
+/**
+    wirehair_job_codec()
+
+    Returns the codec the job ran on once it has completed, which for
+    wirehair_encoder_create_async() is the new encoder.
+    Returns nullptr(0) if the job has not completed or creation failed.
+*/
+WIREHAIR_EXPORT WirehairCodec wirehair_job_codec(
+    WirehairJob job ///< Job handle
+);
+
+/**
+    wirehair_job_free()
+
+    Wait for the job to complete and then free the handle.
+    This does not free the codec.
+*/
+WIREHAIR_EXPORT void wirehair_job_free(
+    WirehairJob job ///< Job handle to free
+);
+
+
+
+//------------------------------------------------------------------------------
+// Multi-Message Decoder Sessions
+
+/// WirehairSessionTable: From wirehair_session_table_create()
+typedef struct WirehairSessionTable_t { char impl; }* WirehairSessionTable;
+
+/// Counters from wirehair_session_table_stats()
+typedef struct WirehairSessionStats_t
+{
+    /// Sessions still waiting for blocks
+    uint32_t ActiveSessions;
+
+    /// Sessions ready for wirehair_session_recover()
+    uint32_t CompleteSessions;
+
+    /// Decoders kept for reuse by new sessions
+    uint32_t PooledDecoders;
+
+    /// Incomplete sessions evicted for idling or to stay within budget
+    uint64_t EvictedSessions;
+
+    /// Bytes held by all decoders, including pooled ones
+    uint64_t MemoryBytes;
+} WirehairSessionStats;
+
+/**
+    wirehair_session_table_create()
+
+    Create a table of decoders for receiving many messages at once, keyed
+    by a 64-bit message id chosen by the application.
+
+    Decoders for finished messages are recycled for new ones, keeping their
+    allocations, so a receiver in steady state does not allocate memory.
+    When the decoders hold more than memoryBudgetBytes, pooled decoders are
+    freed first and then the incomplete sessions that were fed least
+    recently are evicted.  Incomplete sessions that receive no blocks for
+    idleTimeoutMsec are evicted as well.  Pass 0 to disable either limit.
+
+    The table is not thread-safe: Calls on the same table must not overlap.
+
+    Returns a non-zero object pointer on success.
+    Returns nullptr(0) on failure.
+*/
+WIREHAIR_EXPORT WirehairSessionTable wirehair_session_table_create(
+    uint64_t memoryBudgetBytes, ///< Bytes all decoders may hold, or 0
+    uint32_t   idleTimeoutMsec  ///< Idle time before eviction, or 0
+);
+
+/**
+    wirehair_session_decode()
+
+    Feed a block to the decoder for messageId, creating a session for the
+    message when its first block arrives.  Blocks for a complete session
+    are ignored.
+
+    Returns Wirehair_Success once the message can be recovered.
+    + Use wirehair_session_recover() and then wirehair_session_remove().
+    Returns Wirehair_NeedMore if more data is needed to decode.
+    Returns Wirehair_OOM if the session does not fit in the memory budget.
+    Returns Wirehair_InvalidInput if the block is malformed, or if the
+    sizes do not match earlier blocks for the message.
+    Returns other codes if decoding failed, after removing the session.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_session_decode(
+    WirehairSessionTable table, ///< Session table
+    uint64_t         messageId, ///< Message the block belongs to
+    uint64_t      messageBytes, ///< Bytes in the message
+    uint32_t        blockBytes, ///< Bytes in each encoded block
+    unsigned           blockId, ///< ID number of received block
+    const void*      blockData, ///< Pointer to block data
+    uint32_t         dataBytes  ///< Number of bytes in the data block
+);
+
+/**
+    wirehair_session_recover()
+
+    Reconstruct the message for a session after wirehair_session_decode()
+    returned Wirehair_Success.  The session is kept until it is removed.
+
+    Returns Wirehair_Success if the message was recovered.
+    Returns Wirehair_InvalidInput if the session is unknown or incomplete.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_session_recover(
+    WirehairSessionTable table, ///< Session table
+    uint64_t         messageId, ///< Message to recover
+    void*           messageOut, ///< Buffer where reconstructed message will be written
+    uint64_t      messageBytes  ///< Bytes in the message
+);
+
+/**
+    wirehair_session_remove()
+
+    Remove a session and keep its decoder for reuse.  A block that arrives
+    for the message later starts a new session.
+
+    Returns Wirehair_Success if the session was removed.
+    Returns Wirehair_InvalidInput if the session is unknown.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_session_remove(
+    WirehairSessionTable table, ///< Session table
+    uint64_t         messageId  ///< Message to remove
+);
+
+/**
+    wirehair_session_expire()
+
+    Evict incomplete sessions that have been idle for the timeout.  This is
+    also done on each wirehair_session_decode(), so it only needs to be
+    called when blocks stop arriving.
+
+    Returns the number of sessions evicted.
+*/
+WIREHAIR_EXPORT unsigned wirehair_session_expire(
+    WirehairSessionTable table ///< Session table
+);
+
+/**
+    wirehair_session_table_stats()
+
+    Read the session counters and memory use.
+
+    Returns Wirehair_Success on success.
+    Returns other codes on error.
+*/
+WIREHAIR_EXPORT WirehairResult wirehair_session_table_stats(
+    WirehairSessionTable   table, ///< Session table
+    WirehairSessionStats* statsOut  ///< Set to the current counters
+);
+
+/**
+    wirehair_session_table_free()
+
+    Free the table and all of its decoders.
+*/
+WIREHAIR_EXPORT void wirehair_session_table_free(
+    WirehairSessionTable table ///< Session table to free
+);
+
+
 #ifdef __cplusplus
 }
 #endif
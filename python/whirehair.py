@@ -58,7 +58,16 @@ Wirehair_OOM = 9
 # Platform is not supported yet
 Wirehair_UnsupportedPlatform = 10
 
-WirehairResult_Count = 11  # /* for asserts */
+# The operation would have to wait (for example a queue is full)
+Wirehair_WouldBlock = 11
+
+# Solving has started but is not finished: Call wirehair_decode_step()
+Wirehair_InProgress = 12
+
+# The block data does not match the CRC32C passed with it
+Wirehair_BadChecksum = 13
+
+WirehairResult_Count = 14  # /* for asserts */
 
 WirehairResult_Padding = 0x7fffffff  # /* int32_t padding */
 
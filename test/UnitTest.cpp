@@ -4,7 +4,12 @@
 
 #include <iostream>
 #include <vector>
+#include <algorithm>
 #include <atomic>
+#include <thread>
+#include <memory>
+#include <cmath>
+#include <chrono>
 using namespace std;
 
 #define ENABLE_OMP
@@ -519,6 +524,79 @@ static bool Test_DecodeRandomLosses(
     return true;
 }
 
+// Verify that updating a few message blocks matches encoding the new message
+static bool Test_EncoderUpdate(
+    siamese::PCGRandom& prng,
+    unsigned N,
+    unsigned blockBytes,
+    unsigned finalBytes,
+    const uint8_t* message,
+    unsigned messageBytes)
+{
+    vector<uint8_t> updatedMessage(message, message + messageBytes);
+    vector<uint8_t> newBlock(blockBytes);
+    vector<uint8_t> expected(blockBytes), actual(blockBytes);
+
+    WirehairCodec encoder = wirehair_encoder_create(nullptr, &updatedMessage[0], messageBytes, blockBytes);
+    if (!encoder)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Failed to create encoder for N = " << N << ", blockBytes = " << blockBytes << endl;
+        return false;
+    }
+
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        // Always exercise the final partial block once
+        const unsigned blockId = (i == 0) ? (N - 1) : (prng.Next() % N);
+        const unsigned bytes = (blockId == N - 1) ? finalBytes : blockBytes;
+
+        FillMessage(&newBlock[0], bytes, prng);
+
+        WirehairResult updateResult = wirehair_encoder_update(encoder, blockId, &newBlock[0], bytes);
+        if (updateResult != Wirehair_Success)
+        {
+            SIAMESE_DEBUG_BREAK();
+            cout << "!!! wirehair_encoder_update failed for N = " << N << ", blockId = " << blockId << endl;
+            wirehair_free(encoder);
+            return false;
+        }
+
+        memcpy(&updatedMessage[0] + blockId * blockBytes, &newBlock[0], bytes);
+    }
+
+    WirehairCodec reference = wirehair_encoder_create(nullptr, &updatedMessage[0], messageBytes, blockBytes);
+    if (!reference)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Failed to create reference encoder for N = " << N << ", blockBytes = " << blockBytes << endl;
+        wirehair_free(encoder);
+        return false;
+    }
+
+    bool success = true;
+
+    for (unsigned blockId = N; blockId < N * 2 + 2; ++blockId)
+    {
+        uint32_t expectedBytes = 0, actualBytes = 0;
+        wirehair_encode(reference, blockId, &expected[0], blockBytes, &expectedBytes);
+        wirehair_encode(encoder, blockId, &actual[0], blockBytes, &actualBytes);
+
+        if (expectedBytes != actualBytes || 0 != memcmp(&expected[0], &actual[0], actualBytes))
+        {
+            SIAMESE_DEBUG_BREAK();
+            cout << "!!! Updated encoder output mismatch for N = " << N << ", blockId = " << blockId << endl;
+            success = false;
+            break;
+        }
+    }
+
+    wirehair_free(reference);
+    wirehair_free(encoder);
+
+    return success;
+}
+
 static atomic<bool> TestFailed(false);
 
 static void TestN(uint64_t seed, int N, unsigned blockBytes)
@@ -562,6 +640,14 @@ static void TestN(uint64_t seed, int N, unsigned blockBytes)
         return;
     }
 
+    if (!Test_EncoderUpdate(prng, N, blockBytes, finalBytes, &message[0], messageBytes))
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Test_EncoderUpdate failed" << endl;
+        TestFailed = true;
+        return;
+    }
+
     // Decoder checks:
 
     if (!Test_DecodeAllOriginal(N, blockBytes, finalBytes, &message[0], decodedMessagePtr, messageBytes))
@@ -862,6 +948,286 @@ static bool Benchmark(unsigned N, unsigned packetBytes, unsigned trials)
     return true;
 }
 
+// Verify that many threads can encode from one shared encoder at once
+static bool Test_ConcurrentEncode(unsigned N, unsigned blockBytes, unsigned threadCount, unsigned blocksPerThread)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(N, blockBytes);
+
+    const unsigned messageBytes = N * blockBytes;
+    const unsigned blockCount = threadCount * blocksPerThread;
+
+    vector<uint8_t> message(messageBytes);
+    FillMessage(&message[0], messageBytes, prng);
+
+    WirehairCodec encoder = wirehair_encoder_create(nullptr, &message[0], messageBytes, blockBytes);
+    if (!encoder)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Failed to create encoder" << endl;
+        return false;
+    }
+
+    // Generate expected output on one thread, starting a few blocks before N
+    // so that original blocks are also read concurrently
+    const unsigned firstBlockId = N - (N < 4 ? N : 4);
+    vector<uint8_t> expected(blockCount * blockBytes);
+
+    const uint64_t t0 = siamese::GetTimeUsec();
+
+    for (unsigned i = 0; i < blockCount; ++i)
+    {
+        uint32_t writeLen = 0;
+        WirehairResult encodeResult = wirehair_encode(encoder, firstBlockId + i, &expected[i * blockBytes], blockBytes, &writeLen);
+        if (encodeResult != Wirehair_Success)
+        {
+            SIAMESE_DEBUG_BREAK();
+            cout << "!!! wirehair_encode failed" << endl;
+            wirehair_free(encoder);
+            return false;
+        }
+    }
+
+    const uint64_t t1 = siamese::GetTimeUsec();
+
+    atomic<bool> failed(false);
+    vector<thread> threads;
+
+    for (unsigned t = 0; t < threadCount; ++t)
+    {
+        threads.push_back(thread([&, t]() {
+            vector<uint8_t> block(blockBytes);
+
+            // Each thread takes every threadCount'th block id, like a sender per peer
+            for (unsigned i = t; i < blockCount; i += threadCount)
+            {
+                uint32_t writeLen = 0;
+                WirehairResult encodeResult = wirehair_encode(encoder, firstBlockId + i, &block[0], blockBytes, &writeLen);
+                if (encodeResult != Wirehair_Success ||
+                    0 != memcmp(&block[0], &expected[i * blockBytes], writeLen))
+                {
+                    failed = true;
+                    return;
+                }
+            }
+        }));
+    }
+
+    for (auto& th : threads) {
+        th.join();
+    }
+
+    const uint64_t t2 = siamese::GetTimeUsec();
+
+    wirehair_free(encoder);
+
+    if (failed)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Concurrent wirehair_encode produced wrong data for N = " << N << endl;
+        return false;
+    }
+
+    float single_MBPS = 0.f, multi_MBPS = 0.f;
+    if (t1 > t0) {
+        single_MBPS = (blockCount * (uint64_t)blockBytes) / (float)(t1 - t0);
+    }
+    if (t2 > t1) {
+        multi_MBPS = (blockCount * (uint64_t)blockBytes) / (float)(t2 - t1);
+    }
+
+    cout << "Concurrent encode for N = " << N << " packets of " << blockBytes << " bytes:" << endl;
+    cout << "+ 1 thread: " << single_MBPS << " MBPS, " << threadCount << " threads: " << multi_MBPS << " MBPS" << endl;
+
+    return true;
+}
+
+// Verify that several receive threads can feed one decoder through an intake
+static bool Test_DecoderIntake(unsigned N, unsigned blockBytes, unsigned threadCount)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(N, blockBytes);
+
+    const unsigned finalBytes = blockBytes == 1 ? 1 : (blockBytes - 1);
+    const unsigned messageBytes = blockBytes * (N - 1) + finalBytes;
+
+    vector<uint8_t> message(messageBytes);
+    vector<uint8_t> decoded(messageBytes);
+    FillMessage(&message[0], messageBytes, prng);
+
+    WirehairCodec encoder = wirehair_encoder_create(nullptr, &message[0], messageBytes, blockBytes);
+    WirehairCodec decoder = wirehair_decoder_create(nullptr, messageBytes, blockBytes);
+    WirehairIntake intake = wirehair_intake_create(decoder, 64);
+    if (!encoder || !decoder || !intake)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Failed to create encoder/decoder/intake" << endl;
+        return false;
+    }
+
+    atomic<bool> done(false);
+    atomic<bool> failed(false);
+    vector<thread> threads;
+
+    for (unsigned t = 0; t < threadCount; ++t)
+    {
+        threads.push_back(thread([&, t]() {
+            vector<uint8_t> block(blockBytes);
+            siamese::PCGRandom lossPrng;
+            lossPrng.Seed(t, N);
+
+            // Each receive thread sees every threadCount'th block id
+            for (unsigned blockId = t; !done; blockId += threadCount)
+            {
+                // Introduce about 20% loss
+                if (lossPrng.Next() % 100 < 20) {
+                    continue;
+                }
+
+                uint32_t writeLen = 0;
+                if (wirehair_encode(encoder, blockId, &block[0], blockBytes, &writeLen) != Wirehair_Success)
+                {
+                    failed = true;
+                    return;
+                }
+
+                WirehairResult pushResult;
+                while ((pushResult = wirehair_intake_push(intake, blockId, &block[0], writeLen)) == Wirehair_WouldBlock && !done) {
+                    std::this_thread::yield();
+                }
+
+                if (pushResult != Wirehair_Success && pushResult != Wirehair_WouldBlock)
+                {
+                    failed = true;
+                    return;
+                }
+            }
+        }));
+    }
+
+    WirehairResult drainResult;
+    while ((drainResult = wirehair_intake_drain(intake, 16)) == Wirehair_NeedMore && !failed) {
+        std::this_thread::yield();
+    }
+
+    done = true;
+    for (auto& th : threads) {
+        th.join();
+    }
+
+    bool success = !failed && drainResult == Wirehair_Success;
+
+    if (success)
+    {
+        success = wirehair_recover(decoder, &decoded[0], messageBytes) == Wirehair_Success &&
+            0 == memcmp(&decoded[0], &message[0], messageBytes);
+    }
+
+    wirehair_intake_free(intake);
+    wirehair_free(decoder);
+    wirehair_free(encoder);
+
+    if (!success)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Decoder intake failed for N = " << N << ", blockBytes = " << blockBytes << endl;
+        return false;
+    }
+
+    return true;
+}
+
+// Verify that send threads receive each repair-ahead block once with the right data
+static bool Test_RepairAhead(unsigned N, unsigned blockBytes, unsigned threadCount, unsigned blocksPerThread)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(N, blockBytes);
+
+    const unsigned messageBytes = N * blockBytes;
+    const unsigned blockCount = threadCount * blocksPerThread;
+
+    vector<uint8_t> message(messageBytes);
+    FillMessage(&message[0], messageBytes, prng);
+
+    WirehairCodec encoder = wirehair_encoder_create(nullptr, &message[0], messageBytes, blockBytes);
+    if (!encoder)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Failed to create encoder" << endl;
+        return false;
+    }
+
+    WirehairRepairAhead ahead = wirehair_repair_ahead_start(encoder, N, 32);
+    if (!ahead)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Failed to start repair-ahead" << endl;
+        wirehair_free(encoder);
+        return false;
+    }
+
+    vector<atomic<unsigned>> seen(blockCount);
+    for (auto& count : seen) {
+        count = 0;
+    }
+    atomic<bool> failed(false);
+    vector<thread> threads;
+
+    for (unsigned t = 0; t < threadCount; ++t)
+    {
+        threads.push_back(thread([&]() {
+            vector<uint8_t> block(blockBytes), expected(blockBytes);
+
+            for (unsigned i = 0; i < blocksPerThread && !failed; )
+            {
+                unsigned blockId = 0;
+                uint32_t writeLen = 0;
+                WirehairResult result = wirehair_repair_ahead_dequeue(ahead, &block[0], blockBytes, &blockId, &writeLen);
+                if (result == Wirehair_WouldBlock) {
+                    std::this_thread::yield();
+                    continue;
+                }
+
+                uint32_t expectedLen = 0;
+                if (result != Wirehair_Success ||
+                    blockId < N || blockId >= N + blockCount ||
+                    wirehair_encode(encoder, blockId, &expected[0], blockBytes, &expectedLen) != Wirehair_Success ||
+                    expectedLen != writeLen ||
+                    0 != memcmp(&block[0], &expected[0], writeLen))
+                {
+                    failed = true;
+                    return;
+                }
+
+                ++seen[blockId - N];
+                ++i;
+            }
+        }));
+    }
+
+    for (auto& th : threads) {
+        th.join();
+    }
+
+    wirehair_repair_ahead_stop(ahead);
+    wirehair_free(encoder);
+
+    for (auto& count : seen) {
+        if (count != 1) {
+            failed = true;
+        }
+    }
+
+    if (failed)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Repair-ahead produced wrong blocks for N = " << N << ", blockBytes = " << blockBytes << endl;
+        return false;
+    }
+
+    return true;
+}
+
 static const unsigned kBenchmarkNList[] = {
     12,
     32,
@@ -876,43 +1242,2195 @@ static const unsigned kBenchmarkNList[] = {
     1000
 };
 
-int main()
+// Verify that a stepped decode produces the same message as a normal decode
+static bool Test_SteppedDecode(unsigned N, unsigned blockBytes, unsigned budgetUsec)
 {
-    const WirehairResult initResult = wirehair_init();
+    siamese::PCGRandom prng;
+    prng.Seed(N, blockBytes);
 
-    if (initResult != Wirehair_Success)
-    {
-        SIAMESE_DEBUG_BREAK();
-        cout << "!!! Wirehair initialization failed: " << initResult << endl;
-        return -1;
-    }
+    const unsigned finalBytes = blockBytes == 1 ? 1 : (blockBytes - 1);
+    const unsigned messageBytes = blockBytes * (N - 1) + finalBytes;
 
-    if (!ReadmeExample())
+    vector<uint8_t> message(messageBytes);
+    vector<uint8_t> decoded(messageBytes);
+    vector<uint8_t> block(blockBytes);
+    FillMessage(&message[0], messageBytes, prng);
+
+    WirehairCodec encoder = wirehair_encoder_create(nullptr, &message[0], messageBytes, blockBytes);
+    WirehairCodec decoder = wirehair_decoder_create(nullptr, messageBytes, blockBytes);
+    if (!encoder || !decoder ||
+        wirehair_decoder_set_stepped(decoder, 1) != Wirehair_Success)
     {
         SIAMESE_DEBUG_BREAK();
-        cout << "!!! Example usage failed" << endl;
-        return -2;
+        cout << "!!! Failed to create encoder/decoder" << endl;
+        return false;
     }
 
-#ifdef BENCHMARK_SHORT_LIST
-    for (unsigned i = 0; i < sizeof(kBenchmarkNList) / sizeof(kBenchmarkNList[0]); ++i)
-    {
-        const unsigned N = kBenchmarkNList[i];
-#else
-    for (unsigned N = 2; N < 64000; N *= 2)
+    WirehairResult result = Wirehair_NeedMore;
+    unsigned steps = 0;
+
+    for (unsigned blockId = 0; result == Wirehair_NeedMore && blockId < N * 2; ++blockId)
     {
-#endif
-        const unsigned kPacketBytes = 1300;
-        const unsigned kBenchTrials = 2000;
+        // Introduce about 10% loss
+        if (prng.Next() % 100 < 10) {
+            continue;
+        }
 
-        if (!Benchmark(N, kPacketBytes, kBenchTrials))
+        uint32_t writeLen = 0;
+        if (wirehair_encode(encoder, blockId, &block[0], blockBytes, &writeLen) != Wirehair_Success) {
+            result = Wirehair_Error;
+            break;
+        }
+
+        result = wirehair_decode(decoder, blockId, &block[0], writeLen);
+
+        while (result == Wirehair_InProgress)
         {
-            SIAMESE_DEBUG_BREAK();
-            cout << "!!! Benchmark failed" << endl;
-            return -3;
+            // Blocks arriving mid-solve should be turned away
+            if (steps == 1 &&
+                wirehair_decode(decoder, blockId, &block[0], writeLen) != Wirehair_InProgress)
+            {
+                result = Wirehair_Error;
+                break;
+            }
+
+            result = wirehair_decode_step(decoder, budgetUsec);
+            ++steps;
         }
     }
 
+    bool success = result == Wirehair_Success &&
+        wirehair_recover(decoder, &decoded[0], messageBytes) == Wirehair_Success &&
+        0 == memcmp(&decoded[0], &message[0], messageBytes);
+
+    wirehair_free(decoder);
+    wirehair_free(encoder);
+
+    if (!success)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Stepped decode failed for N = " << N << ", blockBytes = " << blockBytes << endl;
+        return false;
+    }
+
+    return true;
+}
+
+// Verify that blocks arriving during a stepped solve are used if it needs more
+static bool Test_SteppedPendingBlocks(unsigned N, unsigned blockBytes, unsigned trials)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(N, blockBytes);
+
+    const unsigned messageBytes = blockBytes * N;
+
+    vector<uint8_t> message(messageBytes);
+    vector<uint8_t> decoded(messageBytes);
+    vector<uint8_t> block(blockBytes);
+    FillMessage(&message[0], messageBytes, prng);
+
+    WirehairCodec encoder = wirehair_encoder_create(nullptr, &message[0], messageBytes, blockBytes);
+    if (!encoder) {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Failed to create encoder" << endl;
+        return false;
+    }
+
+    bool success = true;
+    unsigned failedSolves = 0;
+
+    for (unsigned trial = 0; success && trial < trials; ++trial)
+    {
+        // Use recovery blocks only, so that some sets of N are not enough
+        const unsigned firstId = N + trial * N * 2;
+
+        WirehairCodec decoder = wirehair_decoder_create(nullptr, messageBytes, blockBytes);
+        if (!decoder) {
+            success = false;
+            break;
+        }
+
+        WirehairResult result = Wirehair_NeedMore;
+        for (unsigned i = 0; i < N && result == Wirehair_NeedMore; ++i)
+        {
+            uint32_t writeLen = 0;
+            wirehair_encode(encoder, firstId + i, &block[0], blockBytes, &writeLen);
+            result = wirehair_decode(decoder, firstId + i, &block[0], writeLen);
+        }
+
+        wirehair_free(decoder);
+
+        // Only the sets of N blocks that are not enough are interesting
+        if (result != Wirehair_NeedMore) {
+            continue;
+        }
+        ++failedSolves;
+
+        decoder = wirehair_decoder_create(nullptr, messageBytes, blockBytes);
+        if (!decoder ||
+            wirehair_decoder_set_stepped(decoder, 1) != Wirehair_Success)
+        {
+            wirehair_free(decoder);
+            success = false;
+            break;
+        }
+
+        for (unsigned i = 0; i < N; ++i)
+        {
+            uint32_t writeLen = 0;
+            wirehair_encode(encoder, firstId + i, &block[0], blockBytes, &writeLen);
+            result = wirehair_decode(decoder, firstId + i, &block[0], writeLen);
+        }
+
+        // Fill the pending queue while the solve has not started yet
+        unsigned nextId = firstId + N;
+        for (;;)
+        {
+            uint32_t writeLen = 0;
+            wirehair_encode(encoder, nextId, &block[0], blockBytes, &writeLen);
+            const WirehairResult queued = wirehair_decode(decoder, nextId, &block[0], writeLen);
+            if (queued == Wirehair_WouldBlock) {
+                break;
+            }
+            if (queued != Wirehair_InProgress || nextId - firstId > N * 2) {
+                result = Wirehair_Error;
+                break;
+            }
+            ++nextId;
+        }
+
+        // The queued blocks should finish the solve without more input
+        while (result == Wirehair_InProgress) {
+            result = wirehair_decode_step(decoder, 1000);
+        }
+
+        success = result == Wirehair_Success &&
+            wirehair_recover(decoder, &decoded[0], messageBytes) == Wirehair_Success &&
+            0 == memcmp(&decoded[0], &message[0], messageBytes);
+
+        wirehair_free(decoder);
+    }
+
+    wirehair_free(encoder);
+
+    // If no trial exercised the queue, the test did not test anything
+    if (!success || failedSolves == 0)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Stepped pending block test failed for N = " << N << ", blockBytes = " << blockBytes << ", failed solves = " << failedSolves << endl;
+        return false;
+    }
+
+    return true;
+}
+
+// Completion state for one message in Test_AsyncJobs()
+struct AsyncDecodeState
+{
+    std::atomic<unsigned> Completed;
+    std::atomic<bool> Decoded;
+    std::atomic<bool> Failed;
+};
+
+static void OnAsyncDecode(void* context, WirehairResult result, WirehairCodec /*codec*/)
+{
+    AsyncDecodeState* state = reinterpret_cast<AsyncDecodeState*>(context);
+
+    if (result == Wirehair_Success) {
+        state->Decoded = true;
+    }
+    else if (result != Wirehair_NeedMore) {
+        state->Failed = true;
+    }
+
+    ++state->Completed;
+}
+
+// Verify that many messages of mixed sizes can be encoded and decoded through the job pool
+static bool Test_AsyncJobs(unsigned messageCount, unsigned blockBytes)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(messageCount, blockBytes);
+
+    vector<vector<uint8_t>> messages(messageCount);
+    vector<vector<uint8_t>> decoded(messageCount);
+    vector<WirehairJob> jobs(messageCount);
+    vector<WirehairCodec> encoders(messageCount);
+    vector<WirehairCodec> decoders(messageCount);
+    std::unique_ptr<AsyncDecodeState[]> states(new AsyncDecodeState[messageCount]);
+    vector<unsigned> submitted(messageCount);
+    bool success = true;
+
+    for (unsigned i = 0; i < messageCount; ++i)
+    {
+        const unsigned N = 2 + prng.Next() % 2000;
+        messages[i].resize(blockBytes * (N - 1) + 1 + prng.Next() % blockBytes);
+        decoded[i].resize(messages[i].size());
+        FillMessage(&messages[i][0], (unsigned)messages[i].size(), prng);
+
+        states[i].Completed = 0;
+        states[i].Decoded = false;
+        states[i].Failed = false;
+
+        if (wirehair_encoder_create_async(nullptr, &messages[i][0], messages[i].size(), blockBytes, nullptr, nullptr, &jobs[i]) != Wirehair_Success) {
+            success = false;
+        }
+    }
+
+    for (unsigned i = 0; i < messageCount; ++i)
+    {
+        if (wirehair_job_wait(jobs[i]) != Wirehair_Success) {
+            success = false;
+        }
+        encoders[i] = wirehair_job_codec(jobs[i]);
+        wirehair_job_free(jobs[i]);
+
+        decoders[i] = wirehair_decoder_create(nullptr, messages[i].size(), blockBytes);
+        if (!encoders[i] || !decoders[i]) {
+            success = false;
+        }
+    }
+
+    // Blocks must stay valid until their decode jobs complete
+    vector<vector<uint8_t>> blocks(messageCount);
+
+    for (unsigned i = 0; success && i < messageCount; ++i)
+    {
+        const unsigned N = (unsigned)((messages[i].size() + blockBytes - 1) / blockBytes);
+        const unsigned blockCount = N + N / 10 + 10;
+
+        blocks[i].resize(blockCount * blockBytes);
+
+        // Lose every 10th original and replace it with a repair block, plus a few more
+        for (unsigned blockId = 0; blockId < blockCount; ++blockId)
+        {
+            if (blockId < N && blockId % 10 == 9) {
+                continue;
+            }
+
+            uint8_t* block = &blocks[i][blockId * blockBytes];
+
+            uint32_t writeLen = 0;
+            if (wirehair_encode(encoders[i], blockId, block, blockBytes, &writeLen) != Wirehair_Success ||
+                wirehair_decode_async(decoders[i], blockId, block, writeLen, OnAsyncDecode, &states[i], nullptr) != Wirehair_Success)
+            {
+                success = false;
+                break;
+            }
+            ++submitted[i];
+        }
+    }
+
+    for (unsigned i = 0; success && i < messageCount; ++i)
+    {
+        while (states[i].Completed < submitted[i]) {
+            std::this_thread::yield();
+        }
+
+        if (!states[i].Decoded || states[i].Failed ||
+            wirehair_recover_async(decoders[i], &decoded[i][0], decoded[i].size(), nullptr, nullptr, &jobs[i]) != Wirehair_Success)
+        {
+            success = false;
+            break;
+        }
+    }
+
+    for (unsigned i = 0; success && i < messageCount; ++i)
+    {
+        if (wirehair_job_wait(jobs[i]) != Wirehair_Success ||
+            decoded[i] != messages[i])
+        {
+            success = false;
+        }
+        wirehair_job_free(jobs[i]);
+    }
+
+    for (unsigned i = 0; i < messageCount; ++i)
+    {
+        wirehair_free(encoders[i]);
+        wirehair_free(decoders[i]);
+    }
+
+    if (!success)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Async jobs failed for " << messageCount << " messages of blockBytes = " << blockBytes << endl;
+        return false;
+    }
+
+    return true;
+}
+
+// Shared by the decode jobs of Test_AsyncCodecOrder()
+struct AsyncOrderState
+{
+    std::atomic<bool> Active;
+    std::atomic<unsigned> Completed;
+    std::atomic<bool> Failed;
+    unsigned Next;
+};
+
+// Context of one decode job in Test_AsyncCodecOrder()
+struct AsyncOrderJob
+{
+    AsyncOrderState* State;
+    unsigned Index;
+};
+
+static void OnAsyncOrderDecode(void* context, WirehairResult result, WirehairCodec /*codec*/)
+{
+    AsyncOrderJob* job = reinterpret_cast<AsyncOrderJob*>(context);
+    AsyncOrderState* state = job->State;
+
+    // If another callback for the same codec is still running:
+    if (state->Active.exchange(true)) {
+        state->Failed = true;
+    }
+
+    if (job->Index != state->Next ||
+        (result != Wirehair_NeedMore && result != Wirehair_Success))
+    {
+        state->Failed = true;
+    }
+    ++state->Next;
+
+    // Give the next job time to run if it was started too early
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+
+    state->Active = false;
+    ++state->Completed;
+}
+
+// Verify that jobs for one codec run in order and their callbacks do not overlap
+static bool Test_AsyncCodecOrder(unsigned N, unsigned blockBytes)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(N, blockBytes);
+
+    const unsigned messageBytes = N * blockBytes;
+    const unsigned blockCount = N + 10;
+
+    vector<uint8_t> message(messageBytes);
+    FillMessage(&message[0], messageBytes, prng);
+
+    WirehairCodec encoder = wirehair_encoder_create(nullptr, &message[0], messageBytes, blockBytes);
+    WirehairCodec decoder = wirehair_decoder_create(nullptr, messageBytes, blockBytes);
+    if (!encoder || !decoder)
+    {
+        wirehair_free(encoder);
+        wirehair_free(decoder);
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Failed to create encoder/decoder" << endl;
+        return false;
+    }
+
+    AsyncOrderState state;
+    state.Active = false;
+    state.Completed = 0;
+    state.Failed = false;
+    state.Next = 0;
+
+    // Blocks and contexts must stay valid until their jobs complete
+    vector<uint8_t> blocks(blockCount * blockBytes);
+    vector<AsyncOrderJob> contexts(blockCount);
+
+    unsigned submitted = 0;
+    for (unsigned blockId = 0; blockId < blockCount; ++blockId)
+    {
+        // Skip a few originals so that repair blocks are needed
+        if (blockId < N && blockId % 7 == 3) {
+            continue;
+        }
+
+        uint8_t* block = &blocks[blockId * blockBytes];
+        contexts[submitted].State = &state;
+        contexts[submitted].Index = submitted;
+
+        uint32_t writeLen = 0;
+        if (wirehair_encode(encoder, blockId, block, blockBytes, &writeLen) != Wirehair_Success ||
+            wirehair_decode_async(decoder, blockId, block, writeLen, OnAsyncOrderDecode, &contexts[submitted], nullptr) != Wirehair_Success)
+        {
+            state.Failed = true;
+            break;
+        }
+        ++submitted;
+    }
+
+    while (state.Completed < submitted) {
+        std::this_thread::yield();
+    }
+
+    const bool success = !state.Failed;
+
+    wirehair_free(encoder);
+    wirehair_free(decoder);
+
+    if (!success)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Async jobs for one codec overlapped or ran out of order for N = " << N << endl;
+        return false;
+    }
+
+    return true;
+}
+
+// Verify that batch encoder creation matches creating each encoder alone
+static bool Test_EncoderCreateMany(unsigned messageCount, unsigned blockBytes, unsigned threadCount)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(messageCount, threadCount);
+
+    vector<vector<uint8_t>> messages(messageCount);
+    vector<const void*> messagePtrs(messageCount);
+    vector<uint64_t> messageBytes(messageCount);
+    vector<WirehairCodec> encoders(messageCount);
+
+    for (unsigned i = 0; i < messageCount; ++i)
+    {
+        // Repeat a few sizes so that some messages share the same N
+        const unsigned N = 2 + (prng.Next() % 8) * 250;
+        messages[i].resize(blockBytes * (N - 1) + 1 + prng.Next() % blockBytes);
+        FillMessage(&messages[i][0], (unsigned)messages[i].size(), prng);
+        messagePtrs[i] = &messages[i][0];
+        messageBytes[i] = messages[i].size();
+    }
+
+    bool success = wirehair_encoder_create_many(&messagePtrs[0], &messageBytes[0], messageCount, blockBytes, &encoders[0], threadCount) == Wirehair_Success;
+
+    vector<uint8_t> expected(blockBytes), actual(blockBytes);
+
+    for (unsigned i = 0; success && i < messageCount; ++i)
+    {
+        WirehairCodec single = wirehair_encoder_create(nullptr, messagePtrs[i], messageBytes[i], blockBytes);
+        const unsigned N = (unsigned)((messageBytes[i] + blockBytes - 1) / blockBytes);
+
+        for (unsigned blockId = N; success && blockId < N + 4; ++blockId)
+        {
+            uint32_t expectedLen = 0, actualLen = 0;
+            success = single && encoders[i] &&
+                wirehair_encode(single, blockId, &expected[0], blockBytes, &expectedLen) == Wirehair_Success &&
+                wirehair_encode(encoders[i], blockId, &actual[0], blockBytes, &actualLen) == Wirehair_Success &&
+                expectedLen == actualLen &&
+                0 == memcmp(&expected[0], &actual[0], expectedLen);
+        }
+
+        wirehair_free(single);
+    }
+
+    for (unsigned i = 0; i < messageCount; ++i) {
+        wirehair_free(encoders[i]);
+    }
+
+    // A bad message should fail alone without losing the others
+    if (success)
+    {
+        messageBytes[0] = 0;
+        success = wirehair_encoder_create_many(&messagePtrs[0], &messageBytes[0], messageCount, blockBytes, &encoders[0], threadCount) == Wirehair_InvalidInput &&
+            encoders[0] == nullptr;
+
+        for (unsigned i = 1; i < messageCount; ++i)
+        {
+            if (!encoders[i]) {
+                success = false;
+            }
+            wirehair_free(encoders[i]);
+        }
+    }
+
+    if (!success)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Encoder create many failed for " << messageCount << " messages with " << threadCount << " threads" << endl;
+        return false;
+    }
+
+    return true;
+}
+
+// Verify that decoding with the column cache matches decoding without it
+static bool Test_ColumnCache(unsigned N, unsigned blockBytes, uint32_t cacheBytes)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(N, cacheBytes);
+
+    const unsigned messageBytes = blockBytes * N - blockBytes / 2;
+
+    vector<uint8_t> message(messageBytes);
+    vector<uint8_t> decoded(messageBytes);
+    vector<uint8_t> expected(blockBytes), actual(blockBytes);
+    FillMessage(&message[0], messageBytes, prng);
+
+    WirehairCodec encoder = wirehair_encoder_create(nullptr, &message[0], messageBytes, blockBytes);
+
+    // The setting survives reuse, so set it on a codec and recreate from it
+    WirehairCodec cachedEncoder = wirehair_decoder_create(nullptr, messageBytes, blockBytes);
+    bool success = encoder && cachedEncoder &&
+        wirehair_set_column_cache(cachedEncoder, cacheBytes) == Wirehair_Success;
+    if (success) {
+        cachedEncoder = wirehair_encoder_create(cachedEncoder, &message[0], messageBytes, blockBytes);
+        success = cachedEncoder != nullptr;
+    }
+
+    for (unsigned blockId = N; success && blockId < N + 100; ++blockId)
+    {
+        uint32_t expectedLen = 0, actualLen = 0;
+        success = wirehair_encode(encoder, blockId, &expected[0], blockBytes, &expectedLen) == Wirehair_Success &&
+            wirehair_encode(cachedEncoder, blockId, &actual[0], blockBytes, &actualLen) == Wirehair_Success &&
+            expectedLen == actualLen &&
+            0 == memcmp(&expected[0], &actual[0], expectedLen);
+    }
+
+    uint64_t usec[2] = { 0, 0 };
+
+    // Decode the same lossy stream without and then with the cache
+    for (unsigned pass = 0; success && pass < 2; ++pass)
+    {
+        WirehairCodec decoder = wirehair_decoder_create(nullptr, messageBytes, blockBytes);
+        success = decoder != nullptr;
+        if (success && pass == 1) {
+            success = wirehair_set_column_cache(decoder, cacheBytes) == Wirehair_Success;
+        }
+
+        prng.Seed(N, blockBytes);
+        WirehairResult result = Wirehair_NeedMore;
+
+        for (unsigned blockId = 0; success && result == Wirehair_NeedMore && blockId < N * 3 + 100; ++blockId)
+        {
+            // Introduce about 20% loss
+            if (prng.Next() % 100 < 20) {
+                continue;
+            }
+
+            uint32_t writeLen = 0;
+            if (wirehair_encode(encoder, blockId, &actual[0], blockBytes, &writeLen) != Wirehair_Success) {
+                success = false;
+                break;
+            }
+
+            const uint64_t t0 = siamese::GetTimeUsec();
+            result = wirehair_decode(decoder, blockId, &actual[0], writeLen);
+            usec[pass] += siamese::GetTimeUsec() - t0;
+        }
+
+        success = success && result == Wirehair_Success &&
+            wirehair_recover(decoder, &decoded[0], messageBytes) == Wirehair_Success &&
+            0 == memcmp(&decoded[0], &message[0], messageBytes);
+
+        wirehair_free(decoder);
+    }
+
+    wirehair_free(cachedEncoder);
+    wirehair_free(encoder);
+
+    if (!success)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Column cache failed for N = " << N << ", blockBytes = " << blockBytes << ", cacheBytes = " << cacheBytes << endl;
+        return false;
+    }
+
+    cout << "Column cache: N = " << N << ", blockBytes = " << blockBytes
+        << " decoded in " << usec[0] << " usec without, "
+        << usec[1] << " usec with " << cacheBytes << " bytes" << endl;
+
+    return true;
+}
+
+// Verify that inactivation deferral gives the same results as the default
+static bool Test_DeferStrategy(unsigned N, unsigned blockBytes, unsigned trials)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(N, trials);
+
+    const unsigned messageBytes = blockBytes * N - blockBytes / 2;
+
+    vector<uint8_t> message(messageBytes);
+    vector<uint8_t> decoded(messageBytes);
+    vector<uint8_t> expected(blockBytes), actual(blockBytes);
+    FillMessage(&message[0], messageBytes, prng);
+
+    WirehairCodec encoder = wirehair_encoder_create(nullptr, &message[0], messageBytes, blockBytes);
+
+    // The setting survives reuse, so set it on a codec and recreate from it
+    WirehairCodec otherEncoder = wirehair_decoder_create(nullptr, messageBytes, blockBytes);
+    bool success = encoder && otherEncoder &&
+        wirehair_set_defer_strategy(otherEncoder, WirehairDeferStrategy_Count) == Wirehair_InvalidInput &&
+        wirehair_set_defer_strategy(otherEncoder, Wirehair_Defer_Inactivation) == Wirehair_Success;
+    if (success) {
+        otherEncoder = wirehair_encoder_create(otherEncoder, &message[0], messageBytes, blockBytes);
+        success = otherEncoder != nullptr;
+    }
+
+    for (unsigned blockId = N; success && blockId < N + 100; ++blockId)
+    {
+        uint32_t expectedLen = 0, actualLen = 0;
+        success = wirehair_encode(encoder, blockId, &expected[0], blockBytes, &expectedLen) == Wirehair_Success &&
+            wirehair_encode(otherEncoder, blockId, &actual[0], blockBytes, &actualLen) == Wirehair_Success &&
+            expectedLen == actualLen &&
+            0 == memcmp(&expected[0], &actual[0], expectedLen);
+    }
+
+    // Decode the same lossy streams with each strategy
+    for (unsigned trial = 0; success && trial < trials; ++trial)
+    {
+        for (unsigned strategy = 0; success && strategy < 2; ++strategy)
+        {
+            WirehairCodec decoder = wirehair_decoder_create(nullptr, messageBytes, blockBytes);
+            success = decoder != nullptr &&
+                wirehair_set_defer_strategy(decoder, (WirehairDeferStrategy)strategy) == Wirehair_Success;
+
+            prng.Seed(N + trial, blockBytes);
+            WirehairResult result = Wirehair_NeedMore;
+
+            for (unsigned blockId = 0; success && result == Wirehair_NeedMore && blockId < N * 3 + 100; ++blockId)
+            {
+                // Introduce about 20% loss
+                if (prng.Next() % 100 < 20) {
+                    continue;
+                }
+
+                uint32_t writeLen = 0;
+                if (wirehair_encode(encoder, blockId, &actual[0], blockBytes, &writeLen) != Wirehair_Success) {
+                    success = false;
+                    break;
+                }
+
+                result = wirehair_decode(decoder, blockId, &actual[0], writeLen);
+            }
+
+            success = success && result == Wirehair_Success &&
+                wirehair_recover(decoder, &decoded[0], messageBytes) == Wirehair_Success &&
+                0 == memcmp(&decoded[0], &message[0], messageBytes);
+
+            wirehair_free(decoder);
+        }
+    }
+
+    wirehair_free(otherEncoder);
+    wirehair_free(encoder);
+
+    if (!success)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Defer strategy failed for N = " << N << ", blockBytes = " << blockBytes << endl;
+        return false;
+    }
+
+    return true;
+}
+
+// Time decoding the same lossy streams with each defer strategy
+static bool Benchmark_DeferStrategy(unsigned N, unsigned blockBytes, unsigned runs)
+{
+    static const char* const kStrategyNames[2] = { "weight-2", "inactivation" };
+
+    siamese::PCGRandom prng;
+    prng.Seed(N, runs);
+
+    const unsigned messageBytes = blockBytes * N;
+
+    vector<uint8_t> message(messageBytes);
+    vector<uint8_t> block(blockBytes);
+    FillMessage(&message[0], messageBytes, prng);
+
+    WirehairCodec encoder = wirehair_encoder_create(nullptr, &message[0], messageBytes, blockBytes);
+    if (!encoder) {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Failed to create encoder" << endl;
+        return false;
+    }
+
+    // Encode each stream once, so only decoding is timed
+    vector<unsigned> ids;
+    vector<uint8_t> blocks;
+
+    vector<uint64_t> usec[2];
+    bool success = true;
+
+    for (unsigned run = 0; success && run < runs; ++run)
+    {
+        // Lose 10% of the blocks
+        ids.clear();
+        for (unsigned blockId = 0; ids.size() < N + 100; ++blockId) {
+            if (prng.Next() % 100 >= 10) {
+                ids.push_back(blockId);
+            }
+        }
+
+        blocks.resize(ids.size() * blockBytes);
+        for (unsigned i = 0; i < ids.size(); ++i)
+        {
+            uint32_t writeLen = 0;
+            wirehair_encode(encoder, ids[i], &blocks[i * blockBytes], blockBytes, &writeLen);
+        }
+
+        // Alternate which strategy runs first, so neither always gets a warm cache
+        for (unsigned k = 0; success && k < 2; ++k)
+        {
+            const unsigned strategy = (run + k) % 2;
+
+            WirehairCodec decoder = wirehair_decoder_create(nullptr, messageBytes, blockBytes);
+            success = decoder != nullptr &&
+                wirehair_set_defer_strategy(decoder, (WirehairDeferStrategy)strategy) == Wirehair_Success;
+
+            WirehairResult result = Wirehair_NeedMore;
+
+            const uint64_t t0 = siamese::GetTimeUsec();
+            for (unsigned i = 0; success && result == Wirehair_NeedMore && i < ids.size(); ++i) {
+                result = wirehair_decode(decoder, ids[i], &blocks[i * blockBytes], blockBytes);
+            }
+            const uint64_t t1 = siamese::GetTimeUsec();
+
+            success = success && result == Wirehair_Success;
+            usec[strategy].push_back(t1 - t0);
+
+            wirehair_free(decoder);
+        }
+    }
+
+    wirehair_free(encoder);
+
+    if (!success)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Defer strategy benchmark failed for N = " << N << ", blockBytes = " << blockBytes << endl;
+        return false;
+    }
+
+    cout << "Defer strategy decode time for N = " << N << ", blockBytes = " << blockBytes
+        << ", 10% loss, " << runs << " runs:" << endl;
+
+    for (unsigned strategy = 0; strategy < 2; ++strategy)
+    {
+        double sum = 0., squares = 0.;
+        for (uint64_t t : usec[strategy]) {
+            sum += (double)t;
+            squares += (double)t * (double)t;
+        }
+
+        const double mean = sum / runs;
+        const double variance = squares / runs - mean * mean;
+
+        std::sort(usec[strategy].begin(), usec[strategy].end());
+
+        cout << "+ " << kStrategyNames[strategy] << ": mean " << (uint64_t)mean
+            << " usec, stddev " << (uint64_t)std::sqrt(variance > 0. ? variance : 0.)
+            << " usec, median " << usec[strategy][runs / 2] << " usec" << endl;
+    }
+
+    return true;
+}
+
+// Time batch encoder creation against creating each encoder in a loop
+static bool Benchmark_EncoderCreateMany(unsigned N, unsigned blockBytes, unsigned messageCount, unsigned runs)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(N, messageCount);
+
+    const unsigned messageBytes = blockBytes * N;
+
+    vector<vector<uint8_t>> messages(messageCount);
+    vector<const void*> messagePtrs(messageCount);
+    vector<uint64_t> messageSizes(messageCount, messageBytes);
+    vector<WirehairCodec> encoders(messageCount);
+
+    for (unsigned i = 0; i < messageCount; ++i)
+    {
+        messages[i].resize(messageBytes);
+        FillMessage(&messages[i][0], messageBytes, prng);
+        messagePtrs[i] = &messages[i][0];
+    }
+
+    // Thread counts to try, where 0 is the loop over wirehair_encoder_create()
+    const unsigned cores = std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() : 1;
+    vector<unsigned> threadCounts = { 0, 1 };
+    for (unsigned threads = 2; threads < cores; threads *= 2) {
+        threadCounts.push_back(threads);
+    }
+    if (cores > 1) {
+        threadCounts.push_back(cores);
+    }
+
+    vector<vector<uint64_t>> usec(threadCounts.size());
+    bool success = true;
+
+    for (unsigned run = 0; success && run < runs; ++run)
+    {
+        for (unsigned k = 0; success && k < threadCounts.size(); ++k)
+        {
+            const uint64_t t0 = siamese::GetTimeUsec();
+            if (threadCounts[k] == 0)
+            {
+                for (unsigned i = 0; i < messageCount; ++i)
+                {
+                    encoders[i] = wirehair_encoder_create(nullptr, messagePtrs[i], messageBytes, blockBytes);
+                    success = success && encoders[i] != nullptr;
+                }
+            }
+            else
+            {
+                success = wirehair_encoder_create_many(&messagePtrs[0], &messageSizes[0], messageCount, blockBytes, &encoders[0], threadCounts[k]) == Wirehair_Success;
+            }
+            const uint64_t t1 = siamese::GetTimeUsec();
+
+            usec[k].push_back(t1 - t0);
+
+            for (unsigned i = 0; i < messageCount; ++i) {
+                wirehair_free(encoders[i]);
+            }
+        }
+    }
+
+    if (!success)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Encoder create many benchmark failed for N = " << N << ", blockBytes = " << blockBytes << endl;
+        return false;
+    }
+
+    cout << "Encoder create time for " << messageCount << " messages with N = " << N
+        << ", blockBytes = " << blockBytes << ", " << runs << " runs:" << endl;
+
+    for (unsigned k = 0; k < threadCounts.size(); ++k)
+    {
+        std::sort(usec[k].begin(), usec[k].end());
+        const uint64_t median = usec[k][runs / 2];
+
+        if (threadCounts[k] == 0) {
+            cout << "+ wirehair_encoder_create() loop";
+        }
+        else {
+            cout << "+ wirehair_encoder_create_many() on " << threadCounts[k] << " threads";
+        }
+        cout << ": median " << median << " usec, " << median / messageCount
+            << " usec per encoder, " << (double)usec[0][runs / 2] / (median > 0 ? median : 1)
+            << "x the loop" << endl;
+    }
+
+    return true;
+}
+
+// Verify that encoders using the shared repair rows match one that does not
+static bool Test_RepairRowCache(unsigned N, unsigned blockBytes, unsigned repairCount)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(N, repairCount);
+
+    const unsigned messageBytes = blockBytes * N - blockBytes / 3;
+    const unsigned kMessages = 3;
+
+    vector<uint8_t> messages[kMessages];
+    for (unsigned i = 0; i < kMessages; ++i)
+    {
+        messages[i].resize(messageBytes);
+        FillMessage(&messages[i][0], messageBytes, prng);
+    }
+
+    vector<uint8_t> expected(blockBytes), actual(blockBytes);
+    WirehairCodec plain[kMessages] = {}, shared[kMessages] = {};
+
+    bool success = wirehair_repair_cache_configure(0, 0) == Wirehair_Success;
+    for (unsigned i = 0; success && i < kMessages; ++i) {
+        plain[i] = wirehair_encoder_create(nullptr, &messages[i][0], messageBytes, blockBytes);
+        success = plain[i] != nullptr;
+    }
+
+    success = success && wirehair_repair_cache_configure(repairCount, 2) == Wirehair_Success;
+    for (unsigned i = 0; success && i < kMessages; ++i) {
+        shared[i] = wirehair_encoder_create(nullptr, &messages[i][0], messageBytes, blockBytes);
+        success = shared[i] != nullptr;
+    }
+
+    uint64_t usec[2] = { 0, 0 };
+
+    // Cover ids below N, inside the table, and past its end
+    for (unsigned i = 0; success && i < kMessages; ++i)
+    {
+        for (unsigned blockId = 0; success && blockId < N + repairCount + 10; ++blockId)
+        {
+            uint32_t expectedLen = 0, actualLen = 0;
+
+            const uint64_t t0 = siamese::GetTimeUsec();
+            success = wirehair_encode(plain[i], blockId, &expected[0], blockBytes, &expectedLen) == Wirehair_Success;
+            const uint64_t t1 = siamese::GetTimeUsec();
+            success = success &&
+                wirehair_encode(shared[i], blockId, &actual[0], blockBytes, &actualLen) == Wirehair_Success;
+            const uint64_t t2 = siamese::GetTimeUsec();
+
+            if (blockId >= N && blockId < N + repairCount)
+            {
+                usec[0] += t1 - t0;
+                usec[1] += t2 - t1;
+            }
+
+            success = success &&
+                expectedLen == actualLen &&
+                0 == memcmp(&expected[0], &actual[0], expectedLen);
+        }
+    }
+
+    // Evicted tables stay valid for the encoders that hold them
+    if (success)
+    {
+        wirehair_repair_cache_configure(0, 0);
+
+        uint32_t expectedLen = 0, actualLen = 0;
+        success = wirehair_encode(plain[0], N, &expected[0], blockBytes, &expectedLen) == Wirehair_Success &&
+            wirehair_encode(shared[0], N, &actual[0], blockBytes, &actualLen) == Wirehair_Success &&
+            expectedLen == actualLen &&
+            0 == memcmp(&expected[0], &actual[0], expectedLen);
+    }
+
+    wirehair_repair_cache_configure(0, 0);
+
+    for (unsigned i = 0; i < kMessages; ++i)
+    {
+        wirehair_free(plain[i]);
+        wirehair_free(shared[i]);
+    }
+
+    if (!success)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Repair row cache failed for N = " << N << ", blockBytes = " << blockBytes << endl;
+        return false;
+    }
+
+    cout << "Repair row cache: N = " << N << ", blockBytes = " << blockBytes
+        << " encoded " << kMessages * repairCount << " repair blocks in " << usec[0] << " usec without, "
+        << usec[1] << " usec with" << endl;
+
+    return true;
+}
+
+// Verify that solving wide blocks in tiles matches encoding narrow slices of them
+static bool Test_TiledSolve(unsigned N, unsigned blockBytes, unsigned sliceBytes)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(N, blockBytes);
+
+    const unsigned messageBytes = blockBytes * N - blockBytes / 3;
+    const unsigned finalBytes = messageBytes - blockBytes * (N - 1);
+    const unsigned kRepairCount = 20;
+
+    vector<uint8_t> message(messageBytes), decoded(messageBytes);
+    vector<uint8_t> repair(kRepairCount * blockBytes), block(blockBytes);
+    vector<uint8_t> slice(sliceBytes * N), sliceBlock(sliceBytes);
+    FillMessage(&message[0], messageBytes, prng);
+
+    WirehairCodec encoder = wirehair_encoder_create(nullptr, &message[0], messageBytes, blockBytes);
+    bool success = encoder != nullptr;
+
+    for (unsigned i = 0; success && i < kRepairCount; ++i)
+    {
+        uint32_t writeLen = 0;
+        success = wirehair_encode(encoder, N + i, &repair[i * blockBytes], blockBytes, &writeLen) == Wirehair_Success &&
+            writeLen == blockBytes;
+    }
+
+    // Slices at the start, across the end of the final block, and at the end
+    const unsigned offsets[3] = { 0, finalBytes - sliceBytes / 2, blockBytes - sliceBytes };
+
+    for (unsigned i = 0; success && i < 3; ++i)
+    {
+        const unsigned offset = offsets[i];
+
+        // Gather the slice of each block, padding the final block with zeros
+        for (unsigned j = 0; j < N; ++j)
+        {
+            for (unsigned k = 0; k < sliceBytes; ++k)
+            {
+                const unsigned pos = j * blockBytes + offset + k;
+                slice[j * sliceBytes + k] = (pos < messageBytes) ? message[pos] : 0;
+            }
+        }
+
+        WirehairCodec sliceEncoder = wirehair_encoder_create(nullptr, &slice[0], sliceBytes * N, sliceBytes);
+        success = sliceEncoder != nullptr;
+
+        for (unsigned j = 0; success && j < kRepairCount; ++j)
+        {
+            uint32_t writeLen = 0;
+            success = wirehair_encode(sliceEncoder, N + j, &sliceBlock[0], sliceBytes, &writeLen) == Wirehair_Success &&
+                0 == memcmp(&repair[j * blockBytes + offset], &sliceBlock[0], sliceBytes);
+        }
+
+        wirehair_free(sliceEncoder);
+    }
+
+    // Decode with about 20% loss, then regenerate the repair blocks from the decoder
+    WirehairCodec decoder = success ? wirehair_decoder_create(nullptr, messageBytes, blockBytes) : nullptr;
+    success = decoder != nullptr;
+    WirehairResult result = Wirehair_NeedMore;
+
+    for (unsigned blockId = 0; success && result == Wirehair_NeedMore && blockId < N * 3 + 100; ++blockId)
+    {
+        if (prng.Next() % 100 < 20) {
+            continue;
+        }
+
+        uint32_t writeLen = 0;
+        success = wirehair_encode(encoder, blockId, &block[0], blockBytes, &writeLen) == Wirehair_Success;
+        if (success) {
+            result = wirehair_decode(decoder, blockId, &block[0], writeLen);
+        }
+    }
+
+    success = success && result == Wirehair_Success &&
+        wirehair_recover(decoder, &decoded[0], messageBytes) == Wirehair_Success &&
+        0 == memcmp(&decoded[0], &message[0], messageBytes) &&
+        wirehair_decoder_becomes_encoder(decoder) == Wirehair_Success;
+
+    for (unsigned i = 0; success && i < kRepairCount; ++i)
+    {
+        uint32_t writeLen = 0;
+        success = wirehair_encode(decoder, N + i, &block[0], blockBytes, &writeLen) == Wirehair_Success &&
+            writeLen == blockBytes &&
+            0 == memcmp(&repair[i * blockBytes], &block[0], blockBytes);
+    }
+
+    wirehair_free(decoder);
+    wirehair_free(encoder);
+
+    if (!success)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Tiled solve failed for N = " << N << ", blockBytes = " << blockBytes << endl;
+        return false;
+    }
+
+    return true;
+}
+
+// Verify that an encoder fed through segments matches one fed the whole message
+static bool Test_EncoderSegments(unsigned N, unsigned blockBytes, unsigned segmentCount)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(N, segmentCount);
+
+    const unsigned messageBytes = blockBytes * N - blockBytes / 2;
+
+    vector<uint8_t> message(messageBytes);
+    vector<uint8_t> expected(blockBytes), actual(blockBytes), update(blockBytes);
+    FillMessage(&message[0], messageBytes, prng);
+
+    // Split the message at random points into separate buffers, including
+    // empty segments and several boundaries within one block
+    vector<unsigned> cuts;
+    for (unsigned i = 1; i < segmentCount; ++i) {
+        cuts.push_back(prng.Next() % messageBytes);
+    }
+    for (unsigned cut = blockBytes; cut < blockBytes + 4 && cut < messageBytes; cut += 2) {
+        cuts.push_back(cut);
+    }
+    cuts.push_back(messageBytes);
+    std::sort(cuts.begin(), cuts.end());
+
+    vector<vector<uint8_t>> buffers(cuts.size());
+    vector<WirehairSegment> segments(cuts.size());
+    unsigned start = 0;
+    for (size_t i = 0; i < cuts.size(); ++i)
+    {
+        buffers[i].assign(message.begin() + start, message.begin() + cuts[i]);
+        segments[i].Data = buffers[i].empty() ? nullptr : &buffers[i][0];
+        segments[i].Bytes = buffers[i].size();
+        start = cuts[i];
+    }
+
+    WirehairCodec encoder = wirehair_encoder_create(nullptr, &message[0], messageBytes, blockBytes);
+    WirehairCodec segmented = wirehair_encoder_create_segments(nullptr, &segments[0], (unsigned)segments.size(), blockBytes);
+
+    // Segment sizes must add up to a valid message
+    WirehairSegment bad = { nullptr, 100 };
+    bool success = encoder && segmented &&
+        wirehair_encoder_create_segments(nullptr, &bad, 1, blockBytes) == nullptr;
+
+    // Replace a block gathered across segments, then the final block
+    const unsigned updates[2] = { 1, N - 1 };
+    for (unsigned round = 0; success && round <= 2; ++round)
+    {
+        for (unsigned blockId = 0; success && blockId < N + 50; ++blockId)
+        {
+            uint32_t expectedLen = 0, actualLen = 0;
+            success = wirehair_encode(encoder, blockId, &expected[0], blockBytes, &expectedLen) == Wirehair_Success &&
+                wirehair_encode(segmented, blockId, &actual[0], blockBytes, &actualLen) == Wirehair_Success &&
+                expectedLen == actualLen &&
+                0 == memcmp(&expected[0], &actual[0], expectedLen);
+        }
+
+        if (!success || round == 2) {
+            break;
+        }
+
+        const unsigned blockId = updates[round];
+        const unsigned offset = blockId * blockBytes;
+        const unsigned bytes = (blockId == N - 1) ? messageBytes - offset : blockBytes;
+        FillMessage(&update[0], bytes, prng);
+
+        success = wirehair_encoder_update(encoder, blockId, &update[0], bytes) == Wirehair_Success &&
+            wirehair_encoder_update(segmented, blockId, &update[0], bytes) == Wirehair_Success;
+
+        // Write the new data over the message and the segments afterwards
+        memcpy(&message[offset], &update[0], bytes);
+        start = 0;
+        for (size_t i = 0; i < cuts.size(); ++i)
+        {
+            for (unsigned pos = start; pos < cuts[i]; ++pos) {
+                if (pos >= offset && pos < offset + bytes) {
+                    buffers[i][pos - start] = update[pos - offset];
+                }
+            }
+            start = cuts[i];
+        }
+    }
+
+    wirehair_free(segmented);
+    wirehair_free(encoder);
+
+    if (!success)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Encoder segments failed for N = " << N << ", blockBytes = " << blockBytes << endl;
+        return false;
+    }
+
+    return true;
+}
+
+// Split a buffer at random points into output segments, including empty ones
+static void SplitOutput(uint8_t* data, unsigned bytes, unsigned segmentCount,
+    siamese::PCGRandom& prng, vector<WirehairOutputSegment>& segments)
+{
+    vector<unsigned> cuts;
+    for (unsigned i = 1; i < segmentCount; ++i) {
+        cuts.push_back(prng.Next() % (bytes + 1));
+    }
+    cuts.push_back(bytes);
+    std::sort(cuts.begin(), cuts.end());
+
+    segments.resize(cuts.size());
+    unsigned start = 0;
+    for (size_t i = 0; i < cuts.size(); ++i)
+    {
+        segments[i].Data = data + start;
+        segments[i].Bytes = cuts[i] - start;
+        start = cuts[i];
+    }
+}
+
+// Verify that encoding and recovering into segments matches the flat versions
+static bool Test_OutputSegments(unsigned N, unsigned blockBytes, unsigned segmentCount)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(N, segmentCount);
+
+    const unsigned messageBytes = blockBytes * N - blockBytes / 2;
+
+    vector<uint8_t> message(messageBytes), decoded(messageBytes, 0);
+    vector<uint8_t> expected(blockBytes), actual(blockBytes);
+    vector<WirehairOutputSegment> segments;
+    FillMessage(&message[0], messageBytes, prng);
+
+    WirehairCodec encoder = wirehair_encoder_create(nullptr, &message[0], messageBytes, blockBytes);
+    WirehairCodec decoder = wirehair_decoder_create(nullptr, messageBytes, blockBytes);
+    bool success = encoder && decoder;
+
+    // The segments must hold the whole block
+    uint32_t writeLen = 0;
+    WirehairOutputSegment small = { &actual[0], blockBytes - 1 };
+    success = success && (blockBytes < 2 ||
+        wirehair_encode_segments(encoder, N, &small, 1, &writeLen) == Wirehair_InvalidInput);
+
+    WirehairResult result = Wirehair_NeedMore;
+    for (unsigned blockId = 0; success && result == Wirehair_NeedMore && blockId < N * 3 + 100; ++blockId)
+    {
+        uint32_t expectedLen = 0, actualLen = 0;
+        memset(&actual[0], 0, blockBytes);
+        SplitOutput(&actual[0], blockBytes, segmentCount, prng, segments);
+
+        success = wirehair_encode(encoder, blockId, &expected[0], blockBytes, &expectedLen) == Wirehair_Success &&
+            wirehair_encode_segments(encoder, blockId, &segments[0], (unsigned)segments.size(), &actualLen) == Wirehair_Success &&
+            expectedLen == actualLen &&
+            0 == memcmp(&expected[0], &actual[0], expectedLen);
+
+        // Introduce about 20% loss
+        if (success && prng.Next() % 100 >= 20) {
+            result = wirehair_decode(decoder, blockId, &expected[0], expectedLen);
+        }
+    }
+    success = success && result == Wirehair_Success;
+
+    // The segments must add up to the message size
+    WirehairOutputSegment whole = { &decoded[0], messageBytes - 1 };
+    success = success &&
+        wirehair_recover_segments(decoder, &whole, 1) == Wirehair_InvalidInput;
+
+    SplitOutput(&decoded[0], messageBytes, segmentCount, prng, segments);
+    success = success &&
+        wirehair_recover_segments(decoder, &segments[0], (unsigned)segments.size()) == Wirehair_Success &&
+        0 == memcmp(&decoded[0], &message[0], messageBytes) &&
+        wirehair_decoder_becomes_encoder(decoder) == Wirehair_Success;
+
+    // Original blocks are regenerated once the decoder becomes an encoder
+    for (unsigned blockId = 0; success && blockId < N + 20; ++blockId)
+    {
+        uint32_t expectedLen = 0, actualLen = 0;
+        memset(&actual[0], 0, blockBytes);
+        SplitOutput(&actual[0], blockBytes, segmentCount, prng, segments);
+
+        success = wirehair_encode(encoder, blockId, &expected[0], blockBytes, &expectedLen) == Wirehair_Success &&
+            wirehair_encode_segments(decoder, blockId, &segments[0], (unsigned)segments.size(), &actualLen) == Wirehair_Success &&
+            expectedLen == actualLen &&
+            0 == memcmp(&expected[0], &actual[0], expectedLen);
+    }
+
+    wirehair_free(decoder);
+    wirehair_free(encoder);
+
+    if (!success)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Output segments failed for N = " << N << ", blockBytes = " << blockBytes << endl;
+        return false;
+    }
+
+    return true;
+}
+
+// Verify that block views point at the message for originals and match wirehair_encode()
+static bool Test_EncodeView(unsigned N, unsigned blockBytes)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(N, blockBytes);
+
+    const unsigned messageBytes = blockBytes * N - blockBytes / 2;
+
+    vector<uint8_t> message(messageBytes);
+    vector<uint8_t> expected(blockBytes);
+    FillMessage(&message[0], messageBytes, prng);
+
+    WirehairCodec encoder = wirehair_encoder_create(nullptr, &message[0], messageBytes, blockBytes);
+    WirehairCodec decoder = wirehair_decoder_create(nullptr, messageBytes, blockBytes);
+    bool success = encoder && decoder;
+
+    WirehairResult result = Wirehair_NeedMore;
+    for (unsigned blockId = 0; success && blockId < N + 50; ++blockId)
+    {
+        const void* view = nullptr;
+        uint32_t expectedLen = 0, viewLen = 0;
+        success = wirehair_encode(encoder, blockId, &expected[0], blockBytes, &expectedLen) == Wirehair_Success &&
+            wirehair_encode_view(encoder, blockId, &view, &viewLen) == Wirehair_Success &&
+            expectedLen == viewLen &&
+            0 == memcmp(&expected[0], view, viewLen);
+
+        // Original blocks are not copied
+        if (success && blockId < N) {
+            success = view == &message[blockId * blockBytes];
+        }
+
+        // Skip the first few originals so that the decoder has to regenerate them
+        if (success && result == Wirehair_NeedMore && blockId >= 3) {
+            result = wirehair_decode(decoder, blockId, view, viewLen);
+        }
+    }
+
+    success = success && result == Wirehair_Success &&
+        wirehair_decoder_becomes_encoder(decoder) == Wirehair_Success;
+
+    for (unsigned blockId = 0; success && blockId < N + 10; ++blockId)
+    {
+        const void* view = nullptr;
+        uint32_t expectedLen = 0, viewLen = 0;
+        success = wirehair_encode(encoder, blockId, &expected[0], blockBytes, &expectedLen) == Wirehair_Success &&
+            wirehair_encode_view(decoder, blockId, &view, &viewLen) == Wirehair_Success &&
+            expectedLen == viewLen &&
+            0 == memcmp(&expected[0], view, viewLen);
+    }
+
+    wirehair_free(decoder);
+    wirehair_free(encoder);
+
+    if (!success)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Encode view failed for N = " << N << ", blockBytes = " << blockBytes << endl;
+        return false;
+    }
+
+    return true;
+}
+
+/// Bitwise CRC32C for checking the codec's fused checksums
+static uint32_t ReferenceCrc32c(const uint8_t* data, size_t bytes)
+{
+    uint32_t crc = 0xffffffff;
+    for (size_t i = 0; i < bytes; ++i)
+    {
+        crc ^= data[i];
+        for (unsigned j = 0; j < 8; ++j) {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0x82F63B78 : 0);
+        }
+    }
+    return ~crc;
+}
+
+static bool Test_BlockCrc(unsigned N, unsigned blockBytes)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(N, blockBytes);
+
+    const unsigned messageBytes = blockBytes * N - blockBytes / 2;
+
+    vector<uint8_t> message(messageBytes);
+    vector<uint8_t> recovered(messageBytes);
+    vector<uint8_t> block(blockBytes);
+    vector<uint32_t> blockCrcs(N);
+    FillMessage(&message[0], messageBytes, prng);
+
+    // Standard check value for "123456789"
+    bool success = ReferenceCrc32c(reinterpret_cast<const uint8_t*>("123456789"), 9) == 0xE3069283;
+
+    WirehairCodec encoder = wirehair_encoder_create(nullptr, &message[0], messageBytes, blockBytes);
+    WirehairCodec decoder = wirehair_decoder_create(nullptr, messageBytes, blockBytes);
+    success = success && encoder && decoder;
+
+    WirehairResult result = Wirehair_NeedMore;
+    for (unsigned blockId = 0; success && blockId < N * 2 + 50; ++blockId)
+    {
+        uint32_t len = 0, crc = 0;
+        success = wirehair_encode_crc(encoder, blockId, &block[0], blockBytes, &len, &crc) == Wirehair_Success &&
+            crc == ReferenceCrc32c(&block[0], len);
+
+        // Skip the first few originals so that the decoder has to regenerate them
+        if (!success || result != Wirehair_NeedMore || blockId < 3) {
+            continue;
+        }
+
+        // Corrupt some of the blocks, which must be rejected and not affect decoding
+        if (blockId % 5 == 0)
+        {
+            block[prng.Next() % len] ^= (uint8_t)(1 << (prng.Next() % 8));
+            success = wirehair_decode_crc(decoder, blockId, &block[0], len, crc) == Wirehair_BadChecksum;
+            continue;
+        }
+
+        result = wirehair_decode_crc(decoder, blockId, &block[0], len, crc);
+    }
+
+    success = success && result == Wirehair_Success &&
+        wirehair_recover_crc(decoder, &recovered[0], messageBytes, &blockCrcs[0]) == Wirehair_Success &&
+        recovered == message;
+
+    for (unsigned i = 0; success && i < N; ++i)
+    {
+        const unsigned len = (i == N - 1) ? messageBytes - i * blockBytes : blockBytes;
+        success = blockCrcs[i] == ReferenceCrc32c(&message[i * blockBytes], len);
+    }
+
+    wirehair_free(decoder);
+    wirehair_free(encoder);
+
+    if (!success)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Block CRC failed for N = " << N << ", blockBytes = " << blockBytes << endl;
+        return false;
+    }
+
+    return true;
+}
+
+static bool Test_DuplicateBlocks(unsigned N, unsigned blockBytes)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(N, blockBytes);
+
+    const unsigned messageBytes = blockBytes * N - blockBytes / 2;
+
+    vector<uint8_t> message(messageBytes);
+    vector<uint8_t> recovered(messageBytes);
+    vector<uint8_t> block(blockBytes);
+    FillMessage(&message[0], messageBytes, prng);
+
+    WirehairCodec encoder = wirehair_encoder_create(nullptr, &message[0], messageBytes, blockBytes);
+    WirehairCodec decoder = nullptr;
+    bool success = encoder != nullptr;
+
+    // Run twice to check that a reused decoder forgets the old ids
+    for (unsigned trial = 0; success && trial < 2; ++trial)
+    {
+        decoder = wirehair_decoder_create(decoder, messageBytes, blockBytes);
+        success = decoder != nullptr;
+
+        // Lose half of the originals so that many repair ids are needed
+        vector<unsigned> ids;
+        for (unsigned blockId = N / 2; blockId < N * 2 + 10; ++blockId) {
+            ids.push_back(blockId);
+        }
+
+        WirehairResult result = Wirehair_NeedMore;
+        for (size_t i = 0; success && result == Wirehair_NeedMore && i < ids.size(); ++i)
+        {
+            uint32_t len = 0;
+            success = wirehair_encode(encoder, ids[i], &block[0], blockBytes, &len) == Wirehair_Success;
+
+            // Resend every block, and some earlier block as well
+            for (unsigned repeat = 0; success && repeat < 2 && result == Wirehair_NeedMore; ++repeat) {
+                result = wirehair_decode(decoder, ids[i], &block[0], len);
+            }
+            if (success && result == Wirehair_NeedMore && i > 0)
+            {
+                const unsigned oldId = ids[prng.Next() % i];
+                success = wirehair_encode(encoder, oldId, &block[0], blockBytes, &len) == Wirehair_Success;
+                result = wirehair_decode(decoder, oldId, &block[0], len);
+            }
+        }
+
+        success = success && result == Wirehair_Success &&
+            wirehair_recover(decoder, &recovered[0], messageBytes) == Wirehair_Success &&
+            recovered == message;
+    }
+
+    wirehair_free(decoder);
+    wirehair_free(encoder);
+
+    if (!success)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Duplicate blocks failed for N = " << N << ", blockBytes = " << blockBytes << endl;
+        return false;
+    }
+
+    return true;
+}
+
+static bool Test_SessionTable(unsigned N, unsigned blockBytes, unsigned messageCount)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(N, blockBytes);
+
+    const unsigned messageBytes = blockBytes * N - blockBytes / 2;
+
+    vector<vector<uint8_t>> messages(messageCount);
+    vector<WirehairCodec> encoders(messageCount);
+    vector<uint8_t> recovered(messageBytes);
+    vector<uint8_t> block(blockBytes);
+
+    bool success = true;
+    for (unsigned i = 0; i < messageCount; ++i)
+    {
+        messages[i].resize(messageBytes);
+        FillMessage(&messages[i][0], messageBytes, prng);
+        encoders[i] = wirehair_encoder_create(nullptr, &messages[i][0], messageBytes, blockBytes);
+        success = success && encoders[i];
+    }
+
+    WirehairSessionTable table = wirehair_session_table_create(0, 0);
+    WirehairSessionStats stats;
+    uint32_t firstRoundPooled = 0;
+    success = success && table;
+
+    // Interleave the blocks of all messages, skipping some originals.
+    // The second round should run entirely on recycled decoders
+    for (unsigned round = 0; success && round < 2; ++round)
+    {
+        const uint64_t baseId = (uint64_t)round << 40;
+        vector<bool> complete(messageCount, false);
+        unsigned completeCount = 0;
+
+        for (unsigned blockId = 0; success && completeCount < messageCount && blockId < N * 2 + 20; ++blockId)
+        {
+            for (unsigned i = 0; success && i < messageCount; ++i)
+            {
+                // Removed sessions would be started again by late blocks
+                if (complete[i] || blockId % 4 == i % 4) {
+                    continue;
+                }
+
+                uint32_t len = 0;
+                success = wirehair_encode(encoders[i], blockId, &block[0], blockBytes, &len) == Wirehair_Success;
+
+                const WirehairResult result = wirehair_session_decode(table, baseId + i, messageBytes, blockBytes, blockId, &block[0], len);
+
+                if (result == Wirehair_Success)
+                {
+                    success = success &&
+                        wirehair_session_recover(table, baseId + i, &recovered[0], messageBytes) == Wirehair_Success &&
+                        recovered == messages[i] &&
+                        wirehair_session_remove(table, baseId + i) == Wirehair_Success;
+                    complete[i] = true;
+                    ++completeCount;
+                }
+                else {
+                    success = success && result == Wirehair_NeedMore;
+                }
+            }
+        }
+
+        success = success && completeCount == messageCount &&
+            wirehair_session_table_stats(table, &stats) == Wirehair_Success &&
+            stats.ActiveSessions == 0 &&
+            stats.CompleteSessions == 0 &&
+            stats.PooledDecoders <= messageCount;
+
+        // No new decoders are created for the second round
+        if (round == 0) {
+            firstRoundPooled = stats.PooledDecoders;
+        }
+        else {
+            success = success && stats.PooledDecoders == firstRoundPooled;
+        }
+    }
+
+    wirehair_session_table_free(table);
+
+    // Budget for about three sessions: Starting more evicts the oldest
+    table = wirehair_session_table_create(0, 0);
+    uint32_t len = 0;
+    success = success && table &&
+        wirehair_encode(encoders[0], 0, &block[0], blockBytes, &len) == Wirehair_Success &&
+        wirehair_session_decode(table, 0, messageBytes, blockBytes, 0, &block[0], len) == Wirehair_NeedMore &&
+        wirehair_session_table_stats(table, &stats) == Wirehair_Success;
+    const uint64_t budget = stats.MemoryBytes * 3 + stats.MemoryBytes / 2;
+    wirehair_session_table_free(table);
+
+    table = wirehair_session_table_create(budget, 0);
+    for (unsigned i = 0; success && i < 6; ++i) {
+        success = wirehair_session_decode(table, i, messageBytes, blockBytes, 0, &block[0], len) == Wirehair_NeedMore &&
+            wirehair_session_table_stats(table, &stats) == Wirehair_Success &&
+            stats.MemoryBytes <= budget;
+    }
+    success = success && stats.ActiveSessions == 3 && stats.EvictedSessions == 3 &&
+        wirehair_session_remove(table, 0) == Wirehair_InvalidInput &&
+        wirehair_session_remove(table, 5) == Wirehair_Success;
+    wirehair_session_table_free(table);
+
+    // Idle sessions are evicted after the timeout
+    table = wirehair_session_table_create(0, 1);
+    success = success && table &&
+        wirehair_session_decode(table, 1, messageBytes, blockBytes, 0, &block[0], len) == Wirehair_NeedMore;
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    success = success && wirehair_session_expire(table) == 1 &&
+        wirehair_session_table_stats(table, &stats) == Wirehair_Success &&
+        stats.ActiveSessions == 0 && stats.EvictedSessions == 1 && stats.PooledDecoders == 1;
+    wirehair_session_table_free(table);
+
+    for (unsigned i = 0; i < messageCount; ++i) {
+        wirehair_free(encoders[i]);
+    }
+
+    if (!success)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Session table failed for N = " << N << ", blockBytes = " << blockBytes << endl;
+        return false;
+    }
+
+    return true;
+}
+
+static bool Test_DecoderCheckpoint(unsigned N, unsigned blockBytes)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(N, blockBytes);
+
+    const unsigned messageBytes = blockBytes * N - blockBytes / 2;
+
+    vector<uint8_t> message(messageBytes);
+    vector<uint8_t> recovered(messageBytes);
+    vector<uint8_t> block(blockBytes);
+    vector<uint8_t> state;
+    FillMessage(&message[0], messageBytes, prng);
+
+    WirehairCodec encoder = wirehair_encoder_create(nullptr, &message[0], messageBytes, blockBytes);
+    WirehairCodec decoder = wirehair_decoder_create(nullptr, messageBytes, blockBytes);
+    bool success = encoder && decoder;
+
+    // Checkpoint at about half of the blocks, losing every third original
+    unsigned blockId = 0;
+    WirehairResult result = Wirehair_NeedMore;
+    for (unsigned fed = 0; success && fed < N / 2; ++blockId)
+    {
+        if (blockId % 3 == 0 && blockId < N) {
+            continue;
+        }
+
+        uint32_t len = 0;
+        success = wirehair_encode(encoder, blockId, &block[0], blockBytes, &len) == Wirehair_Success;
+        result = wirehair_decode(decoder, blockId, &block[0], len);
+        success = success && result == Wirehair_NeedMore;
+        ++fed;
+    }
+
+    uint64_t stateBytes = 0;
+    success = success && wirehair_decoder_save(decoder, nullptr, 0, &stateBytes) == Wirehair_Success;
+    if (success)
+    {
+        state.resize((size_t)stateBytes);
+        success = wirehair_decoder_save(decoder, &state[0], stateBytes, &stateBytes) == Wirehair_Success &&
+            state.size() == stateBytes;
+    }
+
+    // A damaged checkpoint is rejected, and a good one resumes the decoder
+    if (success)
+    {
+        vector<uint8_t> damaged = state;
+        damaged[0] ^= 1;
+        success = wirehair_decoder_load(nullptr, &damaged[0], damaged.size()) == nullptr &&
+            wirehair_decoder_load(nullptr, &state[0], state.size() - 1) == nullptr;
+    }
+
+    wirehair_free(decoder);
+    decoder = success ? wirehair_decoder_load(nullptr, &state[0], state.size()) : nullptr;
+    success = success && decoder != nullptr;
+
+    // Repeats of blocks from before the checkpoint are still dropped
+    for (unsigned repeatId = 1; success && repeatId < blockId; repeatId += 3)
+    {
+        uint32_t len = 0;
+        success = wirehair_encode(encoder, repeatId, &block[0], blockBytes, &len) == Wirehair_Success &&
+            wirehair_decode(decoder, repeatId, &block[0], len) == Wirehair_NeedMore;
+    }
+
+    for (; success && result == Wirehair_NeedMore && blockId < N * 2 + 20; ++blockId)
+    {
+        if (blockId % 3 == 0 && blockId < N) {
+            continue;
+        }
+
+        uint32_t len = 0;
+        success = wirehair_encode(encoder, blockId, &block[0], blockBytes, &len) == Wirehair_Success;
+        result = wirehair_decode(decoder, blockId, &block[0], len);
+    }
+
+    success = success && result == Wirehair_Success &&
+        wirehair_decoder_save(decoder, nullptr, 0, &stateBytes) == Wirehair_InvalidInput &&
+        wirehair_recover(decoder, &recovered[0], messageBytes) == Wirehair_Success &&
+        recovered == message;
+
+    wirehair_free(decoder);
+    wirehair_free(encoder);
+
+    if (!success)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Decoder checkpoint failed for N = " << N << ", blockBytes = " << blockBytes << endl;
+        return false;
+    }
+
+    return true;
+}
+
+static bool Test_EncoderState(unsigned N, unsigned blockBytes)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(N, blockBytes);
+
+    const unsigned messageBytes = blockBytes * N - blockBytes / 2;
+
+    vector<uint8_t> message(messageBytes);
+    vector<uint8_t> expected(blockBytes), actual(blockBytes);
+    vector<uint8_t> state, state2;
+    FillMessage(&message[0], messageBytes, prng);
+
+    WirehairCodec encoder = wirehair_encoder_create(nullptr, &message[0], messageBytes, blockBytes);
+    bool success = encoder != nullptr;
+
+    uint64_t stateBytes = 0;
+    success = success && wirehair_encoder_export(encoder, nullptr, 0, &stateBytes) == Wirehair_Success;
+    if (success)
+    {
+        state.resize((size_t)stateBytes);
+        success = wirehair_encoder_export(encoder, &state[0], stateBytes, &stateBytes) == Wirehair_Success;
+    }
+
+    // Damaged state is rejected
+    if (success)
+    {
+        vector<uint8_t> damaged = state;
+        damaged[0] ^= 1;
+        success = wirehair_encoder_import(nullptr, &damaged[0], damaged.size(), nullptr) == nullptr &&
+            wirehair_encoder_attach(nullptr, &state[0], state.size() - 1, nullptr) == nullptr;
+    }
+
+    const vector<uint8_t>& mapping = state;
+    WirehairCodec imported = success ? wirehair_encoder_import(nullptr, &state[0], state.size(), &message[0]) : nullptr;
+    WirehairCodec attached = success ? wirehair_encoder_attach(nullptr, &mapping[0], mapping.size(), nullptr) : nullptr;
+    success = success && imported && attached;
+
+    // Both produce the same blocks as the encoder that ran the solver
+    for (unsigned blockId = 0; success && blockId < N + 50; ++blockId)
+    {
+        uint32_t expectedLen = 0, actualLen = 0;
+        success = wirehair_encode(encoder, blockId, &expected[0], blockBytes, &expectedLen) == Wirehair_Success &&
+            wirehair_encode(imported, blockId, &actual[0], blockBytes, &actualLen) == Wirehair_Success &&
+            expectedLen == actualLen && 0 == memcmp(&expected[0], &actual[0], actualLen) &&
+            wirehair_encode(attached, blockId, &actual[0], blockBytes, &actualLen) == Wirehair_Success &&
+            expectedLen == actualLen && 0 == memcmp(&expected[0], &actual[0], actualLen);
+    }
+
+    // Attached state is read-only, and exporting again gives the same state
+    success = success &&
+        wirehair_encoder_update(attached, 0, &message[0], blockBytes) == Wirehair_InvalidInput &&
+        wirehair_encoder_export(attached, nullptr, 0, &stateBytes) == Wirehair_Success &&
+        stateBytes == state.size();
+    if (success)
+    {
+        state2.resize((size_t)stateBytes);
+        success = wirehair_encoder_export(imported, &state2[0], stateBytes, &stateBytes) == Wirehair_Success &&
+            state2 == state;
+    }
+
+    // An attached codec can be reused for a new encoder
+    attached = success ? wirehair_encoder_create(attached, &message[0], messageBytes, blockBytes) : attached;
+    success = success && attached;
+    for (unsigned blockId = N; success && blockId < N + 10; ++blockId)
+    {
+        uint32_t expectedLen = 0, actualLen = 0;
+        success = wirehair_encode(encoder, blockId, &expected[0], blockBytes, &expectedLen) == Wirehair_Success &&
+            wirehair_encode(attached, blockId, &actual[0], blockBytes, &actualLen) == Wirehair_Success &&
+            0 == memcmp(&expected[0], &actual[0], actualLen);
+    }
+
+    // A decoder has no state to export until it has become an encoder
+    WirehairCodec decoder = wirehair_decoder_create(nullptr, messageBytes, blockBytes);
+    success = success && decoder &&
+        wirehair_encoder_export(decoder, nullptr, 0, &stateBytes) == Wirehair_InvalidInput;
+
+    wirehair_free(decoder);
+    wirehair_free(attached);
+    wirehair_free(imported);
+    wirehair_free(encoder);
+
+    if (!success)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Encoder state failed for N = " << N << ", blockBytes = " << blockBytes << endl;
+        return false;
+    }
+
+    return true;
+}
+
+static bool Test_SmallN(unsigned N, unsigned blockBytes)
+{
+    siamese::PCGRandom prng;
+    prng.Seed(N, blockBytes);
+
+    const unsigned messageBytes = blockBytes * N - blockBytes / 2;
+
+    vector<uint8_t> message(messageBytes);
+    vector<uint8_t> recovered(messageBytes);
+    vector<uint8_t> block(blockBytes);
+    vector<uint8_t> expected(blockBytes);
+    FillMessage(&message[0], messageBytes, prng);
+
+    // A plain Wirehair encoder, to compare against the fallback rows
+    WirehairCodec sparse = wirehair_encoder_create(nullptr, &message[0], messageBytes, blockBytes);
+
+    bool success = wirehair_small_n_configure(41) == Wirehair_InvalidInput &&
+        wirehair_small_n_configure(40) == Wirehair_Success;
+
+    WirehairCodec encoder = wirehair_encoder_create(nullptr, &message[0], messageBytes, blockBytes);
+    WirehairCodec decoder = nullptr;
+    success = success && sparse != nullptr && encoder != nullptr;
+
+    for (unsigned trial = 0; success && trial < 20; ++trial)
+    {
+        decoder = wirehair_decoder_create(decoder, messageBytes, blockBytes);
+        success = decoder != nullptr;
+
+        // Lose a different number of originals each time, and make up for
+        // them with Cauchy rows that are spread out
+        vector<unsigned> ids;
+        const unsigned lost = trial % (N + 1);
+        for (unsigned blockId = 0; blockId < N; ++blockId) {
+            ids.push_back(blockId);
+        }
+        for (unsigned i = 0; i < lost; ++i) {
+            ids[prng.Next() % N] = N + (i * 97 + trial) % (256 - N);
+        }
+        for (size_t i = ids.size() - 1; i > 0; --i) {
+            std::swap(ids[i], ids[prng.Next() % (i + 1)]);
+        }
+
+        // Above the Cauchy code limit a few more blocks may be needed
+        for (unsigned i = 0; i < 10; ++i) {
+            ids.push_back(N + 5000 + i);
+        }
+
+        WirehairResult result = Wirehair_NeedMore;
+        unsigned fed = 0;
+        for (size_t i = 0; success && result == Wirehair_NeedMore && i < ids.size(); ++i)
+        {
+            const unsigned blockId = ids[i];
+            uint32_t len = 0;
+            success = wirehair_encode(encoder, blockId, &block[0], blockBytes, &len) == Wirehair_Success;
+            result = wirehair_decode(decoder, blockId, &block[0], len);
+            ++fed;
+        }
+
+        success = success && result == Wirehair_Success &&
+            wirehair_recover(decoder, &recovered[0], messageBytes) == Wirehair_Success &&
+            recovered == message;
+
+        // Up to 40 any N different Cauchy rows are enough
+        if (success && N <= 40) {
+            success = fed == N;
+        }
+
+        // The decoder should now produce the same blocks as the encoder,
+        // with and without repair blocks received
+        if (success && trial < 2)
+        {
+            success = wirehair_decoder_becomes_encoder(decoder) == Wirehair_Success;
+
+            for (unsigned blockId = 0; success && blockId < N + 300; blockId += 7)
+            {
+                uint32_t len = 0, expectedLen = 0;
+                success = wirehair_encode(encoder, blockId, &expected[0], blockBytes, &expectedLen) == Wirehair_Success &&
+                    wirehair_encode(decoder, blockId, &block[0], blockBytes, &len) == Wirehair_Success &&
+                    len == expectedLen &&
+                    memcmp(&block[0], &expected[0], len) == 0;
+            }
+
+            wirehair_free(decoder);
+            decoder = nullptr;
+        }
+    }
+
+    // Repair ids from 256 up should be the blocks of the Wirehair code
+    for (unsigned blockId = 256; success && blockId < 300; ++blockId)
+    {
+        uint32_t len = 0, expectedLen = 0;
+        success = wirehair_encode(sparse, blockId, &expected[0], blockBytes, &expectedLen) == Wirehair_Success &&
+            wirehair_encode(encoder, blockId, &block[0], blockBytes, &len) == Wirehair_Success &&
+            len == expectedLen &&
+            memcmp(&block[0], &expected[0], len) == 0;
+    }
+
+    // Decode from half of the originals, a few Cauchy rows and then only
+    // Wirehair rows, as if the Cauchy rows ran out.  Save the decoder
+    // part way and load it with the Cauchy code disabled
+    if (success)
+    {
+        decoder = wirehair_decoder_create(decoder, messageBytes, blockBytes);
+        success = decoder != nullptr;
+
+        vector<unsigned> ids;
+        for (unsigned blockId = 0; blockId < N / 2; ++blockId) {
+            ids.push_back(blockId);
+        }
+        for (unsigned i = 0; i < N / 4; ++i) {
+            ids.push_back(N + 1 + i * 2);
+        }
+        const size_t saveIndex = ids.size();
+        for (unsigned i = 0; i < N + 40; ++i) {
+            ids.push_back(256 + i * 3);
+        }
+
+        WirehairResult result = Wirehair_NeedMore;
+        for (size_t i = 0; success && result == Wirehair_NeedMore && i < ids.size(); ++i)
+        {
+            if (i == saveIndex)
+            {
+                uint64_t stateBytes = 0;
+                success = wirehair_decoder_save(decoder, nullptr, 0, &stateBytes) == Wirehair_Success;
+
+                vector<uint8_t> state((size_t)stateBytes);
+                success = success &&
+                    wirehair_decoder_save(decoder, &state[0], stateBytes, &stateBytes) == Wirehair_Success &&
+                    wirehair_small_n_configure(0) == Wirehair_Success;
+
+                wirehair_free(decoder);
+                decoder = success ? wirehair_decoder_load(nullptr, &state[0], stateBytes) : nullptr;
+                success = success && decoder != nullptr &&
+                    wirehair_small_n_configure(40) == Wirehair_Success;
+            }
+
+            uint32_t len = 0;
+            success = success &&
+                wirehair_encode(encoder, ids[i], &block[0], blockBytes, &len) == Wirehair_Success;
+            result = wirehair_decode(decoder, ids[i], &block[0], len);
+        }
+
+        success = success && result == Wirehair_Success &&
+            wirehair_recover(decoder, &recovered[0], messageBytes) == Wirehair_Success &&
+            recovered == message;
+    }
+
+    // Decode from Wirehair rows only, which are sometimes dependent, so
+    // that the decoder has to drop rows and wait for more
+    for (unsigned trial = 0; success && trial < 20; ++trial)
+    {
+        decoder = wirehair_decoder_create(decoder, messageBytes, blockBytes);
+        success = decoder != nullptr;
+
+        WirehairResult result = Wirehair_NeedMore;
+        for (unsigned blockId = 256 + trial * 100; success && result == Wirehair_NeedMore && blockId < 256 + trial * 100 + N + 40; ++blockId)
+        {
+            uint32_t len = 0;
+            success = wirehair_encode(encoder, blockId, &block[0], blockBytes, &len) == Wirehair_Success;
+            result = wirehair_decode(decoder, blockId, &block[0], len);
+        }
+
+        success = success && result == Wirehair_Success &&
+            wirehair_recover(decoder, &recovered[0], messageBytes) == Wirehair_Success &&
+            recovered == message;
+    }
+
+    success = wirehair_small_n_configure(0) == Wirehair_Success && success;
+
+    wirehair_free(decoder);
+    wirehair_free(encoder);
+    wirehair_free(sparse);
+
+    if (!success)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Small N failed for N = " << N << ", blockBytes = " << blockBytes << endl;
+        return false;
+    }
+
+    return true;
+}
+
+int main()
+{
+    const WirehairResult initResult = wirehair_init();
+
+    if (initResult != Wirehair_Success)
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Wirehair initialization failed: " << initResult << endl;
+        return -1;
+    }
+
+    if (!ReadmeExample())
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Example usage failed" << endl;
+        return -2;
+    }
+
+    const unsigned threadCount = std::thread::hardware_concurrency() > 1 ? std::thread::hardware_concurrency() : 2;
+
+    if (!Test_ConcurrentEncode(1000, 1300, threadCount, 2000) ||
+        !Test_ConcurrentEncode(3, 65, threadCount, 100))
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Concurrent encode test failed" << endl;
+        return -5;
+    }
+
+    if (!Test_DecoderIntake(1000, 1300, threadCount) ||
+        !Test_DecoderIntake(2, 1, threadCount) ||
+        !Test_DecoderIntake(5000, 17, threadCount))
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Decoder intake test failed" << endl;
+        return -6;
+    }
+
+    if (!Test_RepairAhead(1000, 1300, threadCount, 1000) ||
+        !Test_RepairAhead(2, 1, threadCount, 100))
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Repair-ahead test failed" << endl;
+        return -7;
+    }
+
+    if (!Test_SteppedDecode(1000, 1300, 100) ||
+        !Test_SteppedDecode(2, 1, 100) ||
+        !Test_SteppedDecode(20000, 17, 1000) ||
+        !Test_SteppedPendingBlocks(100, 4, 400))
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Stepped decode test failed" << endl;
+        return -8;
+    }
+
+    if (!Test_AsyncJobs(200, 100) ||
+        !Test_AsyncJobs(20, 1300) ||
+        !Test_AsyncCodecOrder(200, 100))
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Async job test failed" << endl;
+        return -9;
+    }
+
+    if (!Test_EncoderCreateMany(40, 100, 0) ||
+        !Test_EncoderCreateMany(40, 100, 3) ||
+        !Test_EncoderCreateMany(1, 1300, 1))
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Encoder create many test failed" << endl;
+        return -10;
+    }
+
+    if (!Test_ColumnCache(64000, 64, 64000 * 24) ||
+        !Test_ColumnCache(10000, 64, 10000 * 8) ||
+        !Test_ColumnCache(1000, 1300, 1000 * 24) ||
+        !Test_ColumnCache(2, 1, 100) ||
+        !Test_ColumnCache(100, 10, 16))
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Column cache test failed" << endl;
+        return -11;
+    }
+
+    if (!Test_RepairRowCache(10000, 64, 5000) ||
+        !Test_RepairRowCache(1000, 1300, 1000) ||
+        !Test_RepairRowCache(2, 1, 10))
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Repair row cache test failed" << endl;
+        return -12;
+    }
+
+    if (!Test_DeferStrategy(64000, 64, 2) ||
+        !Test_DeferStrategy(10000, 64, 5) ||
+        !Test_DeferStrategy(1000, 1300, 10) ||
+        !Test_DeferStrategy(2, 1, 10))
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Defer strategy test failed" << endl;
+        return -13;
+    }
+
+    if (!Test_TiledSolve(20, 300001, 1000) ||
+        !Test_TiledSolve(200, 65553, 777))
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Tiled solve test failed" << endl;
+        return -14;
+    }
+
+    if (!Test_EncoderSegments(1000, 1300, 50) ||
+        !Test_EncoderSegments(2, 1, 1) ||
+        !Test_EncoderSegments(100, 17, 400) ||
+        !Test_EncoderSegments(20, 300001, 10))
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Encoder segments test failed" << endl;
+        return -15;
+    }
+
+    if (!Test_OutputSegments(1000, 1300, 4) ||
+        !Test_OutputSegments(2, 1, 1) ||
+        !Test_OutputSegments(100, 17, 300) ||
+        !Test_OutputSegments(20, 300001, 10))
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Output segments test failed" << endl;
+        return -16;
+    }
+
+    if (!Test_EncodeView(1000, 1300) ||
+        !Test_EncodeView(2, 1) ||
+        !Test_EncodeView(100, 17))
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Encode view test failed" << endl;
+        return -17;
+    }
+
+    if (!Test_BlockCrc(1000, 1300) ||
+        !Test_BlockCrc(2, 1) ||
+        !Test_BlockCrc(100, 17))
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Block CRC test failed" << endl;
+        return -18;
+    }
+
+    if (!Test_DuplicateBlocks(1000, 1300) ||
+        !Test_DuplicateBlocks(2, 1) ||
+        !Test_DuplicateBlocks(100, 17))
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Duplicate blocks test failed" << endl;
+        return -19;
+    }
+
+    if (!Test_SessionTable(100, 1000, 20) ||
+        !Test_SessionTable(2, 1, 5) ||
+        !Test_SessionTable(1000, 200, 8))
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Session table test failed" << endl;
+        return -20;
+    }
+
+    if (!Test_DecoderCheckpoint(1000, 1300) ||
+        !Test_DecoderCheckpoint(2, 1) ||
+        !Test_DecoderCheckpoint(100, 17) ||
+        !Test_DecoderCheckpoint(12000, 64))
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Decoder checkpoint test failed" << endl;
+        return -21;
+    }
+
+    if (!Test_EncoderState(1000, 1300) ||
+        !Test_EncoderState(2, 1) ||
+        !Test_EncoderState(100, 17) ||
+        !Test_EncoderState(20, 4096))
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Encoder state test failed" << endl;
+        return -22;
+    }
+
+    for (unsigned N = 2; N <= 44; ++N)
+    {
+        if (!Test_SmallN(N, 1 + N % 5) ||
+            !Test_SmallN(N, 1300))
+        {
+            SIAMESE_DEBUG_BREAK();
+            cout << "!!! Small N test failed" << endl;
+            return -23;
+        }
+    }
+
+#ifdef BENCHMARK_SHORT_LIST
+    for (unsigned i = 0; i < sizeof(kBenchmarkNList) / sizeof(kBenchmarkNList[0]); ++i)
+    {
+        const unsigned N = kBenchmarkNList[i];
+#else
+    for (unsigned N = 2; N < 64000; N *= 2)
+    {
+#endif
+        const unsigned kPacketBytes = 1300;
+        const unsigned kBenchTrials = 2000;
+
+        if (!Benchmark(N, kPacketBytes, kBenchTrials))
+        {
+            SIAMESE_DEBUG_BREAK();
+            cout << "!!! Benchmark failed" << endl;
+            return -3;
+        }
+    }
+
+    if (!Benchmark_DeferStrategy(1000, 1300, 20) ||
+        !Benchmark_DeferStrategy(10000, 64, 20) ||
+        !Benchmark_DeferStrategy(64000, 64, 5))
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Defer strategy benchmark failed" << endl;
+        return -24;
+    }
+
+    if (!Benchmark_EncoderCreateMany(1000, 1300, 64, 9) ||
+        !Benchmark_EncoderCreateMany(10000, 64, 64, 5) ||
+        !Benchmark_EncoderCreateMany(10000, 1200, 16, 5))
+    {
+        SIAMESE_DEBUG_BREAK();
+        cout << "!!! Encoder create many benchmark failed" << endl;
+        return -25;
+    }
+
     cout << "Wirehair Unit Test" << endl;
 
     uint64_t seed = siamese::GetTimeUsec();
@@ -28,11 +28,144 @@
 
 #include <wirehair/wirehair.h>
 #include "WirehairCodec.h"
+#include "WirehairIntake.h"
+#include "WirehairRepairAhead.h"
+#include "WirehairJobs.h"
+#include "WirehairSessionTable.h"
 
 #include <new> // std::nothrow
+#include <algorithm> // std::sort
+#include <thread>
+#include <atomic>
+#include <vector>
 
 static bool m_init = false;
 
+/// Block generated by the last wirehair_encode_view() call on this thread
+/// that could not point at the original data
+static thread_local std::vector<uint8_t> t_view_block;
+
+// Initialize an encoder, allocating it if codec is nullptr.
+// On failure the codec is freed and set to nullptr
+static WirehairResult CreateEncoder(
+    wirehair::Codec *& codec, ///< Codec to reuse or nullptr
+    const void * message, ///< Pointer to message
+    uint64_t messageBytes, ///< Bytes in the message
+    uint32_t blockBytes ///< Bytes in an output block
+)
+{
+    // Allocate a new Codec object
+    if (!codec) {
+        codec = new (std::nothrow) wirehair::Codec;
+        if (!codec) {
+            return Wirehair_OOM;
+        }
+    }
+
+    // Initialize codec
+    WirehairResult result = codec->InitializeEncoder(messageBytes, blockBytes);
+
+    // If initialization succeeded:
+    if (result == Wirehair_Success) {
+        // Feed message to codec
+        result = codec->EncodeFeed(message);
+    }
+
+    // If either function failed:
+    if (result != Wirehair_Success)
+    {
+        // Note this will also release the reuse parameter
+        delete codec;
+        codec = nullptr;
+    }
+
+    return result;
+}
+
+// Load exported encoder state into a codec, allocating it if reuseOpt is
+// nullptr.  On failure the codec is freed and nullptr is returned
+static WirehairCodec LoadEncoderState(
+    WirehairCodec reuseOpt, ///< Codec to reuse or nullptr
+    const void * state, ///< Exported state
+    uint64_t stateBytes, ///< Bytes of exported state
+    const void * messageOpt, ///< Original message, or nullptr
+    bool inPlace ///< Read the state in place instead of copying it
+)
+{
+    // If input is invalid:
+    if (!m_init || !state) {
+        return nullptr;
+    }
+
+    wirehair::Codec* codec = reinterpret_cast<wirehair::Codec*>(reuseOpt);
+
+    // Allocate a new Codec object
+    if (!codec) {
+        codec = new (std::nothrow) wirehair::Codec;
+        if (!codec) {
+            return nullptr;
+        }
+    }
+
+    const WirehairResult result = inPlace ?
+        codec->AttachEncoderState(state, stateBytes, messageOpt) :
+        codec->ImportEncoderState(state, stateBytes, messageOpt);
+
+    // If loading failed:
+    if (result != Wirehair_Success)
+    {
+        // Note this will also release the reuse parameter
+        delete codec;
+        codec = nullptr;
+    }
+
+    return reinterpret_cast<WirehairCodec>(codec);
+}
+
+// Queue work on the job pool for one of the *_async() functions
+static WirehairResult SubmitJob(
+    const wirehair::Job::Work& work, ///< Work to run
+    wirehair::Codec * codec, ///< Codec the work operates on, or nullptr
+    WirehairCallback callback, ///< Optional completion callback
+    void * context, ///< Application context for the callback
+    WirehairJob * jobOut ///< Optional job handle output
+)
+{
+    // If there is no way to report completion:
+    if (!callback && !jobOut) {
+        return Wirehair_InvalidInput;
+    }
+
+    wirehair::JobPool* pool = wirehair::JobPool::GetInstance();
+    if (!pool) {
+        return Wirehair_Error;
+    }
+
+    wirehair::Job* job;
+    try {
+        job = new wirehair::Job(work, codec, callback, context, !jobOut);
+    }
+    catch (...) {
+        return Wirehair_OOM;
+    }
+
+    // Handle must be written before the job can complete
+    if (jobOut) {
+        *jobOut = reinterpret_cast<WirehairJob>(job);
+    }
+
+    if (!pool->Submit(job))
+    {
+        delete job;
+        if (jobOut) {
+            *jobOut = nullptr;
+        }
+        return Wirehair_Error;
+    }
+
+    return Wirehair_Success;
+}
+
 
 extern "C" {
 
@@ -44,7 +177,7 @@ WIREHAIR_EXPORT const char *wirehair_result_string(
     WirehairResult result ///< Result code to convert to string
 )
 {
-    static_assert(WirehairResult_Count == 11, "Update this switch too");
+    static_assert(WirehairResult_Count == 14, "Update this switch too");
 
     switch (result)
     {
@@ -56,8 +189,12 @@ WIREHAIR_EXPORT const char *wirehair_result_string(
     case Wirehair_BadInput_LargeN:   return "Wirehair_BadInput_LargeN";
     case Wirehair_ExtraInsufficient: return "Wirehair_ExtraInsufficient";
     case Wirehair_InvalidInput:      return "Wirehair_InvalidInput";
+    case Wirehair_Error:             return "Wirehair_Error";
     case Wirehair_OOM:               return "Wirehair_OOM";
     case Wirehair_UnsupportedPlatform: return "Wirehair_UnsupportedPlatform";
+    case Wirehair_WouldBlock:        return "Wirehair_WouldBlock";
+    case Wirehair_InProgress:        return "Wirehair_InProgress";
+    case Wirehair_BadChecksum:       return "Wirehair_BadChecksum";
     default:
         break;
     }
@@ -97,9 +234,40 @@ WIREHAIR_EXPORT WirehairCodec wirehair_encoder_create(
 
     wirehair::Codec* codec = reinterpret_cast<wirehair::Codec*>(reuseOpt);
 
+    CreateEncoder(codec, message, messageBytes, blockBytes);
+
+    return reinterpret_cast<WirehairCodec>(codec);
+}
+
+WIREHAIR_EXPORT WirehairCodec wirehair_encoder_create_segments(
+    WirehairCodec           reuseOpt, ///< [Optional] Pointer to prior codec object
+    const WirehairSegment* segments, ///< Pointer to each segment
+    unsigned           segmentCount, ///< Number of segments
+    uint32_t             blockBytes  ///< Bytes in an output block
+)
+{
+    // If input is invalid:
+    if (!m_init || !segments || segmentCount < 1 || blockBytes < 1) {
+        return nullptr;
+    }
+
+    uint64_t messageBytes = 0;
+    for (unsigned i = 0; i < segmentCount; ++i) {
+        messageBytes += segments[i].Bytes;
+    }
+
+    if (messageBytes < 1) {
+        return nullptr;
+    }
+
+    wirehair::Codec* codec = reinterpret_cast<wirehair::Codec*>(reuseOpt);
+
     // Allocate a new Codec object
     if (!codec) {
         codec = new (std::nothrow) wirehair::Codec;
+        if (!codec) {
+            return nullptr;
+        }
     }
 
     // Initialize codec
@@ -108,7 +276,7 @@ WIREHAIR_EXPORT WirehairCodec wirehair_encoder_create(
     // If initialization succeeded:
     if (result == Wirehair_Success) {
         // Feed message to codec
-        result = codec->EncodeFeed(message);
+        result = codec->EncodeFeedSegments(segments, segmentCount);
     }
 
     // If either function failed:
@@ -116,12 +284,145 @@ WIREHAIR_EXPORT WirehairCodec wirehair_encoder_create(
     {
         // Note this will also release the reuse parameter
         delete codec;
-        codec = nullptr;
+        return nullptr;
     }
 
     return reinterpret_cast<WirehairCodec>(codec);
 }
 
+WIREHAIR_EXPORT WirehairResult wirehair_encoder_create_many(
+    const void* const* messages, ///< Pointer to each message
+    const uint64_t* messageBytes, ///< Bytes in each message
+    unsigned              count, ///< Number of messages
+    uint32_t         blockBytes, ///< Bytes in an output block
+    WirehairCodec*    codecsOut, ///< Set to an encoder for each message
+    unsigned        threadCount  ///< Number of threads, or 0 for all cores
+)
+{
+    // If input is invalid:
+    if (!m_init || !messages || !messageBytes || !codecsOut || blockBytes < 1) {
+        return Wirehair_InvalidInput;
+    }
+
+    for (unsigned i = 0; i < count; ++i) {
+        codecsOut[i] = nullptr;
+    }
+
+    // Sort largest N first, so the big jobs do not straggle at the end, and
+    // so that messages with the same N are next to each other
+    std::vector<unsigned> order;
+    std::vector<WirehairResult> results;
+    try {
+        order.resize(count);
+        results.resize(count, Wirehair_InvalidInput);
+    }
+    catch (...) {
+        return Wirehair_OOM;
+    }
+    for (unsigned i = 0; i < count; ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](unsigned a, unsigned b) {
+        return messageBytes[a] > messageBytes[b];
+    });
+
+    // Claim up to this many messages with the same N at a time, so one
+    // thread works through a group while the tables it needs are in cache
+    static const unsigned kGroupLimit = 8;
+
+    std::atomic<unsigned> next(0);
+
+    auto worker = [&]()
+    {
+        for (;;)
+        {
+            unsigned first = next.load(std::memory_order_relaxed);
+            unsigned end;
+
+            do {
+                if (first >= count) {
+                    return;
+                }
+
+                const uint64_t n = (messageBytes[order[first]] + blockBytes - 1) / blockBytes;
+
+                end = first + 1;
+                while (end < count && end - first < kGroupLimit &&
+                    (messageBytes[order[end]] + blockBytes - 1) / blockBytes == n)
+                {
+                    ++end;
+                }
+            } while (!next.compare_exchange_weak(first, end, std::memory_order_relaxed));
+
+            // Every codec in a group has the same matrix size, so once the
+            // first one has been solved the rest can put their matrix at the
+            // end of the workspace, and make one large allocation instead of
+            // two.  The scratch space cannot be shared between codecs instead,
+            // because UpdateInput() needs each encoder to keep its matrix
+            uint64_t matrixBytes = 0;
+
+            for (unsigned i = first; i < end; ++i)
+            {
+                const unsigned index = order[i];
+                wirehair::Codec* codec = nullptr;
+
+                // If input is valid:
+                if (messages[index] && messageBytes[index] >= 1)
+                {
+                    codec = new (std::nothrow) wirehair::Codec;
+                    if (!codec) {
+                        results[index] = Wirehair_OOM;
+                    }
+                    else
+                    {
+                        codec->SetMatrixReserve(matrixBytes);
+                        results[index] = CreateEncoder(codec, messages[index], messageBytes[index], blockBytes);
+                        if (codec) {
+                            matrixBytes = codec->MatrixBytes();
+                        }
+                    }
+                }
+
+                codecsOut[index] = reinterpret_cast<WirehairCodec>(codec);
+            }
+        }
+    };
+
+    if (threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+    if (threadCount > count) {
+        threadCount = count;
+    }
+
+    // The calling thread does its share too
+    std::vector<std::thread> threads;
+    try {
+        for (unsigned i = 1; i < threadCount; ++i) {
+            threads.push_back(std::thread(worker));
+        }
+    }
+    catch (...) {
+        // Continue with the threads that did start
+    }
+
+    worker();
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    // Report the first failure by message order
+    for (unsigned i = 0; i < count; ++i)
+    {
+        if (results[i] != Wirehair_Success) {
+            return results[i];
+        }
+    }
+
+    return Wirehair_Success;
+}
+
 WIREHAIR_EXPORT WirehairResult wirehair_encode(
     WirehairCodec    codec, ///< Pointer to codec from wirehair_encoder_init()
     unsigned       blockId, ///< Identifier of block to generate
@@ -134,7 +435,7 @@ WIREHAIR_EXPORT WirehairResult wirehair_encode(
         return Wirehair_InvalidInput;
     }
 
-    wirehair::Codec* session = reinterpret_cast<wirehair::Codec*>(codec);
+    const wirehair::Codec* session = reinterpret_cast<const wirehair::Codec*>(codec);
 
     const uint32_t writtenBytes = session->Encode(blockId, blockDataOut, outBytes);
     *dataBytesOut = writtenBytes;
@@ -146,6 +447,172 @@ WIREHAIR_EXPORT WirehairResult wirehair_encode(
     return Wirehair_Success;
 }
 
+WIREHAIR_EXPORT WirehairResult wirehair_encode_crc(
+    WirehairCodec    codec, ///< Pointer to codec from wirehair_encoder_init()
+    unsigned       blockId, ///< Identifier of block to generate
+    void*     blockDataOut, ///< Pointer to output block data
+    uint32_t      outBytes, ///< Bytes in the output buffer
+    uint32_t* dataBytesOut, ///< Number of bytes written <= blockBytes
+    uint32_t*        crcOut  ///< Set to the CRC32C of the bytes written
+)
+{
+    if (!codec || !blockDataOut || !dataBytesOut || !crcOut) {
+        return Wirehair_InvalidInput;
+    }
+
+    const wirehair::Codec* session = reinterpret_cast<const wirehair::Codec*>(codec);
+
+    const uint32_t writtenBytes = session->Encode(blockId, blockDataOut, outBytes, crcOut);
+    *dataBytesOut = writtenBytes;
+
+    if (writtenBytes <= 0) {
+        return Wirehair_InvalidInput;
+    }
+
+    return Wirehair_Success;
+}
+
+WIREHAIR_EXPORT WirehairResult wirehair_encode_view(
+    WirehairCodec      codec, ///< Pointer to codec from wirehair_encoder_init()
+    unsigned         blockId, ///< Identifier of block to generate
+    const void** blockDataOut, ///< Set to a pointer to the block data
+    uint32_t*   dataBytesOut  ///< Set to the number of bytes in the block
+)
+{
+    if (!codec || !blockDataOut || !dataBytesOut) {
+        return Wirehair_InvalidInput;
+    }
+
+    *blockDataOut = nullptr;
+    *dataBytesOut = 0;
+
+    const wirehair::Codec* session = reinterpret_cast<const wirehair::Codec*>(codec);
+
+    uint32_t writtenBytes = 0;
+    const uint8_t* view = session->GetOriginalBlock(blockId, writtenBytes);
+
+    // If the block must be generated:
+    if (!view)
+    {
+        const uint32_t blockBytes = session->BlockBytes();
+
+        try {
+            if (t_view_block.size() < blockBytes) {
+                t_view_block.resize(blockBytes);
+            }
+        }
+        catch (...) {
+            return Wirehair_OOM;
+        }
+
+        writtenBytes = session->Encode(blockId, &t_view_block[0], blockBytes);
+        view = &t_view_block[0];
+    }
+
+    if (writtenBytes <= 0) {
+        return Wirehair_InvalidInput;
+    }
+
+    *blockDataOut = view;
+    *dataBytesOut = writtenBytes;
+    return Wirehair_Success;
+}
+
+WIREHAIR_EXPORT WirehairResult wirehair_encode_segments(
+    WirehairCodec                    codec, ///< Pointer to codec from wirehair_encoder_init()
+    unsigned                       blockId, ///< Identifier of block to generate
+    const WirehairOutputSegment* segments, ///< Pointer to each output segment
+    unsigned                  segmentCount, ///< Number of segments
+    uint32_t*                 dataBytesOut  ///< Number of bytes written <= blockBytes
+)
+{
+    if (!codec || !segments || !dataBytesOut) {
+        return Wirehair_InvalidInput;
+    }
+
+    const wirehair::Codec* session = reinterpret_cast<const wirehair::Codec*>(codec);
+
+    const uint32_t writtenBytes = session->EncodeSegments(blockId, segments, segmentCount);
+    *dataBytesOut = writtenBytes;
+
+    if (writtenBytes <= 0) {
+        return Wirehair_InvalidInput;
+    }
+
+    return Wirehair_Success;
+}
+
+WIREHAIR_EXPORT WirehairResult wirehair_repair_cache_configure(
+    uint32_t repairCount, ///< Repair ids to precompute per N, or 0 to disable
+    unsigned  tableCount  ///< Number of N values to keep
+)
+{
+    wirehair::RepairRowCache::GetInstance()->Configure(repairCount, tableCount);
+
+    return Wirehair_Success;
+}
+
+WIREHAIR_EXPORT WirehairResult wirehair_small_n_configure(
+    unsigned maxN ///< Largest N to use the Cauchy code for, or 0 to disable
+)
+{
+    return wirehair::Codec::ConfigureSmallN(maxN);
+}
+
+WIREHAIR_EXPORT WirehairResult wirehair_encoder_update(
+    WirehairCodec    codec, ///< Pointer to codec from wirehair_encoder_create()
+    unsigned       blockId, ///< Identifier of the message block to replace
+    const void*    newData, ///< Pointer to new block data
+    uint32_t     dataBytes  ///< Number of bytes in the block
+)
+{
+    // If input is invalid:
+    if (!codec || !newData || dataBytes < 1) {
+        return Wirehair_InvalidInput;
+    }
+
+    wirehair::Codec* encoder = reinterpret_cast<wirehair::Codec*>(codec);
+
+    return encoder->UpdateInput(blockId, newData, dataBytes);
+}
+
+WIREHAIR_EXPORT WirehairResult wirehair_encoder_export(
+    WirehairCodec       codec, ///< Encoder to export
+    void*            stateOut, ///< State output, or nullptr for the size
+    uint64_t         outBytes, ///< Bytes available at stateOut
+    uint64_t*   stateBytesOut  ///< Set to the state size in bytes
+)
+{
+    // If input is invalid:
+    if (!codec || !stateBytesOut) {
+        return Wirehair_InvalidInput;
+    }
+
+    const wirehair::Codec* encoder = reinterpret_cast<const wirehair::Codec*>(codec);
+
+    return encoder->ExportEncoderState(stateOut, outBytes, *stateBytesOut);
+}
+
+WIREHAIR_EXPORT WirehairCodec wirehair_encoder_import(
+    WirehairCodec reuseOpt, ///< Codec object to reuse
+    const void*      state, ///< Exported state
+    uint64_t    stateBytes, ///< Bytes of exported state
+    const void* messageOpt  ///< Original message, or nullptr
+)
+{
+    return LoadEncoderState(reuseOpt, state, stateBytes, messageOpt, false);
+}
+
+WIREHAIR_EXPORT WirehairCodec wirehair_encoder_attach(
+    WirehairCodec reuseOpt, ///< Codec object to reuse
+    const void*      state, ///< Exported state
+    uint64_t    stateBytes, ///< Bytes of exported state
+    const void* messageOpt  ///< Original message, or nullptr
+)
+{
+    return LoadEncoderState(reuseOpt, state, stateBytes, messageOpt, true);
+}
+
 WIREHAIR_EXPORT WirehairCodec wirehair_decoder_create(
     WirehairCodec reuseOpt, ///< Codec object to reuse
     uint64_t  messageBytes, ///< Bytes in the message to decode
@@ -195,41 +662,44 @@ WIREHAIR_EXPORT WirehairResult wirehair_decode(
     return decoder->DecodeFeed(blockId, blockData, dataBytes);
 }
 
-WIREHAIR_EXPORT WirehairResult wirehair_recover(
-    WirehairCodec    codec, ///< Codec object
-    void*       messageOut, ///< Buffer where reconstructed message will be written
-    uint64_t  messageBytes  ///< Bytes in the message
+WIREHAIR_EXPORT WirehairResult wirehair_decode_crc(
+    WirehairCodec   codec, ///< Codec object
+    unsigned      blockId, ///< ID number of received block
+    const void* blockData, ///< Pointer to block data
+    uint32_t    dataBytes, ///< Number of bytes in the data block
+    uint32_t          crc  ///< CRC32C of the data bytes from the encoder
 )
 {
     // If input is invalid:
-    if (!codec || !messageOut) {
+    if (!codec || !blockData || dataBytes < 1) {
         return Wirehair_InvalidInput;
     }
 
     wirehair::Codec* decoder = reinterpret_cast<wirehair::Codec*>(codec);
 
-    return decoder->ReconstructOutput(messageOut, messageBytes);
+    return decoder->DecodeFeed(blockId, blockData, dataBytes, &crc);
 }
 
-WIREHAIR_EXPORT WirehairResult wirehair_recover_block(
-    WirehairCodec codec, ///< Codec object
-    unsigned    blockId, ///< ID of the block to reconstruct between 0..N-1
-    void*  blockDataOut, ///< Pointer to block data
-    uint32_t*  bytesOut  ///< Set to the number of data bytes in the block
+WIREHAIR_EXPORT WirehairResult wirehair_decoder_set_stepped(
+    WirehairCodec codec, ///< Decoder object
+    int         enabled  ///< Non-zero to enable stepped solving
 )
 {
     // If input is invalid:
-    if (!codec || !blockDataOut || !bytesOut) {
+    if (!codec) {
         return Wirehair_InvalidInput;
     }
 
     wirehair::Codec* decoder = reinterpret_cast<wirehair::Codec*>(codec);
 
-    return decoder->ReconstructBlock((uint16_t)blockId, blockDataOut, bytesOut);
+    decoder->SetSteppedSolve(enabled != 0);
+
+    return Wirehair_Success;
 }
 
-WIREHAIR_EXPORT WirehairResult wirehair_decoder_becomes_encoder(
-    WirehairCodec codec ///< Codec to change
+WIREHAIR_EXPORT WirehairResult wirehair_decode_step(
+    WirehairCodec  codec, ///< Decoder object
+    uint32_t  budgetUsec  ///< Time budget in microseconds
 )
 {
     // If input is invalid:
@@ -237,16 +707,568 @@ WIREHAIR_EXPORT WirehairResult wirehair_decoder_becomes_encoder(
         return Wirehair_InvalidInput;
     }
 
-    wirehair::Codec* encoder = reinterpret_cast<wirehair::Codec*>(codec);
+    wirehair::Codec* decoder = reinterpret_cast<wirehair::Codec*>(codec);
 
-    return encoder->InitializeEncoderFromDecoder();
+    return decoder->SolveStep(budgetUsec);
 }
 
-WIREHAIR_EXPORT void wirehair_free(
-    WirehairCodec codec ///< Codec object to free
+WIREHAIR_EXPORT WirehairResult wirehair_set_column_cache(
+    WirehairCodec codec, ///< Encoder or decoder object
+    uint32_t   maxBytes  ///< Memory budget in bytes, or 0 to disable
 )
 {
-    wirehair::Codec* object = reinterpret_cast<wirehair::Codec*>(codec);
+    // If input is invalid:
+    if (!codec) {
+        return Wirehair_InvalidInput;
+    }
+
+    wirehair::Codec* solver = reinterpret_cast<wirehair::Codec*>(codec);
+
+    solver->SetColumnCacheBytes(maxBytes);
+
+    return Wirehair_Success;
+}
+
+WIREHAIR_EXPORT WirehairResult wirehair_set_defer_strategy(
+    WirehairCodec            codec, ///< Encoder or decoder object
+    WirehairDeferStrategy strategy  ///< Strategy to use
+)
+{
+    // If input is invalid:
+    if (!codec || (unsigned)strategy >= (unsigned)WirehairDeferStrategy_Count) {
+        return Wirehair_InvalidInput;
+    }
+
+    wirehair::Codec* solver = reinterpret_cast<wirehair::Codec*>(codec);
+
+    solver->SetDeferStrategy(strategy);
+
+    return Wirehair_Success;
+}
+
+WIREHAIR_EXPORT WirehairResult wirehair_recover(
+    WirehairCodec    codec, ///< Codec object
+    void*       messageOut, ///< Buffer where reconstructed message will be written
+    uint64_t  messageBytes  ///< Bytes in the message
+)
+{
+    // If input is invalid:
+    if (!codec || !messageOut) {
+        return Wirehair_InvalidInput;
+    }
+
+    wirehair::Codec* decoder = reinterpret_cast<wirehair::Codec*>(codec);
+
+    return decoder->ReconstructOutput(messageOut, messageBytes);
+}
+
+WIREHAIR_EXPORT WirehairResult wirehair_recover_crc(
+    WirehairCodec    codec, ///< Codec object
+    void*       messageOut, ///< Buffer where reconstructed message will be written
+    uint64_t  messageBytes, ///< Bytes in the message
+    uint32_t* blockCrcsOut  ///< Set to the CRC32C of each block
+)
+{
+    // If input is invalid:
+    if (!codec || !messageOut || !blockCrcsOut) {
+        return Wirehair_InvalidInput;
+    }
+
+    wirehair::Codec* decoder = reinterpret_cast<wirehair::Codec*>(codec);
+
+    return decoder->ReconstructOutput(messageOut, messageBytes, blockCrcsOut);
+}
+
+WIREHAIR_EXPORT WirehairResult wirehair_recover_segments(
+    WirehairCodec                    codec, ///< Codec object
+    const WirehairOutputSegment* segments, ///< Pointer to each output segment
+    unsigned                  segmentCount  ///< Number of segments
+)
+{
+    // If input is invalid:
+    if (!codec || !segments) {
+        return Wirehair_InvalidInput;
+    }
+
+    wirehair::Codec* decoder = reinterpret_cast<wirehair::Codec*>(codec);
+
+    return decoder->ReconstructOutputSegments(segments, segmentCount);
+}
+
+WIREHAIR_EXPORT WirehairResult wirehair_recover_block(
+    WirehairCodec codec, ///< Codec object
+    unsigned    blockId, ///< ID of the block to reconstruct between 0..N-1
+    void*  blockDataOut, ///< Pointer to block data
+    uint32_t*  bytesOut  ///< Set to the number of data bytes in the block
+)
+{
+    // If input is invalid:
+    if (!codec || !blockDataOut || !bytesOut) {
+        return Wirehair_InvalidInput;
+    }
+
+    wirehair::Codec* decoder = reinterpret_cast<wirehair::Codec*>(codec);
+
+    return decoder->ReconstructBlock((uint16_t)blockId, blockDataOut, bytesOut);
+}
+
+WIREHAIR_EXPORT WirehairResult wirehair_decoder_becomes_encoder(
+    WirehairCodec codec ///< Codec to change
+)
+{
+    // If input is invalid:
+    if (!codec) {
+        return Wirehair_InvalidInput;
+    }
+
+    wirehair::Codec* encoder = reinterpret_cast<wirehair::Codec*>(codec);
+
+    return encoder->InitializeEncoderFromDecoder();
+}
+
+WIREHAIR_EXPORT WirehairResult wirehair_decoder_save(
+    WirehairCodec       codec, ///< Decoder to save
+    void*            stateOut, ///< Checkpoint output, or nullptr for the size
+    uint64_t         outBytes, ///< Bytes available at stateOut
+    uint64_t*   stateBytesOut  ///< Set to the checkpoint size in bytes
+)
+{
+    // If input is invalid:
+    if (!codec || !stateBytesOut) {
+        return Wirehair_InvalidInput;
+    }
+
+    const wirehair::Codec* decoder = reinterpret_cast<const wirehair::Codec*>(codec);
+
+    return decoder->SaveDecoderState(stateOut, outBytes, *stateBytesOut);
+}
+
+WIREHAIR_EXPORT WirehairCodec wirehair_decoder_load(
+    WirehairCodec reuseOpt, ///< Codec object to reuse
+    const void*      state, ///< Checkpoint data
+    uint64_t    stateBytes  ///< Bytes of checkpoint data
+)
+{
+    // If input is invalid:
+    if (!m_init || !state) {
+        return nullptr;
+    }
+
+    wirehair::Codec* codec = reinterpret_cast<wirehair::Codec*>(reuseOpt);
+
+    // Allocate a new Codec object
+    if (!codec) {
+        codec = new (std::nothrow) wirehair::Codec;
+        if (!codec) {
+            return nullptr;
+        }
+    }
+
+    const WirehairResult result = codec->LoadDecoderState(state, stateBytes);
+
+    // If loading failed:
+    if (result != Wirehair_Success)
+    {
+        // Note this will also release the reuse parameter
+        delete codec;
+        codec = nullptr;
+    }
+
+    return reinterpret_cast<WirehairCodec>(codec);
+}
+
+WIREHAIR_EXPORT void wirehair_free(
+    WirehairCodec codec ///< Codec object to free
+)
+{
+    wirehair::Codec* object = reinterpret_cast<wirehair::Codec*>(codec);
+
+    delete object;
+}
+
+
+//-----------------------------------------------------------------------------
+// Multi-Threaded Decoder Intake
+
+WIREHAIR_EXPORT WirehairIntake wirehair_intake_create(
+    WirehairCodec  decoder, ///< Decoder to feed
+    unsigned capacityBlocks ///< Number of blocks that can be staged
+)
+{
+    // If input is invalid:
+    if (!m_init || !decoder) {
+        return nullptr;
+    }
+
+    wirehair::BlockIntake* intake = new (std::nothrow) wirehair::BlockIntake;
+    if (!intake) {
+        return nullptr;
+    }
+
+    WirehairResult result = intake->Initialize(
+        reinterpret_cast<wirehair::Codec*>(decoder),
+        capacityBlocks);
+
+    if (result != Wirehair_Success)
+    {
+        delete intake;
+        intake = nullptr;
+    }
+
+    return reinterpret_cast<WirehairIntake>(intake);
+}
+
+WIREHAIR_EXPORT WirehairResult wirehair_intake_push(
+    WirehairIntake  intake, ///< Intake object
+    unsigned       blockId, ///< ID number of received block
+    const void*  blockData, ///< Pointer to block data
+    uint32_t     dataBytes  ///< Number of bytes in the data block
+)
+{
+    // If input is invalid:
+    if (!intake || !blockData || dataBytes < 1) {
+        return Wirehair_InvalidInput;
+    }
+
+    wirehair::BlockIntake* object = reinterpret_cast<wirehair::BlockIntake*>(intake);
+
+    return object->Push(blockId, blockData, dataBytes);
+}
+
+WIREHAIR_EXPORT WirehairResult wirehair_intake_drain(
+    WirehairIntake intake, ///< Intake object
+    unsigned    maxBlocks  ///< Maximum blocks to feed, or 0 for all
+)
+{
+    // If input is invalid:
+    if (!intake) {
+        return Wirehair_InvalidInput;
+    }
+
+    wirehair::BlockIntake* object = reinterpret_cast<wirehair::BlockIntake*>(intake);
+
+    return object->Drain(maxBlocks);
+}
+
+WIREHAIR_EXPORT void wirehair_intake_free(
+    WirehairIntake intake ///< Intake object to free
+)
+{
+    wirehair::BlockIntake* object = reinterpret_cast<wirehair::BlockIntake*>(intake);
+
+    delete object;
+}
+
+
+//-----------------------------------------------------------------------------
+// Background Repair-Ahead Encoder
+
+WIREHAIR_EXPORT WirehairRepairAhead wirehair_repair_ahead_start(
+    WirehairCodec  encoder, ///< Encoder to generate blocks from
+    unsigned  firstBlockId, ///< First block id to generate, usually >= N
+    unsigned capacityBlocks ///< Number of blocks to generate ahead
+)
+{
+    // If input is invalid:
+    if (!m_init || !encoder) {
+        return nullptr;
+    }
+
+    wirehair::RepairAhead* ahead = new (std::nothrow) wirehair::RepairAhead;
+    if (!ahead) {
+        return nullptr;
+    }
+
+    WirehairResult result = ahead->Start(
+        reinterpret_cast<const wirehair::Codec*>(encoder),
+        firstBlockId,
+        capacityBlocks);
+
+    if (result != Wirehair_Success)
+    {
+        delete ahead;
+        ahead = nullptr;
+    }
+
+    return reinterpret_cast<WirehairRepairAhead>(ahead);
+}
+
+WIREHAIR_EXPORT WirehairResult wirehair_repair_ahead_dequeue(
+    WirehairRepairAhead ahead, ///< Repair-ahead object
+    void*        blockDataOut, ///< Pointer to output block data
+    uint32_t         outBytes, ///< Bytes in the output buffer
+    unsigned*      blockIdOut, ///< Identifier of the block written
+    uint32_t*    dataBytesOut  ///< Number of bytes written <= blockBytes
+)
+{
+    // If input is invalid:
+    if (!ahead || !blockDataOut || !blockIdOut || !dataBytesOut) {
+        return Wirehair_InvalidInput;
+    }
+
+    wirehair::RepairAhead* object = reinterpret_cast<wirehair::RepairAhead*>(ahead);
+
+    return object->Dequeue(blockDataOut, outBytes, blockIdOut, dataBytesOut);
+}
+
+WIREHAIR_EXPORT void wirehair_repair_ahead_stop(
+    WirehairRepairAhead ahead ///< Repair-ahead object to stop
+)
+{
+    wirehair::RepairAhead* object = reinterpret_cast<wirehair::RepairAhead*>(ahead);
+
+    // Note the destructor stops the thread
+    delete object;
+}
+
+
+//-----------------------------------------------------------------------------
+// Asynchronous Jobs
+
+WIREHAIR_EXPORT WirehairResult wirehair_encoder_create_async(
+    WirehairCodec   reuseOpt, ///< [Optional] Pointer to prior codec object
+    const void*      message, ///< Pointer to message
+    uint64_t    messageBytes, ///< Bytes in the message
+    uint32_t      blockBytes, ///< Bytes in an output block
+    WirehairCallback callback, ///< [Optional] Completion callback
+    void*            context, ///< [Optional] Context for the callback
+    WirehairJob*      jobOut  ///< [Optional] Set to the job handle
+)
+{
+    // If input is invalid:
+    if (!m_init || !message || messageBytes < 1 || blockBytes < 1) {
+        return Wirehair_InvalidInput;
+    }
+
+    auto work = [=](wirehair::Codec*& codec) -> WirehairResult
+    {
+        return CreateEncoder(codec, message, messageBytes, blockBytes);
+    };
+
+    return SubmitJob(
+        work,
+        reinterpret_cast<wirehair::Codec*>(reuseOpt),
+        callback,
+        context,
+        jobOut);
+}
+
+WIREHAIR_EXPORT WirehairResult wirehair_decode_async(
+    WirehairCodec      codec, ///< Decoder object
+    unsigned         blockId, ///< ID number of received block
+    const void*    blockData, ///< Pointer to block data
+    uint32_t       dataBytes, ///< Number of bytes in the data block
+    WirehairCallback callback, ///< [Optional] Completion callback
+    void*            context, ///< [Optional] Context for the callback
+    WirehairJob*      jobOut  ///< [Optional] Set to the job handle
+)
+{
+    // If input is invalid:
+    if (!codec || !blockData || dataBytes < 1) {
+        return Wirehair_InvalidInput;
+    }
+
+    auto work = [=](wirehair::Codec*& decoder) -> WirehairResult
+    {
+        return decoder->DecodeFeed(blockId, blockData, dataBytes);
+    };
+
+    return SubmitJob(
+        work,
+        reinterpret_cast<wirehair::Codec*>(codec),
+        callback,
+        context,
+        jobOut);
+}
+
+WIREHAIR_EXPORT WirehairResult wirehair_recover_async(
+    WirehairCodec      codec, ///< Decoder object
+    void*         messageOut, ///< Buffer where reconstructed message will be written
+    uint64_t    messageBytes, ///< Bytes in the message
+    WirehairCallback callback, ///< [Optional] Completion callback
+    void*            context, ///< [Optional] Context for the callback
+    WirehairJob*      jobOut  ///< [Optional] Set to the job handle
+)
+{
+    // If input is invalid:
+    if (!codec || !messageOut) {
+        return Wirehair_InvalidInput;
+    }
+
+    auto work = [=](wirehair::Codec*& decoder) -> WirehairResult
+    {
+        return decoder->ReconstructOutput(messageOut, messageBytes);
+    };
+
+    return SubmitJob(
+        work,
+        reinterpret_cast<wirehair::Codec*>(codec),
+        callback,
+        context,
+        jobOut);
+}
+
+WIREHAIR_EXPORT WirehairResult wirehair_job_poll(
+    WirehairJob job ///< Job handle
+)
+{
+    // If input is invalid:
+    if (!job) {
+        return Wirehair_InvalidInput;
+    }
+
+    return reinterpret_cast<wirehair::Job*>(job)->Poll();
+}
+
+WIREHAIR_EXPORT WirehairResult wirehair_job_wait(
+    WirehairJob job ///< Job handle
+)
+{
+    // If input is invalid:
+    if (!job) {
+        return Wirehair_InvalidInput;
+    }
+
+    return reinterpret_cast<wirehair::Job*>(job)->Wait();
+}
+
+WIREHAIR_EXPORT WirehairCodec wirehair_job_codec(
+    WirehairJob job ///< Job handle
+)
+{
+    // If input is invalid:
+    if (!job) {
+        return nullptr;
+    }
+
+    return reinterpret_cast<WirehairCodec>(reinterpret_cast<wirehair::Job*>(job)->GetCodec());
+}
+
+WIREHAIR_EXPORT void wirehair_job_free(
+    WirehairJob job ///< Job handle to free
+)
+{
+    if (!job) {
+        return;
+    }
+
+    wirehair::Job* object = reinterpret_cast<wirehair::Job*>(job);
+
+    object->Wait();
+    object->Release();
+}
+
+
+//-----------------------------------------------------------------------------
+// Multi-Message Decoder Sessions
+
+WIREHAIR_EXPORT WirehairSessionTable wirehair_session_table_create(
+    uint64_t memoryBudgetBytes, ///< Bytes all decoders may hold, or 0
+    uint32_t   idleTimeoutMsec  ///< Idle time before eviction, or 0
+)
+{
+    // If input is invalid:
+    if (!m_init) {
+        return nullptr;
+    }
+
+    wirehair::SessionTable* table = new (std::nothrow) wirehair::SessionTable;
+    if (!table) {
+        return nullptr;
+    }
+
+    table->Initialize(memoryBudgetBytes, idleTimeoutMsec);
+
+    return reinterpret_cast<WirehairSessionTable>(table);
+}
+
+WIREHAIR_EXPORT WirehairResult wirehair_session_decode(
+    WirehairSessionTable table, ///< Session table
+    uint64_t         messageId, ///< Message the block belongs to
+    uint64_t      messageBytes, ///< Bytes in the message
+    uint32_t        blockBytes, ///< Bytes in each encoded block
+    unsigned           blockId, ///< ID number of received block
+    const void*      blockData, ///< Pointer to block data
+    uint32_t         dataBytes  ///< Number of bytes in the data block
+)
+{
+    // If input is invalid:
+    if (!table || messageBytes < 1 || blockBytes < 1 || !blockData || dataBytes < 1) {
+        return Wirehair_InvalidInput;
+    }
+
+    wirehair::SessionTable* object = reinterpret_cast<wirehair::SessionTable*>(table);
+
+    return object->Decode(messageId, messageBytes, blockBytes, blockId, blockData, dataBytes);
+}
+
+WIREHAIR_EXPORT WirehairResult wirehair_session_recover(
+    WirehairSessionTable table, ///< Session table
+    uint64_t         messageId, ///< Message to recover
+    void*           messageOut, ///< Buffer where reconstructed message will be written
+    uint64_t      messageBytes  ///< Bytes in the message
+)
+{
+    // If input is invalid:
+    if (!table || !messageOut) {
+        return Wirehair_InvalidInput;
+    }
+
+    wirehair::SessionTable* object = reinterpret_cast<wirehair::SessionTable*>(table);
+
+    return object->Recover(messageId, messageOut, messageBytes);
+}
+
+WIREHAIR_EXPORT WirehairResult wirehair_session_remove(
+    WirehairSessionTable table, ///< Session table
+    uint64_t         messageId  ///< Message to remove
+)
+{
+    // If input is invalid:
+    if (!table) {
+        return Wirehair_InvalidInput;
+    }
+
+    wirehair::SessionTable* object = reinterpret_cast<wirehair::SessionTable*>(table);
+
+    return object->Remove(messageId);
+}
+
+WIREHAIR_EXPORT unsigned wirehair_session_expire(
+    WirehairSessionTable table ///< Session table
+)
+{
+    if (!table) {
+        return 0;
+    }
+
+    wirehair::SessionTable* object = reinterpret_cast<wirehair::SessionTable*>(table);
+
+    return object->Expire();
+}
+
+WIREHAIR_EXPORT WirehairResult wirehair_session_table_stats(
+    WirehairSessionTable   table, ///< Session table
+    WirehairSessionStats* statsOut  ///< Set to the current counters
+)
+{
+    // If input is invalid:
+    if (!table || !statsOut) {
+        return Wirehair_InvalidInput;
+    }
+
+    const wirehair::SessionTable* object = reinterpret_cast<const wirehair::SessionTable*>(table);
+
+    object->GetStats(*statsOut);
+
+    return Wirehair_Success;
+}
+
+WIREHAIR_EXPORT void wirehair_session_table_free(
+    WirehairSessionTable table ///< Session table to free
+)
+{
+    wirehair::SessionTable* object = reinterpret_cast<wirehair::SessionTable*>(table);
 
     delete object;
 }